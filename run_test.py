@@ -4,17 +4,19 @@ from sparse_neighbors_search import MinHash
 from sparse_neighbors_search import MinHashClassifier
 from sparse_neighbors_search import WtaHash
 from sparse_neighbors_search import WtaHashClassifier
+from sparse_neighbors_search import ShardedNearestNeighbors
 
 import numpy as np 
 from sklearn.neighbors import NearestNeighbors
 from scipy.sparse import csr_matrix
 from scipy.sparse import coo_matrix
+from scipy.sparse import vstack
 
-from eden.converter.graph.gspan import gspan_to_eden
-from eden.graph import Vectorizer
 import os.path
+import sys
 import time
 import pickle
+import tempfile
 from scipy.io import mmwrite
 from scipy.io import mmread
 
@@ -35,7 +37,158 @@ def load_bursi():
     # else:
         # return pickle.load(open('/home/wolffj/data/minhash/dataset_bursi', 'rb'))
     return mmread(open("bursi.mtx", 'r'))
+
+def create_fixture(number_of_instances, seed):
+    # instances are noisy copies of a few prototypes, so every instance has close neighbors
+    random_state = np.random.RandomState(seed)
+    prototype_state = np.random.RandomState(42)
+    prototypes = [prototype_state.choice(5000, 40, replace=False) for i in xrange(30)]
+    instances = []
+    features = []
+    for i in xrange(number_of_instances):
+        prototype = prototypes[random_state.randint(len(prototypes))]
+        kept = prototype[random_state.rand(len(prototype)) < 0.8]
+        noise = random_state.choice(5000, 8, replace=False)
+        instance_features = np.unique(np.concatenate((kept, noise)))
+        instances.extend([i] * len(instance_features))
+        features.extend(instance_features)
+    return csr_matrix((np.ones(len(instances)), (instances, features)), shape=(number_of_instances, 5000))
+
+def test_save_load(dataset, queries):
+    path = os.path.join(tempfile.mkdtemp(), "index.sns")
+    for storage in [2, 3]:
+        minhash = MinHash(n_neighbors=5, inverse_index_storage=storage)
+        minhash.fit(dataset)
+        expected = [minhash.kneighbors(fast=fast) for fast in [True, False]]
+        expected += [minhash.kneighbors(queries, fast=fast) for fast in [True, False]]
+        minhash.save(path)
+        for populate in [False, True]:
+            loaded = MinHash()
+            loaded.load(path, populate=populate)
+            result = [loaded.kneighbors(fast=fast) for fast in [True, False]]
+            result += [loaded.kneighbors(queries, fast=fast) for fast in [True, False]]
+            for (distances, neighbors), (expected_distances, expected_neighbors) in zip(result, expected):
+                assert np.array_equal(neighbors, expected_neighbors), "storage %d populate %s: other neighbors after load" % (storage, populate)
+                assert np.allclose(distances, expected_distances), "storage %d populate %s: other distances after load" % (storage, populate)
+    os.remove(path)
+    print "save and load: ok"
+
+def test_remove_update(dataset):
+    for storage in [0, 2]:
+        # -1 never compacts, 0 compacts after every removal
+        for compaction_threshold in [-1, 0.0]:
+            minhash = MinHash(n_neighbors=5, inverse_index_storage=storage, compaction_threshold=compaction_threshold)
+            minhash.fit(dataset)
+            removed = [7, 8]
+            minhash.remove(removed)
+            for fast in [True, False]:
+                neighbors = minhash.kneighbors(dataset, return_distance=False, fast=fast)
+                assert not np.in1d(removed, neighbors).any(), "storage %d: a removed instance is a neighbor" % storage
+            # 7 comes back with its own features, 8 with the ones of instance 100
+            minhash.update([7], dataset[7])
+            minhash.update([8], dataset[100])
+            neighbors = minhash.kneighbors(dataset[[7, 100]], return_distance=False, fast=False)
+            assert 7 in neighbors[0], "storage %d: an updated instance is not its own neighbor" % storage
+            assert 8 in neighbors[1] and 100 in neighbors[1], "storage %d: an updated instance is not found by its new features" % storage
+    print "remove and update: ok"
+
+def test_storage_types(dataset):
+    expected = None
+    for storage in [0, 1, 2, 3, 4]:
+        minhash = MinHash(n_neighbors=5, inverse_index_storage=storage)
+        minhash.fit(dataset)
+        distances, neighbors = minhash.kneighbors(fast=True)
+        if expected is None:
+            expected = (distances, neighbors)
+            continue
+        assert np.array_equal(neighbors, expected[1]), "storage %d: other neighbors than storage 0" % storage
+        assert np.allclose(distances, expected[0]), "storage %d: other distances than storage 0" % storage
+    print "storage types: ok"
+
+def test_partial_fit(dataset):
+    half = dataset.shape[0] // 2
+    for storage in [0, 2]:
+        minhash = MinHash(n_neighbors=5, inverse_index_storage=storage)
+        minhash.fit(dataset)
+        expected = [minhash.kneighbors(fast=fast) for fast in [True, False]]
+        minhash = MinHash(n_neighbors=5, inverse_index_storage=storage)
+        minhash.fit(dataset[:half])
+        minhash.partial_fit(dataset[half:])
+        result = [minhash.kneighbors(fast=fast) for fast in [True, False]]
+        for (distances, neighbors), (expected_distances, expected_neighbors) in zip(result, expected):
+            assert np.array_equal(neighbors, expected_neighbors), "storage %d: other neighbors after partial_fit" % storage
+            assert np.allclose(distances, expected_distances), "storage %d: other distances after partial_fit" % storage
+    # the bloomier filter can not be extended and keeps its instances
+    minhash = MinHash(n_neighbors=5, inverse_index_storage=4)
+    minhash.fit(dataset[:half])
+    expected = minhash.kneighbors(fast=True)
+    try:
+        minhash.partial_fit(dataset[half:])
+        assert False, "storage 4: partial_fit did not fail"
+    except ValueError:
+        pass
+    distances, neighbors = minhash.kneighbors(fast=True)
+    assert np.array_equal(neighbors, expected[1]), "storage 4: other neighbors after a failed partial_fit"
+    assert np.allclose(distances, expected[0]), "storage 4: other distances after a failed partial_fit"
+    print "partial fit: ok"
+
+def test_sharded(dataset, queries):
+    minhash = MinHash(n_neighbors=5)
+    minhash.fit(dataset)
+    expected_distances, expected_neighbors = minhash.kneighbors(queries, fast=True)
+    sharded = ShardedNearestNeighbors(number_of_shards=3, n_neighbors=5)
+    sharded.fit(dataset)
+    distances, neighbors = sharded.kneighbors(queries, fast=True)
+    sharded.close()
+    assert np.allclose(distances, expected_distances), "sharded: other distances than one index"
+    for i in xrange(queries.shape[0]):
+        # neighbors with equal distances can be ordered differently, the closer ones are the same
+        closer = expected_distances[i] < expected_distances[i][-1]
+        assert set(neighbors[i][closer]) == set(expected_neighbors[i][closer]), "sharded: other neighbors than one index"
+    print "sharded: ok"
+
+def check_query_cache(cached, uncached, queries, change):
+    # the first query after a change is computed again, the repeated one is answered from the cache
+    cached.get_query_cache_statistics(reset=True)
+    expected_distances, expected_neighbors = uncached.kneighbors(queries, fast=True)
+    for repetition in xrange(2):
+        distances, neighbors = cached.kneighbors(queries, fast=True)
+        assert np.array_equal(neighbors, expected_neighbors), "query cache after %s: other neighbors than without cache" % change
+        assert np.allclose(distances, expected_distances), "query cache after %s: other distances than without cache" % change
+    statistics = cached.get_query_cache_statistics(reset=True)
+    assert statistics['hits'] == queries.shape[0], "query cache after %s: %d hits for %d repeated queries" % (change, statistics['hits'], queries.shape[0])
+
+def test_query_cache(dataset, queries):
+    queries = vstack([dataset[:20], queries]).tocsr()
+    cached = MinHash(n_neighbors=5, query_cache_size=1000)
+    uncached = MinHash(n_neighbors=5)
+    extension = create_fixture(100, 3)
+    for minhash in [cached, uncached]:
+        minhash.fit(dataset)
+    check_query_cache(cached, uncached, queries, "fit")
+    for minhash in [cached, uncached]:
+        minhash.partial_fit(extension)
+    check_query_cache(cached, uncached, queries, "partial_fit")
+    for minhash in [cached, uncached]:
+        minhash.remove([0, 1])
+    check_query_cache(cached, uncached, queries, "remove")
+    for minhash in [cached, uncached]:
+        minhash.update([2], dataset[100])
+    check_query_cache(cached, uncached, queries, "update")
+    print "query cache: ok"
+
 if __name__ == "__main__":
+    fixture = create_fixture(500, 1)
+    test_save_load(fixture, create_fixture(50, 2))
+    test_remove_update(fixture)
+    test_storage_types(fixture)
+    test_partial_fit(fixture)
+    test_sharded(fixture, create_fixture(50, 2))
+    test_query_cache(fixture, create_fixture(50, 2))
+
+    # the comparison with sklearn needs the bursi data set, it is not part of the repository
+    if not os.path.isfile("bursi.mtx"):
+        sys.exit(0)
     dataset = load_bursi()
 
     # data = []
@@ -49,24 +49,40 @@ import distutils.sysconfig
 import distutils.ccompiler
 
 sources_list = ['sparse_neighbors_search/computation/interface/nearestNeighbors_PythonInterface.cpp', 'sparse_neighbors_search/computation/nearestNeighbors.cpp', 
-                 'sparse_neighbors_search/computation/inverseIndex.cpp', 'sparse_neighbors_search/computation/inverseIndexStorageUnorderedMap.cpp']
-depends_list = ['sparse_neighbors_search/computation/nearestNeighbors.h', 'sparse_neighbors_search/computation/inverseIndex.h', 'sparse_neighbors_search/computation/kSizeSortedMap.h',
+                 'sparse_neighbors_search/computation/inverseIndex.cpp', 'sparse_neighbors_search/computation/inverseIndexStorageUnorderedMap.cpp',
+                 'sparse_neighbors_search/computation/inverseIndexStorageFlatHashMap.cpp', 'sparse_neighbors_search/computation/inverseIndexStorageFrozen.cpp',
+                 'sparse_neighbors_search/computation/inverseIndexStorageBloomierFilter.cpp']
+depends_list = ['sparse_neighbors_search/computation/nearestNeighbors.h', 'sparse_neighbors_search/computation/inverseIndex.h', 'sparse_neighbors_search/computation/kSizeSortedArray.h', 'sparse_neighbors_search/computation/signatureMatrix.h', 'sparse_neighbors_search/computation/signatureBatch.h', 'sparse_neighbors_search/computation/collisionCounter.h', 'sparse_neighbors_search/computation/neighborhood.h', 'sparse_neighbors_search/computation/workSchedule.h', 'sparse_neighbors_search/computation/queryCache.h',
          'sparse_neighbors_search/computation/typeDefinitions.h', 'sparse_neighbors_search/computation/parsePythonToCpp.h', 'sparse_neighbors_search/computation/sparseMatrix.h',
-          'sparse_neighbors_search/computation/inverseIndexStorage.h', 'sparse_neighbors_search/computation/inverseIndexStorageUnorderedMap.h','sparse_neighbors_search/computation/sseExtension.h','sparse_neighbors_search/computation/hash.h']
+          'sparse_neighbors_search/computation/inverseIndexStorage.h', 'sparse_neighbors_search/computation/inverseIndexStorageUnorderedMap.h','sparse_neighbors_search/computation/inverseIndexStorageFlatHashMap.h','sparse_neighbors_search/computation/inverseIndexStorageFrozen.h','sparse_neighbors_search/computation/inverseIndexStorageBloomierFilter.h','sparse_neighbors_search/computation/streamVByte.h','sparse_neighbors_search/computation/indexFile.h','sparse_neighbors_search/computation/inverseIndexStatistics.h','sparse_neighbors_search/computation/numaTopology.h','sparse_neighbors_search/computation/arena.h','sparse_neighbors_search/computation/sseExtension.h','sparse_neighbors_search/computation/avxExtension.h','sparse_neighbors_search/computation/hash.h']
+# instance ids are 32 bit, --largeindex switches to 64 bit for more than 2^32 instances
+large_index = False
+if "--largeindex" in sys.argv:
+    large_index = True
+    sys.argv.remove("--largeindex")
+# the arenas of the inverse index take their memory in huge pages with --hugepages
+huge_pages = False
+if "--hugepages" in sys.argv:
+    huge_pages = True
+    sys.argv.remove("--hugepages")
 openmp = True
 if "--openmp" in sys.argv:
     module1 = Extension('_nearestNeighbors', sources = sources_list, depends = depends_list,
-         define_macros=[('OPENMP', None)], extra_link_args = ["-lm", "-lrt","-lgomp"], 
-        extra_compile_args=["-fopenmp", "-O3", "-std=c++11", "-funroll-loops", "-msse4.1"])
+         define_macros=[('OPENMP', None)], extra_link_args = ["-lm", "-lrt","-lgomp", "-pthread"], 
+        extra_compile_args=["-fopenmp", "-O3", "-std=c++11", "-pthread", "-funroll-loops", "-msse4.1"])
 elif platform.system() == 'Darwin' or "--noopenmp" in sys.argv:
     module1 = Extension('_nearestNeighbors', sources = sources_list, depends = depends_list, 
-        extra_compile_args=["-O3", "-std=c++11", "-funroll-loops", "-msse4.1"])
+        extra_link_args = ["-pthread"], extra_compile_args=["-O3", "-std=c++11", "-pthread", "-funroll-loops", "-msse4.1"])
     openmp = False
 
 else:
     module1 = Extension('_nearestNeighbors', sources = sources_list, depends = depends_list,
-        define_macros=[('OPENMP', None)], extra_link_args = ["-lm", "-lrt","-lgomp"],
-         extra_compile_args=["-fopenmp", "-O3", "-std=c++11", "-funroll-loops", "-msse4.1"])
+        define_macros=[('OPENMP', None)], extra_link_args = ["-lm", "-lrt","-lgomp", "-pthread"],
+         extra_compile_args=["-fopenmp", "-O3", "-std=c++11", "-pthread", "-funroll-loops", "-msse4.1"])
+if large_index:
+    module1.define_macros.append(('LARGE_INDEX', None))
+if huge_pages:
+    module1.define_macros.append(('ARENA_HUGE_PAGES', None))
 no_cuda = False
 
 if "--nocuda" in sys.argv:
@@ -272,8 +288,8 @@ else:
                     define_macros=[('OPENMP', None), ('CUDA', None)],
                     # extra_link_args={'gcc': ["-lm", "-lrt","-lgomp"], 
                     #                   'nvcc' :[]  },
-                    extra_link_args=["-lm", "-lrt","-lgomp"],
-                    extra_compile_args={'gcc': ["-fopenmp", "-O3", "-std=c++11", "-funroll-loops", "-msse4.1"],
+                    extra_link_args=["-lm", "-lrt","-lgomp", "-pthread"],
+                    extra_compile_args={'gcc': ["-fopenmp", "-O3", "-std=c++11", "-pthread", "-funroll-loops", "-msse4.1"],
                                         'nvcc': ['-arch=sm_20', '--ptxas-options=-v', '-c', '--compiler-options', "'-fPIC'", '-std=c++11' ]},
                     include_dirs = [CUDA['include'], 'src'],#, '/home/joachim/Software/cub-1.5.1'],
                     platforms = "Linux, Mac OS X"
@@ -291,12 +307,16 @@ else:
                     define_macros=[('CUDA', None)],
                     # extra_link_args={'gcc': ["-lm", "-lrt","-lgomp"], 
                     #                   'nvcc' :[]  },
-                    extra_link_args=["-lm", "-lrt","-lgomp"],
-                    extra_compile_args={'gcc': ["-O3", "-std=c++11", "-msse4.1"],
+                    extra_link_args=["-lm", "-lrt","-lgomp", "-pthread"],
+                    extra_compile_args={'gcc': ["-O3", "-std=c++11", "-pthread", "-msse4.1"],
                                         'nvcc': ['-arch=sm_30', '--ptxas-options=-v', '-c', '--compiler-options', "'-fPIC'", '-std=c++11' ]},
                     include_dirs = [CUDA['include'], 'src'],#, '/home/joachim/Software/cub-1.5.1'],
                     platforms = "Linux, Mac OS X"
                     )
+    if large_index:
+        ext.define_macros.append(('LARGE_INDEX', None))
+    if huge_pages:
+        ext.define_macros.append(('ARENA_HUGE_PAGES', None))
                 
     setup(name='sparse_neighbors_search',
         # random metadata. there's more you can supploy
@@ -14,4 +14,5 @@ from neighbors.minHashClassifier import MinHashClassifier
 from neighbors.minHash import MinHash
 from neighbors.wtaHashClassifier import WtaHashClassifier
 from neighbors.wtaHash import WtaHash
+from neighbors.shardedNearestNeighbors import ShardedNearestNeighbors
 import cluster
@@ -0,0 +1,178 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#include <vector>
+#include <type_traits>
+#ifdef ARENA_HUGE_PAGES
+#include <sys/mman.h>
+#endif
+
+#ifndef ARENA_H
+#define ARENA_H
+
+// the first block of an arena, every further block is twice as large up to ARENA_MAX_BLOCK_SIZE
+#define ARENA_MIN_BLOCK_SIZE (64 * 1024)
+// a huge page on x86-64, with ARENA_HUGE_PAGES only the blocks of this size are mapped as huge pages
+#define ARENA_MAX_BLOCK_SIZE (2 * 1024 * 1024)
+// largest allocation served from the size classes, larger ones like the bucket arrays of big hash tables use malloc
+#define ARENA_MAX_SLAB_SIZE 4096
+// sizes in steps of 16 bytes up to 256 bytes, then 512, 1024, 2048 and 4096 bytes
+#define ARENA_NUMBER_OF_SIZE_CLASSES 20
+
+// memory for many small objects with the same owner, like the posting lists and map nodes of one hash function.
+// an allocation is rounded up to a size class and taken from the free list of the class or from the end of
+// the current block, a freed allocation goes to the free list of its class and is reused by the next one of the
+// same class. nothing is given back before the arena is deleted, then all blocks are released at once.
+// with ARENA_HUGE_PAGES the blocks of ARENA_MAX_BLOCK_SIZE are mapped as huge pages if the system has some,
+// transparent huge pages are requested for them otherwise. the smaller first blocks come from the heap, so the
+// arena of a small hash function does not take a whole huge page.
+// an arena is not thread safe, each one needs a single writer at a time.
+class Arena {
+  private:
+    std::vector<void*> mBlocks;
+    char* mPosition = NULL;
+    char* mEnd = NULL;
+    void* mFreeLists[ARENA_NUMBER_OF_SIZE_CLASSES];
+
+    static size_t getSizeClass(size_t pBytes) {
+        if (pBytes <= 256) return pBytes <= 16 ? 0 : (pBytes - 1) / 16;
+        size_t sizeClass = 16;
+        for (size_t size = 512; size < pBytes; size *= 2) {
+            ++sizeClass;
+        }
+        return sizeClass;
+    };
+    static size_t getClassSize(size_t pSizeClass) {
+        return pSizeClass < 16 ? (pSizeClass + 1) * 16 : static_cast<size_t>(512) << (pSizeClass - 16);
+    };
+    void* allocateBlock(size_t pSize) {
+#ifdef ARENA_HUGE_PAGES
+        if (pSize < ARENA_MAX_BLOCK_SIZE) return malloc(pSize);
+        void* block = mmap(NULL, pSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block == MAP_FAILED) {
+            block = mmap(NULL, pSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (block == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+            madvise(block, pSize, MADV_HUGEPAGE);
+#endif
+        }
+        return block;
+#else
+        return malloc(pSize);
+#endif
+    };
+    void releaseBlock(void* pBlock, size_t pSize) {
+#ifdef ARENA_HUGE_PAGES
+        if (pSize < ARENA_MAX_BLOCK_SIZE) {
+            free(pBlock);
+        } else {
+            munmap(pBlock, pSize);
+        }
+#else
+        (void) pSize;
+        free(pBlock);
+#endif
+    };
+    // size of block i, the sizes double from ARENA_MIN_BLOCK_SIZE
+    static size_t getBlockSize(size_t pBlock) {
+        size_t size = ARENA_MIN_BLOCK_SIZE;
+        for (size_t i = 0; i < pBlock && size < ARENA_MAX_BLOCK_SIZE; ++i) {
+            size *= 2;
+        }
+        return size;
+    };
+  public:
+    Arena() {
+        for (size_t i = 0; i < ARENA_NUMBER_OF_SIZE_CLASSES; ++i) {
+            mFreeLists[i] = NULL;
+        }
+    };
+    ~Arena() {
+        for (size_t i = 0; i < mBlocks.size(); ++i) {
+            releaseBlock(mBlocks[i], getBlockSize(i));
+        }
+    };
+    void* allocate(size_t pBytes) {
+        if (pBytes > ARENA_MAX_SLAB_SIZE) {
+            void* memory = malloc(pBytes);
+            if (memory == NULL) throw std::bad_alloc();
+            return memory;
+        }
+        const size_t sizeClass = getSizeClass(pBytes);
+        const size_t size = getClassSize(sizeClass);
+        if (mFreeLists[sizeClass] != NULL) {
+            void* memory = mFreeLists[sizeClass];
+            mFreeLists[sizeClass] = *static_cast<void**>(memory);
+            return memory;
+        }
+        if (mPosition + size > mEnd) {
+            // the rest of the current block is left unused
+            const size_t blockSize = getBlockSize(mBlocks.size());
+            void* block = allocateBlock(blockSize);
+            if (block == NULL) throw std::bad_alloc();
+            mBlocks.push_back(block);
+            mPosition = static_cast<char*>(block);
+            mEnd = mPosition + blockSize;
+        }
+        void* memory = mPosition;
+        mPosition += size;
+        return memory;
+    };
+    void deallocate(void* pMemory, size_t pBytes) {
+        if (pMemory == NULL) return;
+        if (pBytes > ARENA_MAX_SLAB_SIZE) {
+            free(pMemory);
+            return;
+        }
+        const size_t sizeClass = getSizeClass(pBytes);
+        *static_cast<void**>(pMemory) = mFreeLists[sizeClass];
+        mFreeLists[sizeClass] = pMemory;
+    };
+};
+
+// allocator for the standard containers that takes the memory from an arena. an allocator without
+// an arena uses the heap, so the same container type works with and without an arena.
+template <class T>
+class ArenaAllocator {
+  public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    template <class U> struct rebind { typedef ArenaAllocator<U> other; };
+    Arena* mArena;
+
+    ArenaAllocator() : mArena(NULL) { };
+    explicit ArenaAllocator(Arena* pArena) : mArena(pArena) { };
+    template <class U> ArenaAllocator(const ArenaAllocator<U>& pAllocator) : mArena(pAllocator.mArena) { };
+    T* allocate(size_t pNumberOfElements) {
+        if (mArena == NULL) return static_cast<T*>(::operator new(pNumberOfElements * sizeof(T)));
+        return static_cast<T*>(mArena->allocate(pNumberOfElements * sizeof(T)));
+    };
+    void deallocate(T* pMemory, size_t pNumberOfElements) {
+        if (mArena == NULL) {
+            ::operator delete(pMemory);
+            return;
+        }
+        mArena->deallocate(pMemory, pNumberOfElements * sizeof(T));
+    };
+};
+template <class T, class U>
+inline bool operator==(const ArenaAllocator<T>& pFirst, const ArenaAllocator<U>& pSecond) {
+    return pFirst.mArena == pSecond.mArena;
+}
+template <class T, class U>
+inline bool operator!=(const ArenaAllocator<T>& pFirst, const ArenaAllocator<U>& pSecond) {
+    return pFirst.mArena != pSecond.mArena;
+}
+#endif // ARENA_H
@@ -0,0 +1,67 @@
+// #include <xmmintrin.h>
+// #include <emmintrin.h>
+#include <immintrin.h>
+#include <stdint.h>
+#ifndef AVX_EXTENSION
+#define AVX_EXTENSION
+// 8 and 16 lane versions of the helpers in sseExtension.h. The code is compiled with -msse4.1 only,
+// every function carries its own target attribute and may only be called if the cpu supports it.
+
+__attribute__((target("avx2")))
+static inline __m256i _mm256_not_si256 (const __m256i &x) {
+    // Returns ~x, the bitwise complement of x:
+    return _mm256_xor_si256(x, _mm256_set1_epi32(-1));
+}
+
+// returns the changed armins if there is a new minHash value at position 0, .., 7
+// only lanes set in pMask can change; for full vectors pMask has all bits set
+__attribute__((target("avx2")))
+static inline __m256i _mm256_argmin_change_epi32 (const __m256i &pArgmin, const __m256i &pMinimumVector, const __m256i &pHashValue,
+                                                    const __m256i &pArgminValue, const __m256i &pMask) {
+    __m256i compareResult = _mm256_and_si256(_mm256_cmpeq_epi32(pMinimumVector, pHashValue), pMask);
+    return _mm256_blendv_epi8(pArgmin, pArgminValue, compareResult);
+}
+
+// hash values are compared unsigned; if several lanes hold the minimum the largest argmin wins
+__attribute__((target("avx2")))
+static inline uint32_t _mm256_get_argmin(const __m256i &pArgmin, const __m256i &pMinHashValues) {
+    __m128i minimum = _mm_min_epu32(_mm256_castsi256_si128(pMinHashValues), _mm256_extracti128_si256(pMinHashValues, 1));
+    minimum = _mm_min_epu32(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(1,0,3,2)));
+    minimum = _mm_min_epu32(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(2,3,0,1)));
+    __m256i compare = _mm256_broadcastd_epi32(minimum);
+    __m256i argmin = _mm256_and_si256(pArgmin, _mm256_cmpeq_epi32(pMinHashValues, compare));
+    __m128i maximum = _mm_max_epu32(_mm256_castsi256_si128(argmin), _mm256_extracti128_si256(argmin, 1));
+    maximum = _mm_max_epu32(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(1,0,3,2)));
+    maximum = _mm_max_epu32(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(2,3,0,1)));
+    return (uint32_t) _mm_cvtsi128_si32(maximum);
+}
+
+// running minimum and argmin for the seed-wise kernels; every lane belongs to a different seed
+// and ties go to the later, i.e. larger, feature as in the feature-wise kernels
+__attribute__((target("avx2")))
+static inline void _mm256_update_minimum_epi32 (__m256i &pArgmin, __m256i &pMinimumVector, const __m256i &pHashValue,
+                                                const __m256i &pArgminValue) {
+    pMinimumVector = _mm256_min_epu32(pHashValue, pMinimumVector);
+    pArgmin = _mm256_blendv_epi8(pArgmin, pArgminValue, _mm256_cmpeq_epi32(pMinimumVector, pHashValue));
+}
+
+// avx-512 has mask registers and reductions, the tail is handled with __mmask16.
+// the intrinsics of gcc start some results from an undefined vector, inlined they are reported as uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+static inline uint32_t _mm512_get_argmin(const __m512i &pArgmin, const __m512i &pMinHashValues) {
+    uint32_t minValue = _mm512_reduce_min_epu32(pMinHashValues);
+    __mmask16 compare = _mm512_cmpeq_epu32_mask(pMinHashValues, _mm512_set1_epi32(minValue));
+    return _mm512_mask_reduce_max_epu32(compare, pArgmin);
+}
+
+__attribute__((target("avx512f")))
+static inline void _mm512_update_minimum_epi32 (__m512i &pArgmin, __m512i &pMinimumVector, const __m512i &pHashValue,
+                                                const __m512i &pArgminValue) {
+    pMinimumVector = _mm512_min_epu32(pHashValue, pMinimumVector);
+    pArgmin = _mm512_mask_mov_epi32(pArgmin, _mm512_cmpeq_epu32_mask(pMinimumVector, pHashValue), pArgminValue);
+}
+#pragma GCC diagnostic pop
+#endif // AVX_EXTENSION
@@ -0,0 +1,101 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <algorithm>
+#include "typeDefinitionsBasic.h"
+
+#ifndef COLLISION_COUNTER_H
+#define COLLISION_COUNTER_H
+
+class sort_map {
+  public:
+    size_t key;
+    size_t val;
+};
+
+// a posting list of the query for hash function hashFunction
+struct listProbe {
+    size_t hashFunction;
+    postingList instances;
+};
+
+// counts the hash collisions of one query with the fitted instances. there is one counter per
+// instance, only the ones a query touched are reset afterwards, so the counters are kept and a
+// query does not allocate once the thread has seen an index of this size.
+class CollisionCounter {
+  private:
+    std::vector<uint32_t> mCounts;
+    // instances with a count > 0 in the order of their first collision
+    vinstanceId_t mTouched;
+    // start of every count in the sorted output
+    vsize_t mBucketStarts;
+  public:
+    // ids of the counted instances are smaller than pNumberOfInstances
+    void reserve(size_t pNumberOfInstances) {
+        if (mCounts.size() < pNumberOfInstances) {
+            mCounts.resize(pNumberOfInstances, 0);
+        }
+    };
+    // returns the count of pInstance after the collision
+    uint32_t add(instanceId_t pInstance) {
+        if (mCounts[pInstance]++ == 0) {
+            mTouched.push_back(pInstance);
+        }
+        return mCounts[pInstance];
+    };
+    uint32_t getCount(instanceId_t pInstance) const {
+        return mCounts[pInstance];
+    };
+    size_t size() const {
+        return mTouched.size();
+    };
+    // the touched instances by decreasing count into pSorted, equal counts in the order of the first
+    // collision. a counting sort: a count is at most the number of hash functions.
+    void sortAndReset(std::vector<sort_map>& pSorted) {
+        uint32_t maxCount = 0;
+        for (size_t i = 0; i < mTouched.size(); ++i) {
+            maxCount = std::max(maxCount, mCounts[mTouched[i]]);
+        }
+        // bucket i holds the count maxCount - i
+        mBucketStarts.assign(maxCount + 1, 0);
+        for (size_t i = 0; i < mTouched.size(); ++i) {
+            ++mBucketStarts[maxCount - mCounts[mTouched[i]]];
+        }
+        size_t start = 0;
+        for (size_t i = 0; i < mBucketStarts.size(); ++i) {
+            const size_t bucketSize = mBucketStarts[i];
+            mBucketStarts[i] = start;
+            start += bucketSize;
+        }
+        pSorted.resize(mTouched.size());
+        for (size_t i = 0; i < mTouched.size(); ++i) {
+            const instanceId_t instance = mTouched[i];
+            sort_map& element = pSorted[mBucketStarts[maxCount - mCounts[instance]]++];
+            element.key = instance;
+            element.val = mCounts[instance];
+            mCounts[instance] = 0;
+        }
+        mTouched.clear();
+    };
+};
+
+// the counter of the calling thread, shared by all indexes the thread queries
+inline CollisionCounter& getThreadCollisionCounter() {
+    static thread_local CollisionCounter counter;
+    return counter;
+}
+
+// a second counter of the calling thread for the hits of multi-probe, kept apart from the collisions
+inline CollisionCounter& getThreadProbeCounter() {
+    static thread_local CollisionCounter counter;
+    return counter;
+}
+#endif // COLLISION_COUNTER_H
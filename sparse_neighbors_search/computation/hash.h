@@ -1,5 +1,6 @@
 #include "typeDefinitions.h"
 #include "sseExtension.h"
+#include "avxExtension.h"
 
 #include <smmintrin.h>
 #include <functional>
@@ -57,7 +58,51 @@ class Hash {
         return keys;
 
     }
-    uint32_t size_tHashSimple(uint32_t key, uint32_t aModulo) {
+    // same hash as hash_SSE_priv on 8 keys
+    __attribute__((target("avx2")))
+    __m256i hash_AVX2_priv(__m256i keys) {
+        // multiplication of key * A in float
+        keys = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(keys), _mm256_set1_ps(A_float)));
+        // key = ~key + (key << 15);
+        keys = _mm256_add_epi32(_mm256_not_si256(keys), _mm256_slli_epi32(keys, 15));
+        // key = key ^ (key >> 12);
+        keys = _mm256_xor_si256(keys, _mm256_srli_epi32(keys, 12));
+        // key = key + (key << 2);
+        keys = _mm256_add_epi32(keys, _mm256_slli_epi32(keys, 2));
+        // key = key ^ (key >> 4);
+        keys = _mm256_xor_si256(keys, _mm256_srli_epi32(keys, 4));
+        // key = key * 2057;
+        keys = _mm256_mullo_epi32(keys, _mm256_set1_epi32(2057));
+        // key = key ^ (key >> 16);
+        keys = _mm256_xor_si256(keys, _mm256_srli_epi32(keys, 16));
+        return keys;
+    }
+    // the avx-512 intrinsics of gcc start some results from an undefined vector, inlined they are
+    // reported as uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    // same hash as hash_SSE_priv on 16 keys
+    __attribute__((target("avx512f")))
+    __m512i hash_AVX512_priv(__m512i keys) {
+        // multiplication of key * A in float
+        keys = _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_cvtepi32_ps(keys), _mm512_set1_ps(A_float)));
+        // key = ~key + (key << 15);
+        keys = _mm512_add_epi32(_mm512_xor_si512(keys, _mm512_set1_epi32(-1)), _mm512_slli_epi32(keys, 15));
+        // key = key ^ (key >> 12);
+        keys = _mm512_xor_si512(keys, _mm512_srli_epi32(keys, 12));
+        // key = key + (key << 2);
+        keys = _mm512_add_epi32(keys, _mm512_slli_epi32(keys, 2));
+        // key = key ^ (key >> 4);
+        keys = _mm512_xor_si512(keys, _mm512_srli_epi32(keys, 4));
+        // key = key * 2057;
+        keys = _mm512_mullo_epi32(keys, _mm512_set1_epi32(2057));
+        // key = key ^ (key >> 16);
+        keys = _mm512_xor_si512(keys, _mm512_srli_epi32(keys, 16));
+        return keys;
+    }
+#pragma GCC diagnostic pop
+    uint32_t size_tHashSimple(uint32_t key, uint32_t /* aModulo */) {
           // source:  Thomas Wang: Integer Hash Functions, 1997 / 2007 
           // https://gist.github.com/badboy/6267743
           key = key * A;
@@ -88,6 +133,16 @@ class Hash {
         return shortHashSimple(pKey * pSeed, pModulo);
     };
     
+    // integer finalizer of murmur3, used where many hash values are needed cheaply
+    uint32_t hashMix(uint32_t pKey, uint32_t pSeed) {
+        pKey ^= pSeed * 0x9e3779b9;
+        pKey ^= pKey >> 16;
+        pKey *= 0x85ebca6b;
+        pKey ^= pKey >> 13;
+        pKey *= 0xc2b2ae35;
+        pKey ^= pKey >> 16;
+        return pKey;
+    };
     size_t hash_cpp_lib(size_t pKey, size_t pSeed, size_t pModulo) {
         std::hash<size_t> hash_function;
         return hash_function(pKey*pSeed) % pModulo;
@@ -96,5 +151,15 @@ class Hash {
         pKeys = _mm_mullo_epi32(pKeys, pSeed);
         return hash_SSE_priv(pKeys);
     }
+    __attribute__((target("avx2")))
+    __m256i hash_AVX2(__m256i pKeys, __m256i pSeed) {
+        pKeys = _mm256_mullo_epi32(pKeys, pSeed);
+        return hash_AVX2_priv(pKeys);
+    }
+    __attribute__((target("avx512f")))
+    __m512i hash_AVX512(__m512i pKeys, __m512i pSeed) {
+        pKeys = _mm512_mullo_epi32(pKeys, pSeed);
+        return hash_AVX512_priv(pKeys);
+    }
 };
 #endif // HASH_H
\ No newline at end of file
@@ -0,0 +1,226 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "typeDefinitionsBasic.h"
+
+#ifndef INDEX_FILE_H
+#define INDEX_FILE_H
+
+// binary file of a fitted index: a header with the parameters and the position of every section, followed by
+// the sections. a section is a plain array aligned to INDEX_FILE_ALIGNMENT bytes, so a loaded index can use
+// it in place from a read-only memory mapping of the file. all processes mapping the same file share the pages.
+#define INDEX_FILE_MAGIC "SNSINDEX"
+#define INDEX_FILE_VERSION 9
+#define INDEX_FILE_ALIGNMENT 64
+
+enum indexFileSectionId {
+    // original data: feature ids, feature values, number of features per instance and the squared norms
+    SECTION_FEATURE_IDS = 0,
+    SECTION_FEATURE_VALUES,
+    SECTION_INSTANCE_SIZES,
+    SECTION_NORMS,
+    // signature storage: for every unique signature a row of the signature matrix, a marker if the
+    // signature exists, the signature id and the ids of the instances with this signature
+    SECTION_SIGNATURES,
+    SECTION_SIGNATURE_PRESENT,
+    SECTION_SIGNATURE_IDS,
+    SECTION_SIGNATURE_INSTANCE_OFFSETS,
+    SECTION_SIGNATURE_INSTANCES,
+    // csr inverse index of InverseIndexStorageFrozen, the postings are stream vbyte coded if the storage compresses them
+    SECTION_REMOVED_HASH_FUNCTIONS,
+    SECTION_KEYS,
+    SECTION_KEY_OFFSETS,
+    SECTION_POSTING_OFFSETS,
+    SECTION_POSTINGS,
+    // one byte per instance, not 0 if the instance is removed. empty if no instance was removed.
+    SECTION_REMOVED_INSTANCES,
+    // counters of InverseIndexStatistics, the distribution of a loaded index is read without walking the lists
+    SECTION_INVERSE_INDEX_STATISTICS,
+    NUMBER_OF_SECTIONS
+};
+
+struct indexFileSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// the arguments the NearestNeighbors object was created with
+struct indexFileParameters {
+    uint64_t numberOfHashFunctions;
+    uint64_t shingleSize;
+    uint64_t numberOfCores;
+    uint64_t chunkSize;
+    uint64_t maxBinSize;
+    uint64_t sizeOfNeighborhood;
+    uint64_t minimalBlocksInCommon;
+    uint64_t excessFactor;
+    uint64_t maximalNumberOfHashCollisions;
+    int64_t fast;
+    int64_t similarity;
+    int64_t pruneInverseIndex;
+    double pruneInverseIndexAfterInstance;
+    int64_t removeHashFunctionWithLessEntriesAs;
+    uint64_t hashAlgorithm;
+    uint64_t blockSize;
+    uint64_t shingle;
+    uint64_t removeValueWithLeastSigificantBit;
+    double cpuGpuLoadBalancing;
+    uint64_t gpuHash;
+    uint64_t rangeK_Wta;
+    uint64_t bitsPerHashValue;
+    uint64_t inverseIndexStorageType;
+    double compactionThreshold;
+    uint64_t numaReplication;
+    uint64_t candidateBudget;
+    uint64_t multiProbe;
+    uint64_t maxCandidates;
+    double collisionCutoff;
+    uint64_t queryCacheSize;
+};
+
+struct indexFileHeader {
+    char magic[8];
+    uint32_t version;
+    // width of the stored instance ids, a file written with LARGE_INDEX can only be read with LARGE_INDEX
+    uint32_t instanceIdBytes;
+    uint64_t numberOfInstances;
+    uint64_t maxNnz;
+    uint64_t doubleElementsStorageCount;
+    indexFileParameters parameters;
+    indexFileSection sections[NUMBER_OF_SECTIONS];
+};
+
+// writes the sections to pPath.tmp and renames it to pPath in close(). processes that have mapped an
+// older version of the file keep their pages.
+class IndexFileWriter {
+  private:
+    FILE* mFile = NULL;
+    std::string mPath;
+    indexFileHeader mHeader;
+    uint64_t mOffset = 0;
+    bool mFailed = false;
+    void pad() {
+        const char zeros[INDEX_FILE_ALIGNMENT] = {0};
+        const size_t padding = (INDEX_FILE_ALIGNMENT - mOffset % INDEX_FILE_ALIGNMENT) % INDEX_FILE_ALIGNMENT;
+        if (padding != 0 && fwrite(zeros, 1, padding, mFile) != padding) mFailed = true;
+        mOffset += padding;
+    };
+  public:
+    IndexFileWriter() {
+        memset(&mHeader, 0, sizeof(indexFileHeader));
+        memcpy(mHeader.magic, INDEX_FILE_MAGIC, 8);
+        mHeader.version = INDEX_FILE_VERSION;
+        mHeader.instanceIdBytes = sizeof(instanceId_t);
+    };
+    ~IndexFileWriter() {
+        if (mFile != NULL) {
+            fclose(mFile);
+            unlink((mPath + ".tmp").c_str());
+        }
+    };
+    bool open(const char* pPath) {
+        mPath = pPath;
+        mFile = fopen((mPath + ".tmp").c_str(), "wb");
+        if (mFile == NULL) return false;
+        // the header is written last, when the positions of the sections are known
+        mOffset = 0;
+        writeSection(NUMBER_OF_SECTIONS, &mHeader, sizeof(indexFileHeader));
+        return !mFailed;
+    };
+    indexFileHeader* getHeader() {
+        return &mHeader;
+    };
+    void writeSection(size_t pSection, const void* pData, size_t pBytes) {
+        pad();
+        if (pSection < NUMBER_OF_SECTIONS) {
+            mHeader.sections[pSection].offset = mOffset;
+            mHeader.sections[pSection].size = pBytes;
+        }
+        if (pBytes != 0 && fwrite(pData, 1, pBytes, mFile) != pBytes) mFailed = true;
+        mOffset += pBytes;
+    };
+    bool close() {
+        if (mFile == NULL) return false;
+        pad();
+        if (fseek(mFile, 0, SEEK_SET) != 0 || fwrite(&mHeader, sizeof(indexFileHeader), 1, mFile) != 1) mFailed = true;
+        if (fclose(mFile) != 0) mFailed = true;
+        mFile = NULL;
+        const std::string temporaryPath = mPath + ".tmp";
+        if (mFailed || rename(temporaryPath.c_str(), mPath.c_str()) != 0) {
+            unlink(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    };
+};
+
+// read-only mapping of an index file, the mapping lives as long as this object.
+// with pPopulate the whole file is read into the page cache and mapped while opening, otherwise the
+// pages are loaded on the first access.
+class MappedIndexFile {
+  private:
+    const uint8_t* mData = NULL;
+    size_t mSize = 0;
+  public:
+    ~MappedIndexFile() {
+        if (mData != NULL) munmap(const_cast<uint8_t*>(mData), mSize);
+    };
+    bool open(const char* pPath, bool pPopulate) {
+        int fileDescriptor = ::open(pPath, O_RDONLY);
+        if (fileDescriptor == -1) return false;
+        struct stat fileStatus;
+        if (fstat(fileDescriptor, &fileStatus) != 0 || static_cast<size_t>(fileStatus.st_size) < sizeof(indexFileHeader)) {
+            ::close(fileDescriptor);
+            return false;
+        }
+        int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+        if (pPopulate) flags |= MAP_POPULATE;
+#endif
+        void* data = mmap(NULL, fileStatus.st_size, PROT_READ, flags, fileDescriptor, 0);
+        ::close(fileDescriptor);
+        if (data == MAP_FAILED) return false;
+#ifndef MAP_POPULATE
+        if (pPopulate) madvise(data, fileStatus.st_size, MADV_WILLNEED);
+#endif
+        mData = static_cast<const uint8_t*>(data);
+        mSize = fileStatus.st_size;
+
+        const indexFileHeader* header = getHeader();
+        if (memcmp(header->magic, INDEX_FILE_MAGIC, 8) != 0 || header->version != INDEX_FILE_VERSION
+                || header->instanceIdBytes != sizeof(instanceId_t)) {
+            return false;
+        }
+        for (size_t i = 0; i < NUMBER_OF_SECTIONS; ++i) {
+            if (header->sections[i].offset > mSize || header->sections[i].size > mSize - header->sections[i].offset) {
+                return false;
+            }
+        }
+        return true;
+    };
+    const indexFileHeader* getHeader() const {
+        return reinterpret_cast<const indexFileHeader*>(mData);
+    };
+    const void* getSection(size_t pSection) const {
+        return mData + getHeader()->sections[pSection].offset;
+    };
+    size_t getSectionSize(size_t pSection) const {
+        return getHeader()->sections[pSection].size;
+    };
+};
+#endif // INDEX_FILE_H
@@ -15,7 +15,7 @@
 
 #include "../parsePythonToCpp.h"
 
-static neighborhood* neighborhoodComputation(size_t pNearestNeighborsAddress, PyObject* pInstancesListObj,
+static neighborhood neighborhoodComputation(size_t pNearestNeighborsAddress, PyObject* pInstancesListObj,
                                                 PyObject* pFeaturesListObj, PyObject* pDataListObj,
                                                 size_t pMaxNumberOfInstances, size_t pMaxNumberOfFeatures, 
                                                 size_t pNneighbors, int pFast, int pSimilarity, float pRadius = -1.0) {
@@ -27,14 +27,14 @@ static neighborhood* neighborhoodComputation(size_t pNearestNeighborsAddress, Py
     NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(pNearestNeighborsAddress);
 
     // compute the k-nearest neighbors
-    neighborhood* neighbors_ =  nearestNeighbors->kneighbors(originalDataMatrix, pNneighbors, pFast, pSimilarity, pRadius);
+    neighborhood neighbors_ =  nearestNeighbors->kneighbors(originalDataMatrix, pNneighbors, pFast, pSimilarity, pRadius);
     if (originalDataMatrix != NULL) {
         delete originalDataMatrix;    
     } 
     return neighbors_;
 }
 
-static neighborhood* fitNeighborhoodComputation(size_t pNearestNeighborsAddress, PyObject* pInstancesListObj,
+static neighborhood fitNeighborhoodComputation(size_t pNearestNeighborsAddress, PyObject* pInstancesListObj,
                                                 PyObject* pFeaturesListObj,PyObject* pDataListObj,
                                                 size_t pMaxNumberOfInstances, size_t pMaxNumberOfFeatures, 
                                                 size_t pNneighbors, int pFast, int pSimilarity, float pRadius = -1.0) {
@@ -46,7 +46,7 @@ static neighborhood* fitNeighborhoodComputation(size_t pNearestNeighborsAddress,
 
     nearestNeighbors->fit(originalDataMatrix);
     SparseMatrixFloat* emptyMatrix = NULL;
-    neighborhood* neighborhood_ = nearestNeighbors->kneighbors(emptyMatrix, pNneighbors, pFast, pSimilarity, pRadius);
+    neighborhood neighborhood_ = nearestNeighbors->kneighbors(emptyMatrix, pNneighbors, pFast, pSimilarity, pRadius);
     // delete emptyMatrix;
     return neighborhood_;
 }
@@ -55,17 +55,21 @@ static PyObject* createObject(PyObject* self, PyObject* args) {
     size_t numberOfHashFunctions, shingleSize, numberOfCores, chunkSize,
     nNeighbors, minimalBlocksInCommon, maxBinSize,
     maximalNumberOfHashCollisions, excessFactor, hashAlgorithm,
-     blockSize, shingle, removeValueWithLeastSigificantBit, gpu_hash, rangeK_Wta;
+     blockSize, shingle, removeValueWithLeastSigificantBit, gpu_hash, rangeK_Wta, bitsPerHashValue,
+     inverseIndexStorageType, numaReplication, candidateBudget, multiProbe, maxCandidates, queryCacheSize;
     int fast, similarity, pruneInverseIndex, removeHashFunctionWithLessEntriesAs;
-    float pruneInverseIndexAfterInstance, cpuGpuLoadBalancing;
+    float pruneInverseIndexAfterInstance, cpuGpuLoadBalancing, compactionThreshold, collisionCutoff;
     
-    if (!PyArg_ParseTuple(args, "kkkkkkkkkiiifikkkkfkk", &numberOfHashFunctions,
+    if (!PyArg_ParseTuple(args, "kkkkkkkkkiiifikkkkfkkkkfkkkkfk", &numberOfHashFunctions,
                         &shingleSize, &numberOfCores, &chunkSize, &nNeighbors,
                         &minimalBlocksInCommon, &maxBinSize,
                         &maximalNumberOfHashCollisions, &excessFactor, &fast, &similarity,
                         &pruneInverseIndex,&pruneInverseIndexAfterInstance, &removeHashFunctionWithLessEntriesAs,
                         &hashAlgorithm, &blockSize, &shingle, &removeValueWithLeastSigificantBit, 
-                        &cpuGpuLoadBalancing, &gpu_hash, &rangeK_Wta))
+                        &cpuGpuLoadBalancing, &gpu_hash, &rangeK_Wta, &bitsPerHashValue,
+                        &inverseIndexStorageType, &compactionThreshold, &numaReplication,
+                        &candidateBudget, &multiProbe, &maxCandidates, &collisionCutoff,
+                        &queryCacheSize))
         return NULL;
     NearestNeighbors* nearestNeighbors;
     nearestNeighbors = new NearestNeighbors (numberOfHashFunctions, shingleSize, numberOfCores, chunkSize,
@@ -73,7 +77,10 @@ static PyObject* createObject(PyObject* self, PyObject* args) {
                         excessFactor, maximalNumberOfHashCollisions, fast, similarity, pruneInverseIndex,
                         pruneInverseIndexAfterInstance, removeHashFunctionWithLessEntriesAs, 
                         hashAlgorithm, blockSize, shingle, removeValueWithLeastSigificantBit,
-                        cpuGpuLoadBalancing, gpu_hash, rangeK_Wta);
+                        cpuGpuLoadBalancing, gpu_hash, rangeK_Wta, bitsPerHashValue,
+                        inverseIndexStorageType, compactionThreshold, numaReplication,
+                        candidateBudget, multiProbe, maxCandidates, collisionCutoff,
+                        queryCacheSize);
 
     size_t adressNearestNeighborsObject = reinterpret_cast<size_t>(nearestNeighbors);
     PyObject* pointerToInverseIndex = Py_BuildValue("k", adressNearestNeighborsObject);
@@ -138,16 +145,58 @@ static PyObject* partialFit(PyObject* self, PyObject* args) {
     // get pointer to the minhash object
     NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
     size_t numberOfInstancesOld = nearestNeighbors->getOriginalData()->size();
+    // the inverse index is extended first, the data stays untouched if that fails
+    if (!nearestNeighbors->partialFit(originalDataMatrix, numberOfInstancesOld)) {
+        delete originalDataMatrix;
+        PyErr_SetString(PyExc_ValueError, "Extending the index failed. inverse_index_storage 4 can not be "
+                                          "extended after the first fit.");
+        return NULL;
+    }
+    // the new rows are copied into the original data, originalDataMatrix is deleted by it
     nearestNeighbors->getOriginalData()->addNewInstancesPartialFit(originalDataMatrix);
-    nearestNeighbors->set_mOriginalData(originalDataMatrix);
-
-    nearestNeighbors->partialFit(originalDataMatrix, numberOfInstancesOld);
 
     addressNearestNeighborsObject = reinterpret_cast<size_t>(nearestNeighbors);
     PyObject * pointerToInverseIndex = Py_BuildValue("k", addressNearestNeighborsObject);
     
     return pointerToInverseIndex;
 }
+static PyObject* removeInstances(PyObject* self, PyObject* args) {
+    size_t addressNearestNeighborsObject;
+    PyObject* instanceIdsListObj;
+
+    if (!PyArg_ParseTuple(args, "O!k", &PyList_Type, &instanceIdsListObj, &addressNearestNeighborsObject))
+        return NULL;
+
+    NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
+    nearestNeighbors->remove(parseInstanceIds(instanceIdsListObj));
+    return Py_BuildValue("i", 0);
+}
+static PyObject* updateInstances(PyObject* self, PyObject* args) {
+    size_t addressNearestNeighborsObject, maxNumberOfInstances, maxNumberOfFeatures;
+    PyObject* instanceIdsListObj, *instancesListObj, *featuresListObj, *dataListObj;
+
+    if (!PyArg_ParseTuple(args, "O!O!O!O!kkk",
+                            &PyList_Type, &instanceIdsListObj,
+                            &PyList_Type, &instancesListObj,
+                            &PyList_Type, &featuresListObj,
+                            &PyList_Type, &dataListObj,
+                            &maxNumberOfInstances,
+                            &maxNumberOfFeatures,
+                            &addressNearestNeighborsObject))
+        return NULL;
+
+    SparseMatrixFloat* dataMatrix = parseRawData(instancesListObj, featuresListObj, dataListObj,
+                                                    maxNumberOfInstances, maxNumberOfFeatures);
+    NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
+    const bool updated = nearestNeighbors->update(parseInstanceIds(instanceIdsListObj), dataMatrix);
+    delete dataMatrix;
+    if (!updated) {
+        PyErr_SetString(PyExc_ValueError, "Updating failed. The ids must be distinct ids of fitted instances "
+                                          "and inverse_index_storage 4 can not be updated after the first fit.");
+        return NULL;
+    }
+    return Py_BuildValue("i", 0);
+}
 static PyObject* kneighbors(PyObject* self, PyObject* args) {
     
     size_t addressNearestNeighborsObject, nNeighbors, maxNumberOfInstances,
@@ -166,7 +215,7 @@ static PyObject* kneighbors(PyObject* self, PyObject* args) {
         return NULL;
 
     // compute the k-nearest neighbors
-    neighborhood* neighborhood_ = neighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
+    neighborhood neighborhood_ = neighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
                                                 maxNumberOfInstances, maxNumberOfFeatures, nNeighbors, fast, similarity);
 
     size_t cutFirstValue = 0;
@@ -181,6 +230,108 @@ static PyObject* kneighbors(PyObject* self, PyObject* args) {
     return bringNeighborhoodInShape(neighborhood_, nNeighbors, cutFirstValue, returnDistance);
 }
 
+// signatures of the given instances as a string of maxNumberOfInstances rows of hash values and their signature
+// ids as a second string. the coordinator of a sharded index computes them once and sends them to the shards,
+// see kneighbors_signatures and kneighbors_fast_signatures.
+static PyObject* computeSignatures(PyObject* self, PyObject* args) {
+    size_t addressNearestNeighborsObject, maxNumberOfInstances, maxNumberOfFeatures;
+    PyObject* instancesListObj, *featuresListObj, *dataListObj;
+
+    if (!PyArg_ParseTuple(args, "O!O!O!kkk", 
+                        &PyList_Type, &instancesListObj,
+                        &PyList_Type, &featuresListObj,  
+                        &PyList_Type, &dataListObj,
+                        &maxNumberOfInstances,
+                        &maxNumberOfFeatures,
+                        &addressNearestNeighborsObject))
+        return NULL;
+
+    NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
+    SparseMatrixFloat* rawData = parseRawData(instancesListObj, featuresListObj, dataListObj, 
+                                                    maxNumberOfInstances, maxNumberOfFeatures);
+    SignatureMatrix* signatures = nearestNeighbors->computeSignatures(rawData);
+    const vsize_t signatureIds = nearestNeighbors->computeSignatureIds(rawData);
+    PyObject* result = Py_BuildValue("(s#s#)", reinterpret_cast<const char*>(signatures->getSignature(0)),
+                                        static_cast<int>(signatures->size() * signatures->getWidth() * sizeof(hashValue_t)),
+                                        reinterpret_cast<const char*>(signatureIds.data()),
+                                        static_cast<int>(signatureIds.size() * sizeof(size_t)));
+    delete signatures;
+    delete rawData;
+    return result;
+}
+
+// like kneighbors, but the signatures of the query instances are given by compute_signatures
+static PyObject* kneighborsSignatures(PyObject* self, PyObject* args) {
+    size_t addressNearestNeighborsObject, nNeighbors, maxNumberOfInstances,
+            maxNumberOfFeatures, returnDistance;
+    int fast, similarity;
+    const char* signaturesString;
+    int signaturesLength;
+    PyObject* instancesListObj, *featuresListObj, *dataListObj;
+
+    if (!PyArg_ParseTuple(args, "s#O!O!O!kkkkiik", 
+                        &signaturesString, &signaturesLength,
+                        &PyList_Type, &instancesListObj,
+                        &PyList_Type, &featuresListObj,  
+                        &PyList_Type, &dataListObj,
+                        &maxNumberOfInstances,
+                        &maxNumberOfFeatures,
+                        &nNeighbors, &returnDistance,
+                        &fast, &similarity, &addressNearestNeighborsObject))
+        return NULL;
+
+    NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
+    if (maxNumberOfInstances == 0 || static_cast<size_t>(signaturesLength) != 
+                maxNumberOfInstances * nearestNeighbors->getSignatureWidth() * sizeof(hashValue_t)) {
+        PyErr_SetString(PyExc_ValueError, "The signatures do not fit the instances or were computed with other parameters.");
+        return NULL;
+    }
+    SparseMatrixFloat* rawData = parseRawData(instancesListObj, featuresListObj, dataListObj, 
+                                                    maxNumberOfInstances, maxNumberOfFeatures);
+    // the string is only read, the matrix is a view of it
+    SignatureMatrix signatures(reinterpret_cast<const hashValue_t*>(signaturesString), maxNumberOfInstances,
+                                nearestNeighbors->getSignatureWidth());
+    neighborhood neighborhood_ = nearestNeighbors->kneighbors(rawData, nNeighbors, fast, similarity, -1.0, &signatures);
+    delete rawData;
+    if (nNeighbors == 0) {
+        nNeighbors = nearestNeighbors->getNneighbors();
+    }
+
+    return bringNeighborhoodInShape(neighborhood_, nNeighbors, 0, returnDistance);
+}
+
+// the fast neighbors of queries given only by the signatures and signature ids of compute_signatures
+static PyObject* kneighborsFastSignatures(PyObject* self, PyObject* args) {
+    size_t addressNearestNeighborsObject, nNeighbors;
+    const char* signaturesString, *signatureIdsString;
+    int signaturesLength, signatureIdsLength;
+
+    if (!PyArg_ParseTuple(args, "s#s#kk",
+                        &signaturesString, &signaturesLength,
+                        &signatureIdsString, &signatureIdsLength,
+                        &nNeighbors, &addressNearestNeighborsObject))
+        return NULL;
+
+    NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
+    const size_t numberOfInstances = signatureIdsLength / sizeof(size_t);
+    if (numberOfInstances == 0 || static_cast<size_t>(signatureIdsLength) != numberOfInstances * sizeof(size_t)
+            || static_cast<size_t>(signaturesLength) != numberOfInstances * nearestNeighbors->getSignatureWidth() * sizeof(hashValue_t)) {
+        PyErr_SetString(PyExc_ValueError, "The signatures do not fit the signature ids or were computed with other parameters.");
+        return NULL;
+    }
+    // the strings are only read, the matrix is a view of them
+    SignatureMatrix signatures(reinterpret_cast<const hashValue_t*>(signaturesString), numberOfInstances,
+                                nearestNeighbors->getSignatureWidth());
+    const size_t* signatureIds = reinterpret_cast<const size_t*>(signatureIdsString);
+    neighborhood neighborhood_ = nearestNeighbors->kneighbors(&signatures, vsize_t(signatureIds, signatureIds + numberOfInstances),
+                                                                nNeighbors);
+    if (nNeighbors == 0) {
+        nNeighbors = nearestNeighbors->getNneighbors();
+    }
+
+    return bringNeighborhoodInShape(neighborhood_, nNeighbors, 0, 1);
+}
+
 static PyObject* kneighborsGraph(PyObject* self, PyObject* args) {
     size_t addressNearestNeighborsObject, nNeighbors, maxNumberOfInstances,
             maxNumberOfFeatures, returnDistance, symmetric;
@@ -197,7 +348,7 @@ static PyObject* kneighborsGraph(PyObject* self, PyObject* args) {
                         &fast, &symmetric, &similarity, &addressNearestNeighborsObject))
         return NULL;
     // compute the k-nearest neighbors
-    neighborhood* neighborhood_ = neighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
+    neighborhood neighborhood_ = neighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
                                                 maxNumberOfInstances, maxNumberOfFeatures, nNeighbors, fast, similarity);
     if (nNeighbors == 0) {
         NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
@@ -222,7 +373,7 @@ static PyObject* radiusNeighbors(PyObject* self, PyObject* args) {
                         &fast,&similarity, &addressNearestNeighborsObject))
         return NULL;
     // compute the k-nearest neighbors
-    neighborhood* neighborhood_ = neighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
+    neighborhood neighborhood_ = neighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
                                                 maxNumberOfInstances, maxNumberOfFeatures, MAX_VALUE, fast, similarity, radius);
     size_t cutFirstValue = 0;
     if (PyList_Size(instancesListObj) == 0) {
@@ -247,7 +398,7 @@ static PyObject* radiusNeighborsGraph(PyObject* self, PyObject* args) {
                         &fast, &symmetric, &similarity, &addressNearestNeighborsObject))
         return NULL;
     // compute the k-nearest neighbors
-    neighborhood* neighborhood_ = neighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
+    neighborhood neighborhood_ = neighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
                                                 maxNumberOfInstances, maxNumberOfFeatures, MAX_VALUE, fast, similarity, radius);
     return radiusNeighborhoodGraph(neighborhood_, radius, returnDistance, symmetric); 
 }
@@ -269,7 +420,7 @@ static PyObject* fitKneighbors(PyObject* self, PyObject* args) {
                             &addressNearestNeighborsObject))
         return NULL;
 
-    neighborhood* neighborhood_ = fitNeighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
+    neighborhood neighborhood_ = fitNeighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
                                                    maxNumberOfInstances, maxNumberOfFeatures, nNeighbors, fast, similarity);
     size_t cutFirstValue = 1;
     if (nNeighbors == 0) {
@@ -296,7 +447,7 @@ static PyObject* fitKneighborsGraph(PyObject* self, PyObject* args) {
                             &addressNearestNeighborsObject))
         return NULL;
 
-    neighborhood* neighborhood_ = fitNeighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
+    neighborhood neighborhood_ = fitNeighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
                                                    maxNumberOfInstances, maxNumberOfFeatures, nNeighbors, fast, similarity);
     if (nNeighbors == 0) {
         NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
@@ -323,7 +474,7 @@ static PyObject* fitRadiusNeighbors(PyObject* self, PyObject* args) {
                             &addressNearestNeighborsObject))
         return NULL;
 
-    neighborhood* neighborhood_ = fitNeighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
+    neighborhood neighborhood_ = fitNeighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
                                                    maxNumberOfInstances, maxNumberOfFeatures, MAX_VALUE, fast, similarity, radius); 
     size_t cutFirstValue = 1;
     return radiusNeighborhood(neighborhood_, radius, cutFirstValue, returnDistance); 
@@ -346,7 +497,7 @@ static PyObject* fitRadiusNeighborsGraph(PyObject* self, PyObject* args) {
                             &addressNearestNeighborsObject))
         return NULL;
 
-    neighborhood* neighborhood_ = fitNeighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
+    neighborhood neighborhood_ = fitNeighborhoodComputation(addressNearestNeighborsObject, instancesListObj, featuresListObj, dataListObj, 
                                                    maxNumberOfInstances, maxNumberOfFeatures, MAX_VALUE, fast, similarity, radius);
     return radiusNeighborhoodGraph(neighborhood_, radius, returnDistance, symmetric); 
 }
@@ -361,14 +512,69 @@ static PyObject* getDistributionOfInverseIndex(PyObject* self, PyObject* args) {
     NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
 
     distributionInverseIndex* distribution = nearestNeighbors->getDistributionOfInverseIndex();
+    PyObject* result = parseDistributionOfInverseIndex(distribution);
+    delete distribution;
+    return result;
+}
+static PyObject* getCandidateFilterStatistics(PyObject* self, PyObject* args) {
+    size_t addressNearestNeighborsObject;
+    int reset;
+
+    if (!PyArg_ParseTuple(args, "ki", &addressNearestNeighborsObject, &reset))
+        return NULL;
+
+    NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
+    return parseCandidateFilterStatistics(nearestNeighbors->getCandidateFilterStatistics(reset != 0));
+}
+static PyObject* getQueryCacheStatistics(PyObject* self, PyObject* args) {
+    size_t addressNearestNeighborsObject;
+    int reset;
+
+    if (!PyArg_ParseTuple(args, "ki", &addressNearestNeighborsObject, &reset))
+        return NULL;
+
+    NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
+    return parseQueryCacheStatistics(nearestNeighbors->getQueryCacheStatistics(reset != 0));
+}
+static PyObject* save(PyObject* self, PyObject* args) {
+    size_t addressNearestNeighborsObject;
+    const char* path;
 
-    return parseDistributionOfInverseIndex(distribution);
+    if (!PyArg_ParseTuple(args, "sk", &path, &addressNearestNeighborsObject))
+        return NULL;
+
+    NearestNeighbors* nearestNeighbors = reinterpret_cast<NearestNeighbors* >(addressNearestNeighborsObject);
+    if (!nearestNeighbors->save(path)) {
+        PyErr_SetString(PyExc_IOError, "Writing the index file failed. Saving needs a fitted object with inverse_index_storage 2 or 3.");
+        return NULL;
+    }
+    return Py_BuildValue("i", 0);
+}
+static PyObject* load(PyObject* self, PyObject* args) {
+    const char* path;
+    int populate;
+
+    if (!PyArg_ParseTuple(args, "si", &path, &populate))
+        return NULL;
+
+    NearestNeighbors* nearestNeighbors = NearestNeighbors::load(path, populate != 0);
+    if (nearestNeighbors == NULL) {
+        PyErr_SetString(PyExc_IOError, "The file is not a valid index file.");
+        return NULL;
+    }
+    size_t adressNearestNeighborsObject = reinterpret_cast<size_t>(nearestNeighbors);
+    return Py_BuildValue("kk", adressNearestNeighborsObject, nearestNeighbors->getOriginalData()->size());
 }
 // definition of avaible functions for python and which function parsing fucntion in c++ should be called.
 static PyMethodDef nearestNeighborsFunctions[] = {
     {"fit", fit, METH_VARARGS, "Calculate the inverse index for the given instances."},
     {"partial_fit", partialFit, METH_VARARGS, "Extend the inverse index with the given instances."},
+    {"remove", removeInstances, METH_VARARGS, "Remove instances from the index."},
+    {"update", updateInstances, METH_VARARGS, "Replace instances of the index."},
     {"kneighbors", kneighbors, METH_VARARGS, "Calculate k-nearest neighbors."},
+    {"compute_signatures", computeSignatures, METH_VARARGS, "Calculate the signatures and signature ids of the given instances."},
+    {"kneighbors_signatures", kneighborsSignatures, METH_VARARGS, "Calculate k-nearest neighbors with given signatures."},
+    {"kneighbors_fast_signatures", kneighborsFastSignatures, METH_VARARGS, "Calculate fast k-nearest neighbors with given signatures and signature ids."},
     {"kneighbors_graph", kneighborsGraph, METH_VARARGS, "Calculate k-nearest neighbors as a graph."},
     {"radius_neighbors", radiusNeighbors, METH_VARARGS, "Calculate the neighbors inside a given radius."},
     {"radius_neighbors_graph", radiusNeighborsGraph, METH_VARARGS, "Calculate the neighbors inside a given radius as a graph."},
@@ -379,6 +585,10 @@ static PyMethodDef nearestNeighborsFunctions[] = {
     {"create_object", createObject, METH_VARARGS, "Create the c++ object."},
     {"delete_object", deleteObject, METH_VARARGS, "Delete the c++ object by calling the destructor."},
     {"get_distribution_of_inverse_index", getDistributionOfInverseIndex, METH_VARARGS, "Get the distribution of the inverse index."},
+    {"get_candidate_filter_statistics", getCandidateFilterStatistics, METH_VARARGS, "Get the counters of the candidate filter."},
+    {"get_query_cache_statistics", getQueryCacheStatistics, METH_VARARGS, "Get the counters of the query cache."},
+    {"save", save, METH_VARARGS, "Write the fitted object to an index file."},
+    {"load", load, METH_VARARGS, "Create the c++ object from an index file."},
     
     {NULL, NULL, 0, NULL}
 };
@@ -22,17 +22,10 @@
 #include <stdlib.h>
 #include <time.h>
 #include "inverseIndex.h"
-#include "kSizeSortedMap.h"
+#include "kSizeSortedArray.h"
+#include "collisionCounter.h"
+#include "workSchedule.h"
 #include "sseExtension.h"
-class sort_map {
-  public:
-    size_t key;
-    size_t val;
-};
-
-bool mapSortDescByValue(const sort_map& a, const sort_map& b) {
-        return a.val > b.val;
-};
 InverseIndex::InverseIndex(){};
 InverseIndex::InverseIndex(size_t pNumberOfHashFunctions, size_t pShingleSize,
                     size_t pNumberOfCores, size_t pChunkSize,
@@ -42,7 +35,11 @@ InverseIndex::InverseIndex(size_t pNumberOfHashFunctions, size_t pShingleSize,
                     int pRemoveHashFunctionWithLessEntriesAs, size_t pHashAlgorithm,
                     size_t pBlockSize, size_t pShingle,
                     size_t pRemoveValueWithLeastSigificantBit,
-                    float pCpuGpuLoadBalancing, size_t pGpuHash, size_t pRangeK_Wta) {   
+                    float pCpuGpuLoadBalancing, size_t pGpuHash, size_t pRangeK_Wta,
+                    size_t pBitsPerHashValue, size_t pInverseIndexStorageType,
+                    float pCompactionThreshold, size_t pNumaReplication,
+                    size_t pCandidateBudget, size_t pMultiProbe,
+                    size_t pMaxCandidates, float pCollisionCutoff) {   
     mNumberOfHashFunctions = pNumberOfHashFunctions;
     mShingleSize = pShingleSize;
     mNumberOfCores = pNumberOfCores;
@@ -55,13 +52,31 @@ InverseIndex::InverseIndex(size_t pNumberOfHashFunctions, size_t pShingleSize,
     mPruneInverseIndexAfterInstance = pPruneInverseIndexAfterInstance;
     mRemoveHashFunctionWithLessEntriesAs = pRemoveHashFunctionWithLessEntriesAs;
     mHashAlgorithm = pHashAlgorithm;
-    mSignatureStorage = new umap_uniqueElement();
+    // the instance lists of the unique signatures and the nodes of their id map are allocated from one arena
+    mSignatureArena = new Arena();
+    mSignatureStorage = new SignatureBatch(mSignatureArena);
     mHash = new Hash();
     mBlockSize = pBlockSize;
     mShingle = pShingle;
     mCpuGpuLoadBalancing = pCpuGpuLoadBalancing;
     mRangeK_Wta = pRangeK_Wta;
     mGpuHash = pGpuHash;
+    // the values of one hash function must not cross a word boundary
+    if (pBitsPerHashValue == 1 || pBitsPerHashValue == 2 || pBitsPerHashValue == 4 
+            || pBitsPerHashValue == 8 || pBitsPerHashValue == 16) {
+        mBitsPerHashValue = pBitsPerHashValue;
+    } else {
+        mBitsPerHashValue = 0;
+    }
+    // choose the signature kernel once at runtime
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        mSimdLevel = 2;
+    } else if (__builtin_cpu_supports("avx2")) {
+        mSimdLevel = 1;
+    } else {
+        mSimdLevel = 0;
+    }
     if (mShingle == 0) {
         if (mBlockSize == 0) {
             mBlockSize = 1;
@@ -73,8 +88,25 @@ InverseIndex::InverseIndex(size_t pNumberOfHashFunctions, size_t pShingleSize,
         mInverseIndexSize = ceil(((float) (mNumberOfHashFunctions * mBlockSize) / (float) mShingleSize));
     }
     
-    mInverseIndexStorage = new InverseIndexStorageUnorderedMap(mInverseIndexSize, mMaxBinSize);
+    // values per signature and words per row of the signature matrix
+    mSignatureSize = mShingle ? mInverseIndexSize : mNumberOfHashFunctions * mBlockSize;
+    if (mBitsPerHashValue == 0) {
+        mSignatureWidth = mSignatureSize;
+    } else {
+        mSignatureWidth = (mSignatureSize * mBitsPerHashValue + 31) / 32;
+    }
+    mInverseIndexStorageType = pInverseIndexStorageType;
+    mNumaReplication = pNumaReplication;
+    mInverseIndexStorage = createInverseIndexStorage();
     mRemoveValueWithLeastSigificantBit = pRemoveValueWithLeastSigificantBit;
+    mCompactionThreshold = pCompactionThreshold;
+    mCandidateBudget = pCandidateBudget;
+    mMultiProbe = pMultiProbe;
+    mMaxCandidates = pMaxCandidates;
+    mCollisionCutoff = pCollisionCutoff;
+    for (size_t i = 0; i < NUMBER_OF_FILTER_COUNTERS; ++i) {
+        mCandidateFilterCounters[i].store(0, std::memory_order_relaxed);
+    }
     #ifdef CUDA
     mInverseIndexCuda = new InverseIndexCuda(pNumberOfHashFunctions, mShingle,
                                              mShingleSize, mBlockSize, 
@@ -83,168 +115,778 @@ InverseIndex::InverseIndex(size_t pNumberOfHashFunctions, size_t pShingleSize,
 }
  
 InverseIndex::~InverseIndex() {
-    for (auto it = mSignatureStorage->begin(); it != mSignatureStorage->end(); ++it) {
-            delete (*it).second.instances;
-            delete (*it).second.signature;
-    }
+    waitForCompaction();
     delete mSignatureStorage;
+    delete mSignatureArena;
+    for (size_t i = 0; i < mSignatureMatrices.size(); ++i) {
+        delete mSignatureMatrices[i];
+    }
     delete mHash;
     delete mInverseIndexStorage;
 } 
 
+// 0: one std::unordered_map per hash function, 1: open addressing tables with inline posting lists,
+// 2: read-only csr layout built after every fit, 3: as 2 with delta and stream vbyte coded posting lists,
+// 4: read-only bloomier filter without stored hash values, built once at the end of the first fit.
+// the read-only csr layouts can be copied to every numa node of the machine.
+InverseIndexStorage* InverseIndex::createInverseIndexStorage() const {
+    if (mInverseIndexStorageType == 1) {
+        return new InverseIndexStorageFlatHashMap(mInverseIndexSize, mMaxBinSize);
+    } else if (mInverseIndexStorageType == 2 || mInverseIndexStorageType == 3) {
+        return new InverseIndexStorageFrozen(mInverseIndexSize, mMaxBinSize, mNumberOfCores,
+                                             mInverseIndexStorageType == 3, mNumaReplication);
+    } else if (mInverseIndexStorageType == 4) {
+        return new InverseIndexStorageBloomierFilter(mInverseIndexSize, mMaxBinSize, mNumberOfCores);
+    }
+    return new InverseIndexStorageUnorderedMap(mInverseIndexSize, mMaxBinSize);
+}
+
+// a running compaction does not change the inverse index in use, its counters are safe to read
 distributionInverseIndex* InverseIndex::getDistribution() {
+    applyChanges();
     return mInverseIndexStorage->getDistribution();
 }
 
+// the counters are read without a lock, during queries they can be from before or after a query
+candidateFilterStatistics InverseIndex::getCandidateFilterStatistics(bool pReset) {
+    uint64_t counters[NUMBER_OF_FILTER_COUNTERS];
+    for (size_t i = 0; i < NUMBER_OF_FILTER_COUNTERS; ++i) {
+        if (pReset) {
+            counters[i] = mCandidateFilterCounters[i].exchange(0, std::memory_order_relaxed);
+        } else {
+            counters[i] = mCandidateFilterCounters[i].load(std::memory_order_relaxed);
+        }
+    }
+    candidateFilterStatistics statistics;
+    statistics.numberOfQueries = counters[FILTER_QUERIES];
+    statistics.numberOfCandidates = counters[FILTER_CANDIDATES];
+    statistics.numberOfSingleCollisionCandidates = counters[FILTER_SINGLE_COLLISION];
+    statistics.numberOfRemovedByMinimalBlocksInCommon = counters[FILTER_MINIMAL_BLOCKS];
+    statistics.numberOfRemovedByCollisionCutoff = counters[FILTER_COLLISION_CUTOFF];
+    statistics.numberOfRemovedByLimit = counters[FILTER_LIMIT];
+    statistics.numberOfPassedCandidates = counters[FILTER_PASSED];
+    return statistics;
+}
+
+void InverseIndex::waitForCompaction() {
+    if (mCompactionThread.joinable()) {
+        mCompactionThread.join();
+    }
+    installCompaction();
+}
+
+void InverseIndex::applyChanges() {
+    installCompaction();
+    if (mFreezePending) {
+        mInverseIndexStorage->freeze();
+        mFreezePending = false;
+    }
+}
+
+// build the inverse index of all instances that are not in mCompactedInstances from their signatures, as a fit
+// of them would. it only reads mSignatureStorage, fit and update wait for the compaction before they change it.
+void InverseIndex::compact() {
+    const size_t numberOfInstances = getNumberOfInstances();
+    std::vector<const hashValue_t*> signatures(numberOfInstances, NULL);
+    for (size_t i = 0; i < mSignatureStorage->size(); ++i) {
+        const uniqueElement& element = mSignatureStorage->getElement(i);
+        for (size_t j = 0; j < element.instances.size(); ++j) {
+            if (!isRemovedInstance(mCompactedInstances, element.instances[j])) {
+                signatures[element.instances[j]] = element.signature;
+            }
+        }
+    }
+    InverseIndexStorage* inverseIndexStorage = createInverseIndexStorage();
+    inverseIndexStorage->reserveSpaceForMaps(numberOfInstances);
+    const size_t numberOfHashFunctions = inverseIndexStorage->size();
+#pragma omp parallel for schedule(dynamic) num_threads(mNumberOfCores)
+    for (size_t j = 0; j < numberOfHashFunctions; ++j) {
+        for (size_t i = 0; i < numberOfInstances; ++i) {
+            if (j >= getSignatureSize(signatures[i])) continue;
+            inverseIndexStorage->insert(j, getSignatureValue(signatures[i], j), i, mRemoveValueWithLeastSigificantBit);
+        }
+    }
+    if (mPruneInverseIndex > -1) {
+        inverseIndexStorage->prune(mPruneInverseIndex);
+    }
+    if (mRemoveHashFunctionWithLessEntriesAs > -1) {
+        inverseIndexStorage->removeHashFunctionWithLessEntriesAs(mRemoveHashFunctionWithLessEntriesAs);
+    }
+    inverseIndexStorage->freeze();
+    mCompactedStorage.store(inverseIndexStorage, std::memory_order_release);
+}
+
+// the old inverse index is replaced by the compacted one. it holds all updates, they were done before the
+// compaction started. instances removed during the compaction are still in its lists.
+void InverseIndex::installCompaction() {
+    InverseIndexStorage* compactedStorage = mCompactedStorage.exchange(NULL, std::memory_order_acquire);
+    if (compactedStorage == NULL) return;
+    // the thread ends right after it published the inverse index
+    if (mCompactionThread.joinable()) {
+        mCompactionThread.join();
+    }
+    delete mInverseIndexStorage;
+    mInverseIndexStorage = compactedStorage;
+    mFreezePending = false;
+    for (size_t i = 0; i < mCompactedInstances.size(); ++i) {
+        if (mCompactedInstances[i] == 1) {
+            mRemovedInstances[i] = 2;
+            --mNumberOfUncompactedInstances;
+        }
+    }
+    mCompactedInstances.clear();
+}
+
+// removed instances only get a tombstone, a running compaction is not waited for
+void InverseIndex::remove(const vsize_t& pInstances) {
+    const size_t numberOfInstances = getNumberOfInstances();
+    for (size_t i = 0; i < pInstances.size(); ++i) {
+        if (pInstances[i] >= numberOfInstances || isRemoved(pInstances[i])) continue;
+        if (mRemovedInstances.size() < numberOfInstances) {
+            mRemovedInstances.resize(numberOfInstances, 0);
+        }
+        mRemovedInstances[pInstances[i]] = 1;
+        ++mNumberOfUncompactedInstances;
+    }
+    installCompaction();
+    // a read-only storage keeps its lists, the bloomier filter would get other wrong lists after a new build
+    if (mCompactionThreshold >= 0 && mNumberOfUncompactedInstances > 0 && !mCompactionThread.joinable()
+            && mInverseIndexStorage->canInsert()
+            && mNumberOfUncompactedInstances >= mCompactionThreshold * numberOfInstances) {
+        // the compaction gets its own copy, the tombstones of later removals are not compacted by it
+        mCompactedInstances.assign(mRemovedInstances.begin(), mRemovedInstances.end());
+        mCompactionThread = std::thread(&InverseIndex::compact, this);
+    }
+}
+
+// the old hash values of an instance are erased from the inverse index and the new ones are inserted,
+// a removed instance is added again. every old signature is visited once for all its updated instances,
+// the inverse index is frozen once for all updates before the next query.
+bool InverseIndex::update(SparseMatrixFloat* pOriginalData, const vsize_t& pInstances, SparseMatrixFloat* pRawData) {
+    waitForCompaction();
+    const size_t numberOfInstances = getNumberOfInstances();
+    if (!mInverseIndexStorage->canInsert() || pRawData->size() != pInstances.size()) return false;
+    std::vector<char> updated(numberOfInstances, 0);
+    for (size_t i = 0; i < pInstances.size(); ++i) {
+        if (pInstances[i] >= numberOfInstances || pInstances[i] >= pOriginalData->size() || updated[pInstances[i]]) return false;
+        updated[pInstances[i]] = 1;
+    }
+    SignatureMatrix* signatures = computeSignatureVectors(pRawData, true);
+    if (signatures == NULL) return false;
+    mSignatureMatrices.push_back(signatures);
+
+    vsize_t oldSignatureIds(pInstances.size());
+    for (size_t i = 0; i < pInstances.size(); ++i) {
+        oldSignatureIds[i] = computeSignatureId(pOriginalData, pInstances[i]);
+    }
+    std::sort(oldSignatureIds.begin(), oldSignatureIds.end());
+    oldSignatureIds.erase(std::unique(oldSignatureIds.begin(), oldSignatureIds.end()), oldSignatureIds.end());
+    for (size_t i = 0; i < oldSignatureIds.size(); ++i) {
+        uniqueElement* storedElement = mSignatureStorage->find(oldSignatureIds[i]);
+        if (storedElement == NULL) continue;
+        vinstanceIdArena_t& instances = storedElement->instances;
+        const hashValue_t* signature = storedElement->signature;
+        size_t size = 0;
+        for (size_t k = 0; k < instances.size(); ++k) {
+            if (!updated[instances[k]]) {
+                instances[size++] = instances[k];
+                continue;
+            }
+            for (size_t j = 0; j < getSignatureSize(signature); ++j) {
+                mInverseIndexStorage->erase(j, getSignatureValue(signature, j), instances[k]);
+            }
+        }
+        if (size == instances.size()) continue;
+        if (size == 0) {
+            mDoubleElementsStorageCount -= instances.size() - 1;
+            mSignatureStorage->erase(oldSignatureIds[i]);
+        } else {
+            mDoubleElementsStorageCount -= instances.size() - size;
+            instances.resize(size);
+        }
+    }
+
+    for (size_t i = 0; i < pInstances.size(); ++i) {
+        const instanceId_t instance = pInstances[i];
+        hashValue_t* signature = getSignatureView(pRawData, signatures, i);
+        setInstanceSignature(instance, signature);
+        const size_t signatureId = computeSignatureId(pRawData, i);
+        uniqueElement* storedElement = mSignatureStorage->find(signatureId);
+        if (storedElement == NULL) {
+            uniqueElement element = {vinstanceIdArena_t(1, instance, vinstanceIdArena_t::allocator_type(mSignatureArena)), signature};
+            mSignatureStorage->add(signatureId, std::move(element));
+        } else {
+            storedElement->instances.push_back(instance);
+            mDoubleElementsStorageCount += 1;
+        }
+        for (size_t j = 0; j < getSignatureSize(signature); ++j) {
+            mInverseIndexStorage->insert(j, getSignatureValue(signature, j), instance, mRemoveValueWithLeastSigificantBit);
+        }
+        if (isRemoved(instance)) {
+            // the erasures removed the uncompacted ids of the instance
+            if (mRemovedInstances[instance] == 1) --mNumberOfUncompactedInstances;
+            mRemovedInstances[instance] = 0;
+        }
+    }
+    mFreezePending = true;
+    return true;
+}
+
+// the unique signatures are written as rows of one signature matrix, their instances as one flat list
+bool InverseIndex::save(IndexFileWriter* pWriter) {
+    const size_t numberOfSignatures = mSignatureStorage->size();
+    vhashValue_t signatures(numberOfSignatures * mSignatureWidth, 0);
+    std::vector<uint8_t> signaturePresent(numberOfSignatures, 0);
+    std::vector<uint64_t> signatureIds(numberOfSignatures);
+    std::vector<uint64_t> instanceOffsets(numberOfSignatures + 1, 0);
+    vinstanceId_t instances;
+    for (size_t i = 0; i < numberOfSignatures; ++i) {
+        const uniqueElement& element = mSignatureStorage->getElement(i);
+        if (element.signature != NULL) {
+            std::copy(element.signature, element.signature + mSignatureWidth, signatures.begin() + i * mSignatureWidth);
+            signaturePresent[i] = 1;
+        }
+        signatureIds[i] = mSignatureStorage->getSignatureId(i);
+        instances.insert(instances.end(), element.instances.begin(), element.instances.end());
+        instanceOffsets[i + 1] = instances.size();
+    }
+    waitForCompaction();
+    applyChanges();
+    std::vector<char> removedInstances(mRemovedInstances);
+    if (removedInstances.size() != 0) {
+        removedInstances.resize(getNumberOfInstances(), 0);
+    }
+    pWriter->getHeader()->doubleElementsStorageCount = mDoubleElementsStorageCount;
+    pWriter->writeSection(SECTION_SIGNATURES, signatures.data(), signatures.size() * sizeof(hashValue_t));
+    pWriter->writeSection(SECTION_SIGNATURE_PRESENT, signaturePresent.data(), numberOfSignatures);
+    pWriter->writeSection(SECTION_SIGNATURE_IDS, signatureIds.data(), numberOfSignatures * sizeof(uint64_t));
+    pWriter->writeSection(SECTION_SIGNATURE_INSTANCE_OFFSETS, instanceOffsets.data(), (numberOfSignatures + 1) * sizeof(uint64_t));
+    pWriter->writeSection(SECTION_SIGNATURE_INSTANCES, instances.data(), instances.size() * sizeof(instanceId_t));
+    pWriter->writeSection(SECTION_REMOVED_INSTANCES, removedInstances.data(), removedInstances.size());
+    return mInverseIndexStorage->save(pWriter);
+}
+
+// the signature matrix and the inverse index are used in place, only the batch of the unique signatures is rebuilt
+bool InverseIndex::load(const MappedIndexFile* pFile) {
+    const size_t numberOfSignatures = pFile->getSectionSize(SECTION_SIGNATURE_IDS) / sizeof(uint64_t);
+    if (pFile->getSectionSize(SECTION_SIGNATURES) != numberOfSignatures * mSignatureWidth * sizeof(hashValue_t)
+            || pFile->getSectionSize(SECTION_SIGNATURE_PRESENT) != numberOfSignatures
+            || pFile->getSectionSize(SECTION_SIGNATURE_INSTANCE_OFFSETS) != (numberOfSignatures + 1) * sizeof(uint64_t)) {
+        return false;
+    }
+    const uint64_t* instanceOffsets = static_cast<const uint64_t*>(pFile->getSection(SECTION_SIGNATURE_INSTANCE_OFFSETS));
+    if (pFile->getSectionSize(SECTION_SIGNATURE_INSTANCES) != instanceOffsets[numberOfSignatures] * sizeof(instanceId_t)) {
+        return false;
+    }
+    if (pFile->getSectionSize(SECTION_REMOVED_INSTANCES) > instanceOffsets[numberOfSignatures]
+            || !mInverseIndexStorage->load(pFile)) {
+        return false;
+    }
+
+    SignatureMatrix* signatures = new SignatureMatrix(static_cast<const hashValue_t*>(pFile->getSection(SECTION_SIGNATURES)),
+                                                      numberOfSignatures, mSignatureWidth);
+    mSignatureMatrices.push_back(signatures);
+    const uint8_t* signaturePresent = static_cast<const uint8_t*>(pFile->getSection(SECTION_SIGNATURE_PRESENT));
+    const uint64_t* signatureIds = static_cast<const uint64_t*>(pFile->getSection(SECTION_SIGNATURE_IDS));
+    const instanceId_t* instances = static_cast<const instanceId_t*>(pFile->getSection(SECTION_SIGNATURE_INSTANCES));
+    mSignatureStorage->reserve(numberOfSignatures);
+    for (size_t i = 0; i < numberOfSignatures; ++i) {
+        uniqueElement element = {vinstanceIdArena_t(instances + instanceOffsets[i], instances + instanceOffsets[i + 1],
+                                                    vinstanceIdArena_t::allocator_type(mSignatureArena)),
+                                 signaturePresent[i] ? signatures->getSignature(i) : NULL};
+        for (size_t j = instanceOffsets[i]; j < instanceOffsets[i + 1]; ++j) {
+            setInstanceSignature(instances[j], element.signature);
+        }
+        mSignatureStorage->add(signatureIds[i], std::move(element));
+    }
+    mDoubleElementsStorageCount = pFile->getHeader()->doubleElementsStorageCount;
+    const char* removedInstances = static_cast<const char*>(pFile->getSection(SECTION_REMOVED_INSTANCES));
+    mRemovedInstances.assign(removedInstances, removedInstances + pFile->getSectionSize(SECTION_REMOVED_INSTANCES));
+    mNumberOfUncompactedInstances = std::count(mRemovedInstances.begin(), mRemovedInstances.end(), 1);
+    return true;
+}
+
 // compute the signature for one instance with SSE support
-vsize_t* InverseIndex::computeSignatureSSE(SparseMatrixFloat* pRawData, const size_t pInstance) {
+void InverseIndex::computeSignatureSSE(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature) {
 
-    if (pRawData == NULL) return NULL;
-    vsize_t* signature = new vsize_t(mNumberOfHashFunctions * mBlockSize);
+    // rows of the sparse matrix are padded to a multiple of 32, full vectors can be loaded at the tail
+    const uint32_t* features = pRawData->getSparseMatrixIndexPointer(pInstance);
+    const size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
+    const size_t sizeOfInstanceFullVectors = sizeOfInstance - sizeOfInstance % 4;
+    const __m128i one = _mm_set1_epi32(1);
+    // lanes past the end of the instance are masked out
+    const __m128i tailMask = _mm_cmpgt_epi32(_mm_set1_epi32(sizeOfInstance % 4), _mm_setr_epi32(0, 1, 2, 3));
     __m128i minimumVector;
     __m128i seed;
     __m128i argmin;
     __m128i value;
     __m128i hashValue;
     for(size_t j = 0; j < mNumberOfHashFunctions * mBlockSize; ++j) {
-            minimumVector = _mm_set_epi32(MAX_VALUE, MAX_VALUE, MAX_VALUE, MAX_VALUE);
-            argmin = _mm_set_epi32(0,0,0,0);
+            minimumVector = _mm_set1_epi32(-1);
+            argmin = _mm_setzero_si128();
             seed = _mm_set_epi32(j+1, j+1, j+1, j+1);                   
 
-            for (size_t i = 0; i < pRawData->getSizeOfInstance(pInstance) - 4; i+=4) {
-                value = _mm_setr_epi32((pRawData->getNextElement(pInstance, i) +1), 
-                                    (pRawData->getNextElement(pInstance, i+1) +1),
-                                    (pRawData->getNextElement(pInstance, i+2) +1),
-                                    (pRawData->getNextElement(pInstance, i+3) +1));
+            for (size_t i = 0; i < sizeOfInstanceFullVectors; i+=4) {
+                value = _mm_add_epi32(_mm_loadu_si128((const __m128i*) (features + i)), one);
                 hashValue = mHash->hash_SSE(value, seed);
                 
                 minimumVector = _mm_min_epu32(hashValue, minimumVector);
                 // compare all four hash values and store minimum for each element
                 argmin = _mm_argmin_change_epi32(argmin, minimumVector, hashValue, value);
             }
+            if (sizeOfInstanceFullVectors != sizeOfInstance) {
+                value = _mm_add_epi32(_mm_loadu_si128((const __m128i*) (features + sizeOfInstanceFullVectors)), one);
+                // masked lanes get the largest hash value and can not change the argmin
+                hashValue = _mm_or_si128(mHash->hash_SSE(value, seed), _mm_not_si128(tailMask));
+                minimumVector = _mm_min_epu32(hashValue, minimumVector);
+                argmin = _mm_argmin_change_masked_epi32(argmin, minimumVector, hashValue, value, tailMask);
+            }
              
-            (*signature)[j] = _mm_get_argmin(argmin, minimumVector);
+            pSignature[j] = _mm_get_argmin(argmin, minimumVector);
     }
-    // reduce number of hash values by a factor of mShingleSize
-    if (mShingle) {
-        return shingle(signature);
-    }
-    return signature;
 }  
-// compute the signature for one instance
-vsize_t* InverseIndex::computeSignature(SparseMatrixFloat* pRawData, const size_t pInstance) {
-    return computeSignatureSSE(pRawData, pInstance);
-    if (pRawData == NULL) return NULL;
-    vsize_t* signature = new vsize_t(mNumberOfHashFunctions * mBlockSize);
-    size_t argmin = 0;
-    size_t seed = 0;
+// compute the signature for one instance with AVX2, 8 features per step
+__attribute__((target("avx2")))
+void InverseIndex::computeSignatureAVX2(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature) {
+
+    const uint32_t* features = pRawData->getSparseMatrixIndexPointer(pInstance);
+    const size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
+    const size_t sizeOfInstanceFullVectors = sizeOfInstance - sizeOfInstance % 8;
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i fullMask = _mm256_set1_epi32(-1);
+    const __m256i tailMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(sizeOfInstance % 8), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i minimumVector;
+    __m256i seed;
+    __m256i argmin;
+    __m256i value;
+    __m256i hashValue;
     for(size_t j = 0; j < mNumberOfHashFunctions * mBlockSize; ++j) {
-            uint32_t nearestNeighborsValue = MAX_VALUE;    
-            seed = j + 1;    
-            for (size_t i = 0; i < pRawData->getSizeOfInstance(pInstance); i++) {
-                uint32_t hashValue = mHash->hash((pRawData->getNextElement(pInstance, i) +1), seed, MAX_VALUE);
-               
-                if (hashValue < nearestNeighborsValue) {
-                    nearestNeighborsValue = hashValue;
-                    argmin = pRawData->getNextElement(pInstance, i);
-                }
+            minimumVector = fullMask;
+            argmin = _mm256_setzero_si256();
+            seed = _mm256_set1_epi32(j+1);
+
+            for (size_t i = 0; i < sizeOfInstanceFullVectors; i+=8) {
+                value = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) (features + i)), one);
+                hashValue = mHash->hash_AVX2(value, seed);
+                minimumVector = _mm256_min_epu32(hashValue, minimumVector);
+                argmin = _mm256_argmin_change_epi32(argmin, minimumVector, hashValue, value, fullMask);
+            }
+            if (sizeOfInstanceFullVectors != sizeOfInstance) {
+                value = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) (features + sizeOfInstanceFullVectors)), one);
+                hashValue = _mm256_or_si256(mHash->hash_AVX2(value, seed), _mm256_not_si256(tailMask));
+                minimumVector = _mm256_min_epu32(hashValue, minimumVector);
+                argmin = _mm256_argmin_change_epi32(argmin, minimumVector, hashValue, value, tailMask);
+            }
+            pSignature[j] = _mm256_get_argmin(argmin, minimumVector);
+    }
+}
+// compute the signature for one instance with AVX-512, 16 features per step.
+// _mm512_min_epu32 starts from an undefined vector, see avxExtension.h
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+void InverseIndex::computeSignatureAVX512(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature) {
+
+    const uint32_t* features = pRawData->getSparseMatrixIndexPointer(pInstance);
+    const size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
+    const size_t sizeOfInstanceFullVectors = sizeOfInstance - sizeOfInstance % 16;
+    const __m512i one = _mm512_set1_epi32(1);
+    const __mmask16 tailMask = (1 << (sizeOfInstance % 16)) - 1;
+    __m512i minimumVector;
+    __m512i seed;
+    __m512i argmin;
+    __m512i value;
+    __m512i hashValue;
+    for(size_t j = 0; j < mNumberOfHashFunctions * mBlockSize; ++j) {
+            minimumVector = _mm512_set1_epi32(-1);
+            argmin = _mm512_setzero_si512();
+            seed = _mm512_set1_epi32(j+1);
+
+            for (size_t i = 0; i < sizeOfInstanceFullVectors; i+=16) {
+                value = _mm512_add_epi32(_mm512_loadu_si512(features + i), one);
+                hashValue = mHash->hash_AVX512(value, seed);
+                minimumVector = _mm512_min_epu32(hashValue, minimumVector);
+                argmin = _mm512_mask_mov_epi32(argmin, _mm512_cmpeq_epu32_mask(minimumVector, hashValue), value);
             }
-            (*signature)[j] = argmin;
+            if (tailMask) {
+                value = _mm512_add_epi32(_mm512_maskz_loadu_epi32(tailMask, features + sizeOfInstanceFullVectors), one);
+                hashValue = mHash->hash_AVX512(value, seed);
+                minimumVector = _mm512_mask_min_epu32(minimumVector, tailMask, hashValue, minimumVector);
+                argmin = _mm512_mask_mov_epi32(argmin, _mm512_mask_cmpeq_epu32_mask(tailMask, minimumVector, hashValue), value);
+            }
+            pSignature[j] = _mm512_get_argmin(argmin, minimumVector);
+    }
+}
+#pragma GCC diagnostic pop
+// compute the signature for one instance with AVX2, 32 hash functions per pass over the features
+__attribute__((target("avx2")))
+void InverseIndex::computeSignatureAVX2Seeds(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature) {
+
+    const size_t numberOfHashValues = mNumberOfHashFunctions * mBlockSize;
+    const uint32_t* features = pRawData->getSparseMatrixIndexPointer(pInstance);
+    const size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
+    const __m256i seedOffset = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8);
+    const __m256i laneWidth = _mm256_set1_epi32(8);
+    uint32_t argminValues[32] __attribute__((aligned(32)));
+    __m256i seed0, seed1, seed2, seed3;
+    __m256i minimumVector0, minimumVector1, minimumVector2, minimumVector3;
+    __m256i argmin0, argmin1, argmin2, argmin3;
+    __m256i value;
+    for (size_t j = 0; j < numberOfHashValues; j += 32) {
+        seed0 = _mm256_add_epi32(_mm256_set1_epi32(j), seedOffset);
+        seed1 = _mm256_add_epi32(seed0, laneWidth);
+        seed2 = _mm256_add_epi32(seed1, laneWidth);
+        seed3 = _mm256_add_epi32(seed2, laneWidth);
+        minimumVector0 = minimumVector1 = minimumVector2 = minimumVector3 = _mm256_set1_epi32(-1);
+        argmin0 = argmin1 = argmin2 = argmin3 = _mm256_setzero_si256();
+        // every feature is loaded once and hashed with all seeds held in registers
+        for (size_t i = 0; i < sizeOfInstance; ++i) {
+            value = _mm256_set1_epi32(features[i] + 1);
+            _mm256_update_minimum_epi32(argmin0, minimumVector0, mHash->hash_AVX2(value, seed0), value);
+            _mm256_update_minimum_epi32(argmin1, minimumVector1, mHash->hash_AVX2(value, seed1), value);
+            _mm256_update_minimum_epi32(argmin2, minimumVector2, mHash->hash_AVX2(value, seed2), value);
+            _mm256_update_minimum_epi32(argmin3, minimumVector3, mHash->hash_AVX2(value, seed3), value);
+        }
+        _mm256_store_si256((__m256i*) argminValues, argmin0);
+        _mm256_store_si256((__m256i*) (argminValues + 8), argmin1);
+        _mm256_store_si256((__m256i*) (argminValues + 16), argmin2);
+        _mm256_store_si256((__m256i*) (argminValues + 24), argmin3);
+        for (size_t k = 0; k < 32 && j + k < numberOfHashValues; ++k) {
+            pSignature[j + k] = argminValues[k];
+        }
+    }
+}
+// compute the signature for one instance with AVX-512, 64 hash functions per pass over the features
+__attribute__((target("avx512f")))
+void InverseIndex::computeSignatureAVX512Seeds(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature) {
+
+    const size_t numberOfHashValues = mNumberOfHashFunctions * mBlockSize;
+    const uint32_t* features = pRawData->getSparseMatrixIndexPointer(pInstance);
+    const size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
+    const __m512i seedOffset = _mm512_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16);
+    const __m512i laneWidth = _mm512_set1_epi32(16);
+    uint32_t argminValues[64] __attribute__((aligned(64)));
+    __m512i seed0, seed1, seed2, seed3;
+    __m512i minimumVector0, minimumVector1, minimumVector2, minimumVector3;
+    __m512i argmin0, argmin1, argmin2, argmin3;
+    __m512i value;
+    for (size_t j = 0; j < numberOfHashValues; j += 64) {
+        seed0 = _mm512_add_epi32(_mm512_set1_epi32(j), seedOffset);
+        seed1 = _mm512_add_epi32(seed0, laneWidth);
+        seed2 = _mm512_add_epi32(seed1, laneWidth);
+        seed3 = _mm512_add_epi32(seed2, laneWidth);
+        minimumVector0 = minimumVector1 = minimumVector2 = minimumVector3 = _mm512_set1_epi32(-1);
+        argmin0 = argmin1 = argmin2 = argmin3 = _mm512_setzero_si512();
+        for (size_t i = 0; i < sizeOfInstance; ++i) {
+            value = _mm512_set1_epi32(features[i] + 1);
+            _mm512_update_minimum_epi32(argmin0, minimumVector0, mHash->hash_AVX512(value, seed0), value);
+            _mm512_update_minimum_epi32(argmin1, minimumVector1, mHash->hash_AVX512(value, seed1), value);
+            _mm512_update_minimum_epi32(argmin2, minimumVector2, mHash->hash_AVX512(value, seed2), value);
+            _mm512_update_minimum_epi32(argmin3, minimumVector3, mHash->hash_AVX512(value, seed3), value);
+        }
+        _mm512_store_si512(argminValues, argmin0);
+        _mm512_store_si512(argminValues + 16, argmin1);
+        _mm512_store_si512(argminValues + 32, argmin2);
+        _mm512_store_si512(argminValues + 48, argmin3);
+        for (size_t k = 0; k < 64 && j + k < numberOfHashValues; ++k) {
+            pSignature[j + k] = argminValues[k];
+        }
     }
-    // reduce number of hash values by a factor of mShingleSize
-    if (mShingle) {
-        return shingle(signature);
+}
+// the feature-wise kernels hash every started vector of features once per hash function and reduce
+// across lanes, the seed-wise kernels hash every feature once per started vector of hash functions
+bool InverseIndex::useSeedWiseKernel(const size_t pSizeOfInstance, const size_t pVectorWidth) const {
+    const size_t numberOfHashValues = mNumberOfHashFunctions * mBlockSize;
+    const size_t costFeatureWise = numberOfHashValues * ((pSizeOfInstance + pVectorWidth - 1) / pVectorWidth + 1);
+    const size_t costSeedWise = ((numberOfHashValues + pVectorWidth - 1) / pVectorWidth) * pSizeOfInstance;
+    return costSeedWise <= costFeatureWise;
+}
+// compute the signature for one instance
+void InverseIndex::computeSignature(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature) {
+    if (mSimdLevel == 2) {
+        if (useSeedWiseKernel(pRawData->getSizeOfInstance(pInstance), 16)) {
+            computeSignatureAVX512Seeds(pRawData, pInstance, pSignature);
+        } else {
+            computeSignatureAVX512(pRawData, pInstance, pSignature);
+        }
+    } else if (mSimdLevel == 1) {
+        if (useSeedWiseKernel(pRawData->getSizeOfInstance(pInstance), 8)) {
+            computeSignatureAVX2Seeds(pRawData, pInstance, pSignature);
+        } else {
+            computeSignatureAVX2(pRawData, pInstance, pSignature);
+        }
+    } else {
+        computeSignatureSSE(pRawData, pInstance, pSignature);
     }
-    return signature;
 }
 
-vsize_t* InverseIndex::shingle(vsize_t* pSignature) {
-    if (pSignature == NULL) return NULL;
-    vsize_t* signature = new vsize_t(mInverseIndexSize);
-    size_t iterationSize = ceil((mNumberOfHashFunctions * mBlockSize) / mShingleSize);
+// combine mShingleSize consecutive hash values of pHashValues to one value of pSignature
+void InverseIndex::shingle(const hashValue_t* pHashValues, hashValue_t* pSignature) {
+    const size_t numberOfHashValues = mNumberOfHashFunctions * mBlockSize;
+    size_t iterationSize = numberOfHashValues / mShingleSize;
+    std::fill_n(pSignature, mInverseIndexSize, 0);
     if (mShingle == 1) {
         
         // if 0 than combine hash values inside the block to one new hash value
-        size_t signatureBlockValue;
+        hashValue_t signatureBlockValue;
         for (size_t i = 0; i < iterationSize; ++i) {
-            signatureBlockValue = (*pSignature)[i*mShingleSize];
+            signatureBlockValue = pHashValues[i*mShingleSize];
             
             for (size_t j = 1; j < mShingleSize; ++j) {
-                signatureBlockValue = mHash->hash((*pSignature)[i*mShingleSize+j]+1, signatureBlockValue+1, MAX_VALUE);
+                signatureBlockValue = mHash->hash(pHashValues[i*mShingleSize+j]+1, signatureBlockValue+1, MAX_VALUE);
             }
-            (*signature)[i] = signatureBlockValue;
+            pSignature[i] = signatureBlockValue;
         }
+        // the last block is shorter if mShingleSize does not divide the number of hash values
         if (iterationSize != mInverseIndexSize) {
-            signatureBlockValue = (*pSignature)[(iterationSize+1) * mShingleSize];
-            for (size_t j = 0; j < mShingleSize && j + (iterationSize+1)*mShingleSize < pSignature->size(); ++j) {
-                signatureBlockValue = mHash->hash((*pSignature)[(iterationSize+1)*mShingleSize + j]+1, signatureBlockValue+1, MAX_VALUE);
+            signatureBlockValue = pHashValues[iterationSize * mShingleSize];
+            for (size_t j = 1; j < mShingleSize && j + iterationSize*mShingleSize < numberOfHashValues; ++j) {
+                signatureBlockValue = mHash->hash(pHashValues[iterationSize*mShingleSize + j]+1, signatureBlockValue+1, MAX_VALUE);
             }
-            (*signature)[iterationSize] = signatureBlockValue;
+            pSignature[iterationSize] = signatureBlockValue;
         }
     }
-    
-    delete pSignature;
-    return signature; 
 }
 
-vsize_t* InverseIndex::computeSignatureWTA(SparseMatrixFloat* pRawData, const size_t pInstance) {
-    size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
-    
-    size_t mSeed = 42;
-    size_t mK = mRangeK_Wta;
-    
-    vsize_t* signature = new vsize_t (mNumberOfHashFunctions * mBlockSize);
-    if (sizeOfInstance < mK) {
-        mK = sizeOfInstance;
+// hash one feature with 16 consecutive seeds and return the mask of hash values that are not larger than
+// the thresholds of their hash functions. all three versions compute the same hash values.
+int InverseIndex::hashCandidatesWTA_SSE(const uint32_t pValue, const size_t pSeed, const uint32_t* pThresholds, uint32_t* pHashValues) {
+    const __m128i value = _mm_set1_epi32(pValue);
+    int candidates = 0;
+    for (size_t i = 0; i < 16; i += 4) {
+        __m128i hashValue = mHash->hash_SSE(value, _mm_add_epi32(_mm_set1_epi32(pSeed + i), _mm_setr_epi32(0, 1, 2, 3)));
+        __m128i threshold = _mm_load_si128((const __m128i*) (pThresholds + i));
+        _mm_store_si128((__m128i*) (pHashValues + i), hashValue);
+        // unsigned hashValue <= threshold
+        candidates |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_min_epu32(hashValue, threshold), hashValue))) << i;
     }
-    KSizeSortedMap keyValue(mK);
-    
-    for (size_t i = 0; i < mNumberOfHashFunctions * mBlockSize; ++i) {
-        
-        for (size_t j = 0; j < sizeOfInstance; ++j) {
-            size_t hashIndex = mHash->hash((pRawData->getNextElement(pInstance, j) +1), mSeed+i, MAX_VALUE);
-            keyValue.insert(hashIndex, pRawData->getNextValue(pInstance, j));
-        } 
-        
-        float maxValue = 0.0;
-        size_t maxValueIndex = 0;
-        
-        for (size_t j = 0; j < mK; ++j) {
-            if (keyValue.getValue(j) > maxValue) {
-                maxValue = keyValue.getValue(j);
-                maxValueIndex = keyValue.getKey(j);
-                
+    return candidates;
+}
+__attribute__((target("avx2")))
+int InverseIndex::hashCandidatesWTA_AVX2(const uint32_t pValue, const size_t pSeed, const uint32_t* pThresholds, uint32_t* pHashValues) {
+    const __m256i value = _mm256_set1_epi32(pValue);
+    int candidates = 0;
+    for (size_t i = 0; i < 16; i += 8) {
+        __m256i hashValue = mHash->hash_AVX2(value, _mm256_add_epi32(_mm256_set1_epi32(pSeed + i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+        __m256i threshold = _mm256_load_si256((const __m256i*) (pThresholds + i));
+        _mm256_store_si256((__m256i*) (pHashValues + i), hashValue);
+        candidates |= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_min_epu32(hashValue, threshold), hashValue))) << i;
+    }
+    return candidates;
+}
+__attribute__((target("avx512f")))
+int InverseIndex::hashCandidatesWTA_AVX512(const uint32_t pValue, const size_t pSeed, const uint32_t* pThresholds, uint32_t* pHashValues) {
+    __m512i hashValue = mHash->hash_AVX512(_mm512_set1_epi32(pValue), 
+                            _mm512_add_epi32(_mm512_set1_epi32(pSeed), _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)));
+    _mm512_store_si512(pHashValues, hashValue);
+    return _mm512_cmple_epu32_mask(hashValue, _mm512_load_si512(pThresholds));
+}
+// winner takes all: for every hash function the feature with the largest value among the k features
+// with the smallest hash values wins. 16 hash functions are computed at once and a hash value is only
+// inserted into the sorted array of its hash function if it is not larger than the current k-th smallest one.
+// pKeys and pWeights hold 16 * mRangeK_Wta values, the sorted arrays of 16 hash functions
+void InverseIndex::computeSignatureWTA(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature,
+                                       uint32_t* pKeys, float* pWeights) {
+    const size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
+    const uint32_t* features = pRawData->getSparseMatrixIndexPointer(pInstance);
+    const float* values = pRawData->getSparseMatrixValuesPointer(pInstance);
+    const size_t numberOfHashValues = mNumberOfHashFunctions * mBlockSize;
+    const size_t seed = 42;
+    size_t k = mRangeK_Wta;
+    if (sizeOfInstance < k) {
+        k = sizeOfInstance;
+    }
+    std::fill_n(pSignature, numberOfHashValues, 0);
+    if (k > 0) {
+        KSizeSortedArray keyValue[16];
+        uint32_t hashValues[16] __attribute__((aligned(64)));
+        uint32_t thresholds[16] __attribute__((aligned(64)));
+        for (size_t j = 0; j < numberOfHashValues; j += 16) {
+            for (size_t l = 0; l < 16; ++l) {
+                keyValue[l].init(pKeys + l * k, pWeights + l * k, k);
+                thresholds[l] = UINT32_MAX;
+            }
+            for (size_t i = 0; i < sizeOfInstance; ++i) {
+                int candidates;
+                if (mSimdLevel == 2) {
+                    candidates = hashCandidatesWTA_AVX512(features[i] + 1, seed + j, thresholds, hashValues);
+                } else if (mSimdLevel == 1) {
+                    candidates = hashCandidatesWTA_AVX2(features[i] + 1, seed + j, thresholds, hashValues);
+                } else {
+                    candidates = hashCandidatesWTA_SSE(features[i] + 1, seed + j, thresholds, hashValues);
+                }
+                while (candidates != 0) {
+                    const size_t l = __builtin_ctz(candidates);
+                    candidates &= candidates - 1;
+                    keyValue[l].insert(hashValues[l], values[i]);
+                    thresholds[l] = keyValue[l].getThreshold();
+                }
+            }
+            for (size_t l = 0; l < 16 && j + l < numberOfHashValues; ++l) {
+                pSignature[j + l] = keyValue[l].getKeyOfMaxValue();
             }
         }
-        (*signature)[i] = maxValueIndex;//keyValue.getMaxValueIndex();
-        keyValue.clear();
     }
-    if (mShingle) {
-        return shingle(signature);
+}
+
+// one permutation hashing with densification: every feature is hashed once into one of the bins, the empty bins
+// are filled afterwards. each filled bin probes a fixed random sequence of bins and copies its value into the
+// empty ones it hits first (optimal densification, Shrivastava 2017, in the faster formulation of Mai et al. 2019).
+// the probe sequences are the same for all instances, so the collision probability per bin stays the jaccard similarity.
+// pMinimumValues and pFilledBins hold one value per bin. pMinimumValues is only read for bins that got a
+// feature of this instance, so neither needs to be cleared
+void InverseIndex::computeSignatureOPH(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature,
+                                       uint32_t* pMinimumValues, uint32_t* pFilledBins) {
+    const size_t numberOfBins = mNumberOfHashFunctions * mBlockSize;
+    const size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
+    const uint32_t* features = pRawData->getSparseMatrixIndexPointer(pInstance);
+
+    // a signature value of 0 marks an empty bin
+    std::fill_n(pSignature, numberOfBins, 0);
+    size_t numberOfFilledBins = 0;
+    for (size_t i = 0; i < sizeOfInstance; ++i) {
+        const uint32_t value = features[i] + 1;
+        const uint32_t hashValue = mHash->hash(value, 1, MAX_VALUE);
+        // the high bits choose the bin, the order inside a bin is given by the hash value itself
+        const size_t bin = ((uint64_t) hashValue * numberOfBins) >> 32;
+        if (pSignature[bin] == 0) {
+            pFilledBins[numberOfFilledBins++] = bin;
+            pMinimumValues[bin] = hashValue;
+            pSignature[bin] = value;
+        } else if (hashValue <= pMinimumValues[bin]) {
+            pMinimumValues[bin] = hashValue;
+            pSignature[bin] = value;
+        }
+    }
+
+    // an empty instance keeps an empty signature like the minHash kernels.
+    // filled bins are never overwritten, so they can be read while the empty ones are densified
+    size_t numberOfEmptyBins = numberOfBins - numberOfFilledBins;
+    if (numberOfEmptyBins != 0 && numberOfFilledBins != 0) {
+        uint32_t* filledBinsEnd = pFilledBins + numberOfFilledBins;
+        std::sort(pFilledBins, filledBinsEnd);
+        for (size_t attempt = 1; numberOfEmptyBins != 0 && attempt <= numberOfBins; ++attempt) {
+            for (size_t i = 0; i < numberOfFilledBins; ++i) {
+                const size_t bin = ((uint64_t) mHash->hashMix(attempt * numberOfBins + pFilledBins[i], 2) * numberOfBins) >> 32;
+                if (pSignature[bin] == 0) {
+                    pSignature[bin] = pSignature[pFilledBins[i]];
+                    --numberOfEmptyBins;
+                }
+            }
+        }
+        // the probes missed some bins, take the value of the next bin filled by a feature
+        for (size_t i = 0; numberOfEmptyBins != 0 && i < numberOfBins; ++i) {
+            if (pSignature[i] != 0) continue;
+            const uint32_t* next = std::upper_bound(pFilledBins, filledBinsEnd, i);
+            pSignature[i] = pSignature[next != filledBinsEnd ? *next : pFilledBins[0]];
+            --numberOfEmptyBins;
+        }
+    }
+}
+
+// keep the lowest mBitsPerHashValue bits of every value and pack them into 32 bit words
+void InverseIndex::packSignature(const hashValue_t* pHashValues, hashValue_t* pSignature) const {
+    const hashValue_t mask = (1ULL << mBitsPerHashValue) - 1;
+    const size_t valuesPerWord = 32 / mBitsPerHashValue;
+    std::fill_n(pSignature, mSignatureWidth, 0);
+    for (size_t i = 0; i < mSignatureSize; ++i) {
+        // without shingling or with shingles of one value these are the ids of the minimal features, their low bits
+        // are not uniform. the collision correction needs 2^-b for two different values, so every value is hashed
+        const hashValue_t value = mHash->hash(pHashValues[i] + 1, i + 1, MAX_VALUE);
+        pSignature[i / valuesPerWord] |= (value & mask) << ((i % valuesPerWord) * mBitsPerHashValue);
     }
-    return signature;
 }
 
-vvsize_t_p* InverseIndex::computeSignatureVectors(SparseMatrixFloat* pRawData, const bool pFitting) {
-    if (mChunkSize <= 0) {
-        mChunkSize = ceil(pRawData->size() / static_cast<float>(mNumberOfCores));
+// the view of mSignatureStorage or of a query on the signature of pInstance.
+// a b-bit signature of an instance without features has no view, its values could not be told apart from real ones.
+hashValue_t* InverseIndex::getSignatureView(SparseMatrixFloat* pRawData, SignatureMatrix* pSignatures, const size_t pInstance) const {
+    if (mBitsPerHashValue != 0 && pRawData->getSizeOfInstance(pInstance) == 0) return NULL;
+    return pSignatures->getSignature(pInstance);
+}
+
+// id of the unique signature of pInstance in mSignatureStorage, computed from its features
+size_t InverseIndex::computeSignatureId(SparseMatrixFloat* pRawData, const size_t pInstance) {
+    size_t signatureId = 0;
+    for (size_t j = 0; j < pRawData->getSizeOfInstance(pInstance); ++j) {
+            signatureId = mHash->hash((pRawData->getNextElement(pInstance, j) +1), (signatureId+1), MAX_VALUE);
     }
+    return signatureId;
+}
+
+SignatureMatrix* InverseIndex::computeSignatureVectors(SparseMatrixFloat* pRawData, const bool pFitting) {
+    // only the gpu hashes fitted data and queries differently
+    (void) pFitting;
     #ifdef OPENMP
     omp_set_dynamic(0);
     #endif
-    vvsize_t_p* signatures = new vvsize_t_p(pRawData->size(), NULL);
+    SignatureMatrix* signatures = new SignatureMatrix(pRawData->size(), mSignatureWidth);
     #ifdef CUDA
-    if ((mCpuGpuLoadBalancing == 0 && mGpuHash == 0) || mHashAlgorithm == 1 ) {
+    if ((mCpuGpuLoadBalancing == 0 && mGpuHash == 0) || mHashAlgorithm == 1 || mHashAlgorithm == 2
+            || mBitsPerHashValue != 0) {
     #endif
-        #pragma omp parallel for schedule(static, mChunkSize) num_threads(mNumberOfCores)
-        for (size_t instance = 0; instance < pRawData->size(); ++instance) {
-            if (mHashAlgorithm == 0) {
-                // use nearestNeighbors 
-                (*signatures)[instance] = computeSignature(pRawData, instance);
-            } else if (mHashAlgorithm == 1) {
-                // use wta hash
-                (*signatures)[instance] = computeSignatureWTA(pRawData, instance);
+        // hashing an instance costs about its number of features
+        vsize_t costs(pRawData->size());
+        for (size_t instance = 0; instance < costs.size(); ++instance) {
+            costs[instance] = pRawData->getSizeOfInstance(instance);
+        }
+        const vsize_t order = sortByDecreasingCost(costs);
+        const size_t chunkSize = getDynamicChunkSize(mChunkSize, order.size(), mNumberOfCores);
+        #pragma omp parallel num_threads(mNumberOfCores)
+        {
+            // without shingling and packing the kernels write directly into the signature matrix,
+            // otherwise into buffers that are reused for all instances of a thread
+            hashValue_t* hashValues = NULL;
+            hashValue_t* shingledValues = NULL;
+            if (mShingle || mBitsPerHashValue != 0) {
+                hashValues = new hashValue_t [mNumberOfHashFunctions * mBlockSize];
+            }
+            if (mShingle && mBitsPerHashValue != 0) {
+                shingledValues = new hashValue_t [mInverseIndexSize];
             }
+            // the top-k arrays of the wta kernel, the bin minima and filled bins of one permutation hashing
+            uint32_t* wtaKeys = NULL;
+            float* wtaWeights = NULL;
+            uint32_t* minimumValues = NULL;
+            uint32_t* filledBins = NULL;
+            if (mHashAlgorithm == 1) {
+                wtaKeys = new uint32_t [16 * mRangeK_Wta];
+                wtaWeights = new float [16 * mRangeK_Wta];
+            } else if (mHashAlgorithm == 2) {
+                minimumValues = new uint32_t [mNumberOfHashFunctions * mBlockSize];
+                filledBins = new uint32_t [mNumberOfHashFunctions * mBlockSize];
+            }
+            #pragma omp for schedule(dynamic, chunkSize)
+            for (size_t position = 0; position < order.size(); ++position) {
+                const size_t instance = order[position];
+                hashValue_t* signature = signatures->getSignature(instance);
+                hashValue_t* target = hashValues != NULL ? hashValues : signature;
+                if (mHashAlgorithm == 0) {
+                    // use nearestNeighbors 
+                    computeSignature(pRawData, instance, target);
+                } else if (mHashAlgorithm == 1) {
+                    // use wta hash
+                    computeSignatureWTA(pRawData, instance, target, wtaKeys, wtaWeights);
+                } else if (mHashAlgorithm == 2) {
+                    // use one permutation hashing
+                    computeSignatureOPH(pRawData, instance, target, minimumValues, filledBins);
+                }
+                if (mShingle && mBitsPerHashValue != 0) {
+                    shingle(hashValues, shingledValues);
+                    packSignature(shingledValues, signature);
+                } else if (mShingle) {
+                    // reduce number of hash values by a factor of mShingleSize
+                    shingle(hashValues, signature);
+                } else if (mBitsPerHashValue != 0) {
+                    packSignature(hashValues, signature);
+                }
+            }
+            delete [] hashValues;
+            delete [] shingledValues;
+            delete [] wtaKeys;
+            delete [] wtaWeights;
+            delete [] minimumValues;
+            delete [] filledBins;
         }
     #ifdef CUDA 
     } else {
@@ -269,94 +911,119 @@ vvsize_t_p* InverseIndex::computeSignatureVectors(SparseMatrixFloat* pRawData, c
     #endif
     return signatures;
 }
-umap_uniqueElement* InverseIndex::computeSignatureMap(SparseMatrixFloat* pRawData) {
+// the signature ids of the rows of pRawData. a row without a signature view gets NO_SIGNATURE_ID, the ids
+// computed from features are hash values and never reach it.
+vsize_t InverseIndex::computeSignatureIds(SparseMatrixFloat* pRawData) {
+    const size_t numberOfInstances = pRawData->size();
+    vsize_t signatureIds(numberOfInstances);
+#pragma omp parallel for schedule(static, getStaticChunkSize(mChunkSize, numberOfInstances, mNumberOfCores)) num_threads(mNumberOfCores)
+    for (size_t i = 0; i < numberOfInstances; ++i) {
+        if (mBitsPerHashValue != 0 && pRawData->getSizeOfInstance(i) == 0) {
+            signatureIds[i] = NO_SIGNATURE_ID;
+        } else {
+            signatureIds[i] = computeSignatureId(pRawData, i);
+        }
+    }
+    return signatureIds;
+}
+// the elements of the returned map are views into pSignatures
+SignatureBatch* InverseIndex::computeSignatureMap(SparseMatrixFloat* pRawData, SignatureMatrix* pSignatures) {
+    if (pSignatures == NULL) {
+        mDoubleElementsQueryCount = 0;
+        return new SignatureBatch();
+    }
+    return computeSignatureMap(pSignatures, computeSignatureIds(pRawData));
+}
+// the instances are grouped by id in instance order
+SignatureBatch* InverseIndex::computeSignatureMap(SignatureMatrix* pSignatures, const vsize_t& pSignatureIds) {
     mDoubleElementsQueryCount = 0;
-    const size_t sizeOfInstances = pRawData->size();
-    umap_uniqueElement* instanceSignature = new umap_uniqueElement();
-    instanceSignature->reserve(sizeOfInstances);
-    vvsize_t_p* signatures = computeSignatureVectors(pRawData, false);
-    if (signatures != NULL) {
-#pragma omp parallel for schedule(static, mChunkSize) num_threads(mNumberOfCores)
-        for (size_t i = 0; i < signatures->size(); ++i) {
-    
-            size_t signatureId = 0;
-            for (size_t j = 0; j < pRawData->getSizeOfInstance(i); ++j) {
-                    signatureId = mHash->hash((pRawData->getNextElement(i, j) +1), (signatureId+1), MAX_VALUE);
-            }
-            
-            if (instanceSignature->find(signatureId) == instanceSignature->end()) {
-                    vsize_t* doubleInstanceVector = new vsize_t(1);
-                    (*doubleInstanceVector)[0] = i;
-                    uniqueElement element;
-                    element.instances = doubleInstanceVector; 
-                    element.signature = (*signatures)[i];
-                    #pragma omp critical
-                    (*instanceSignature)[signatureId] = element;
-            } else {
-                #pragma omp critical
-                {
-                    (*instanceSignature)[signatureId].instances->push_back(i);
-                    mDoubleElementsQueryCount += 1;
-                    delete (*signatures)[i];
-                }
-            } 
+    SignatureBatch* instanceSignature = new SignatureBatch();
+    const size_t numberOfInstances = pSignatureIds.size();
+    instanceSignature->reserve(numberOfInstances);
+    for (size_t i = 0; i < numberOfInstances; ++i) {
+        uniqueElement* element = instanceSignature->find(pSignatureIds[i]);
+        if (element == NULL) {
+            hashValue_t* signature = pSignatureIds[i] == NO_SIGNATURE_ID ? NULL : pSignatures->getSignature(i);
+            uniqueElement newElement = {vinstanceIdArena_t(1, i), signature};
+            instanceSignature->add(pSignatureIds[i], std::move(newElement));
+        } else {
+            element->instances.push_back(i);
+            mDoubleElementsQueryCount += 1;
         }
     }
-    delete signatures;
     return instanceSignature;
 }
-void InverseIndex::fit(SparseMatrixFloat* pRawData, size_t pStartIndex) {
+bool InverseIndex::fit(SparseMatrixFloat* pRawData, size_t pStartIndex) {
 
-    vvsize_t_p* signatures = computeSignatureVectors(pRawData, true);
+    waitForCompaction();
+    // a bloomier filter is read-only after the first fit
+    if (!mInverseIndexStorage->canInsert()) return false;
+    SignatureMatrix* signatures = computeSignatureVectors(pRawData, true);
 
-    if (signatures == NULL) return;
-    // compute how often the inverse index should be pruned 
-    size_t pruneEveryNInstances = ceil(signatures->size() * mPruneInverseIndexAfterInstance);
+    if (signatures == NULL) return true;
+    // mSignatureStorage holds views into the matrix
+    mSignatureMatrices.push_back(signatures);
+    // compute how often the inverse index should be pruned, 0 prunes only at the end of the fit
+    size_t pruneEveryNInstances = 0;
+    if (mPruneInverseIndexAfterInstance > 0) {
+        pruneEveryNInstances = ceil(signatures->size() * mPruneInverseIndexAfterInstance);
+    }
     #ifdef OPENMP
     omp_set_dynamic(0);
     #endif
 
-    // store signatures in signatureStorage
-// #pragma omp parallel for schedule(static, mChunkSize) num_threads(mNumberOfCores)
-    for (size_t i = 0; i < signatures->size(); ++i) {
-        bool deleteSignature = false;
-        if ((*signatures)[i] == NULL) continue;
-        size_t signatureId = 0;
-        for (size_t j = 0; j < pRawData->getSizeOfInstance(i); ++j) {
-                signatureId = mHash->hash((pRawData->getNextElement(i, j) +1), (signatureId+1), MAX_VALUE);
-        }
-        auto itSignatureStorage = mSignatureStorage->find(signatureId);
-        if (itSignatureStorage == mSignatureStorage->end()) {
-            vsize_t* doubleInstanceVector = new vsize_t(1);
-            (*doubleInstanceVector)[0] = i;
-            uniqueElement element;
-            element.instances = doubleInstanceVector;
-            element.signature = (*signatures)[i];
-            mSignatureStorage->operator[](signatureId) = element;
+    const size_t numberOfInstances = signatures->size();
+    std::vector<hashValue_t*> signatureViews(numberOfInstances);
+    vsize_t signatureIds(numberOfInstances);
+#pragma omp parallel for schedule(static, getStaticChunkSize(mChunkSize, numberOfInstances, mNumberOfCores)) num_threads(mNumberOfCores)
+    for (size_t i = 0; i < numberOfInstances; ++i) {
+        signatureViews[i] = getSignatureView(pRawData, signatures, i);
+        signatureIds[i] = computeSignatureId(pRawData, i);
+    }
+
+    // store signatures in signatureStorage, in instance order
+    // the instances after which the inverse index is pruned split the insertion into ranges
+    vsize_t rangeEnds;
+    for (size_t i = 0; i < numberOfInstances; ++i) {
+        uniqueElement* storedElement = mSignatureStorage->find(signatureIds[i]);
+        if (storedElement == NULL) {
+            uniqueElement element = {vinstanceIdArena_t(1, i+pStartIndex, vinstanceIdArena_t::allocator_type(mSignatureArena)),
+                                     signatureViews[i]};
+            mSignatureStorage->add(signatureIds[i], std::move(element));
         } else {
-            {            
-                mSignatureStorage->operator[](signatureId).instances->push_back(i+pStartIndex);
-                mDoubleElementsStorageCount += 1;
-                deleteSignature = true;
-            }
+            storedElement->instances.push_back(i+pStartIndex);
+            mDoubleElementsStorageCount += 1;
         }      
-        for (size_t j = 0; j < (*signatures)[i]->size(); ++j) {
-            mInverseIndexStorage->insert(j, (*(*signatures)[i])[j], i+pStartIndex, mRemoveValueWithLeastSigificantBit);
+        setInstanceSignature(i+pStartIndex, signatureViews[i]);
+        if (pruneEveryNInstances != 0 && (i + 1) % pruneEveryNInstances == 0 && i + 1 < numberOfInstances) {
+            rangeEnds.push_back(i + 1);
         }
-        // delete (*signatures)[i] if it appeares for the second time
-        if (deleteSignature) {
-             delete (*signatures)[i];
-             deleteSignature = false;
+    }
+    rangeEnds.push_back(numberOfInstances);
+
+    // every thread inserts all instances into its own hash functions, the tables of different hash functions
+    // are independent and get the ids in the same order as with a sequential insertion.
+    // the tables are grown once up front instead of rehashing while the threads insert
+    mInverseIndexStorage->reserveSpaceForMaps(numberOfInstances);
+    const size_t numberOfHashFunctions = mInverseIndexStorage->size();
+    size_t rangeBegin = 0;
+    for (size_t range = 0; range < rangeEnds.size(); ++range) {
+        const size_t rangeEnd = rangeEnds[range];
+#pragma omp parallel for schedule(dynamic) num_threads(mNumberOfCores)
+        for (size_t j = 0; j < numberOfHashFunctions; ++j) {
+            for (size_t i = rangeBegin; i < rangeEnd; ++i) {
+                if (j >= getSignatureSize(signatureViews[i])) continue;
+                mInverseIndexStorage->insert(j, getSignatureValue(signatureViews[i], j), i+pStartIndex, mRemoveValueWithLeastSigificantBit);
+            }
         }
-        if (signatures->size() == pruneEveryNInstances) {
-            
-                pruneEveryNInstances += pruneEveryNInstances;
-                if (mPruneInverseIndex > -1) {
-                    mInverseIndexStorage->prune(mPruneInverseIndex);
-                }
-                if (mRemoveHashFunctionWithLessEntriesAs > -1) {
-                    mInverseIndexStorage->removeHashFunctionWithLessEntriesAs(mRemoveHashFunctionWithLessEntriesAs);
-                }
+        rangeBegin = rangeEnd;
+        if (range + 1 < rangeEnds.size()) {
+            if (mPruneInverseIndex > -1) {
+                mInverseIndexStorage->prune(mPruneInverseIndex);
+            }
+            if (mRemoveHashFunctionWithLessEntriesAs > -1) {
+                mInverseIndexStorage->removeHashFunctionWithLessEntriesAs(mRemoveHashFunctionWithLessEntriesAs);
+            }
         }
     }
 
@@ -367,10 +1034,56 @@ void InverseIndex::fit(SparseMatrixFloat* pRawData, size_t pStartIndex) {
     if (mRemoveHashFunctionWithLessEntriesAs > -1) {
         mInverseIndexStorage->removeHashFunctionWithLessEntriesAs(mRemoveHashFunctionWithLessEntriesAs);
     }
-    delete signatures;
+    mInverseIndexStorage->freeze();
+    mFreezePending = false;
+    return true;
+}
+
+static bool sortProbeAscBySize(const listProbe& pFirst, const listProbe& pSecond) {
+    return pFirst.instances.size < pSecond.instances.size;
+}
+
+void InverseIndex::countCollisions(const postingList& pInstances, CollisionCounter& pCollisions, vinstanceId_t& pDecodedInstances,
+                                    instanceId_t& pBestCandidate, uint32_t& pBestCount) const {
+    const instanceId_t* instanceIds = pInstances.instances;
+#ifndef LARGE_INDEX
+    if (pInstances.compressed != NULL) {
+        pDecodedInstances.resize(pInstances.size);
+        streamVByteDecode(pInstances.compressed, pInstances.size, pDecodedInstances.data());
+        instanceIds = pDecodedInstances.data();
+    }
+#endif
+    const bool hasRemovedInstances = mRemovedInstances.size() != 0;
+    for (size_t k = 0; k < pInstances.size; ++k) {
+        if (hasRemovedInstances && isRemoved(instanceIds[k])) continue;
+        const uint32_t count = pCollisions.add(instanceIds[k]);
+        if (count > pBestCount) {
+            pBestCount = count;
+            pBestCandidate = instanceIds[k];
+        }
+    }
+}
+
+void InverseIndex::countProbeCollisions(const postingList& pInstances, const CollisionCounter& pCollisions,
+                                        CollisionCounter& pProbeCollisions, vinstanceId_t& pDecodedInstances) const {
+    const instanceId_t* instanceIds = pInstances.instances;
+#ifndef LARGE_INDEX
+    if (pInstances.compressed != NULL) {
+        pDecodedInstances.resize(pInstances.size);
+        streamVByteDecode(pInstances.compressed, pInstances.size, pDecodedInstances.data());
+        instanceIds = pDecodedInstances.data();
+    }
+#endif
+    const bool hasRemovedInstances = mRemovedInstances.size() != 0;
+    for (size_t k = 0; k < pInstances.size; ++k) {
+        if (hasRemovedInstances && isRemoved(instanceIds[k])) continue;
+        // the best candidate and every other instance with a collision keep their own count
+        if (pCollisions.getCount(instanceIds[k]) > 0) continue;
+        pProbeCollisions.add(instanceIds[k]);
+    }
 }
 
-neighborhood* InverseIndex::kneighbors(const umap_uniqueElement* pSignaturesMap, 
+neighborhood InverseIndex::kneighbors(const SignatureBatch* pSignatures, 
                                         const size_t pNneighborhood, 
                                         const bool pDoubleElementsStorageCount,
                                         const bool pNoneSingleInstance, const float pRadius) {
@@ -386,161 +1099,253 @@ neighborhood* InverseIndex::kneighbors(const umap_uniqueElement* pSignaturesMap,
 #ifdef OPENMP
     omp_set_dynamic(0);
 #endif
-    vvsize_t* neighbors = new vvsize_t();
-    vvfloat* distances = new vvfloat();
-    neighbors->resize(pSignaturesMap->size() + doubleElements);
-    distances->resize(pSignaturesMap->size() + doubleElements);
-    if (mChunkSize <= 0) {
-        mChunkSize = ceil(mInverseIndexStorage->size() / static_cast<float>(mNumberOfCores));
-    }
- 
+    // the instances of the signature storage can be removed ones, they get only themselves as neighbor
+    const bool skipRemovedInstances = pDoubleElementsStorageCount && pNoneSingleInstance && mRemovedInstances.size() != 0;
+    // the ids in the posting lists are smaller than this
+    const size_t numberOfInstances = getNumberOfInstances();
+    // every unique signature is handled by one thread, which writes the rows of all of its instances
+    NeighborhoodBuilder neighbors(pSignatures->size() + doubleElements, mNumberOfCores);
+    // the list of a removed instance and of an instance without candidates
+    const float zeroDistance = 0;
+    const size_t noCandidate = 1;
+    const float noCandidateDistance = 1;
+    // the cost of a query is estimated by the length of its first lists and the number of its instances,
+    // the queries are processed by decreasing cost
+    const size_t numberOfSampledLists = 4;
+    vsize_t costs(pSignatures->size());
 #ifdef OPENMP
-#pragma omp parallel for schedule(static, mChunkSize) num_threads(mNumberOfCores)
-#endif 
-
-    for (size_t i = 0; i < pSignaturesMap->size(); ++i) {
-        umap_uniqueElement::const_iterator instanceId = pSignaturesMap->begin();
-        
-        std::advance(instanceId, i);
-        
-        if (instanceId == pSignaturesMap->end()) continue;
-        std::unordered_map<size_t, size_t> neighborhood;
-        
-        const vsize_t* signature = instanceId->second.signature; 
-        if (signature == NULL) continue;
-        
-        for (size_t j = 0; j < signature->size(); ++j) {
-            size_t hashID = (*signature)[j];
+#pragma omp parallel for schedule(static, getStaticChunkSize(mChunkSize, costs.size(), mNumberOfCores)) num_threads(mNumberOfCores)
+#endif
+    for (size_t i = 0; i < costs.size(); ++i) {
+        const uniqueElement& instanceId = pSignatures->getElement(i);
+        costs[i] = instanceId.instances.size();
+        for (size_t j = 0; j < getSignatureSize(instanceId.signature) && j < numberOfSampledLists; ++j) {
+            hashValue_t hashID = getSignatureValue(instanceId.signature, j);
             if (hashID != 0 && hashID != MAX_VALUE) {
-                size_t collisionSize = 0; 
-                
-                const vsize_t* instances = mInverseIndexStorage->getElement(j, hashID);
-                
-                if (instances == NULL) continue;
-                if (instances->size() != 0) {
-                    collisionSize = instances->size();
-                } else { 
-                    continue;
-                }
-                
-                if (collisionSize < mMaxBinSize && collisionSize > 0) {
-                    for (size_t k = 0; k < instances->size(); ++k) {
-                        neighborhood[(*instances)[k]] += 1;
-                    }
-                } 
+                costs[i] += mInverseIndexStorage->getElement(j, hashID).size;
             }
         }
+    }
+    const vsize_t order = sortByDecreasingCost(costs);
+    const size_t chunkSize = getDynamicChunkSize(mChunkSize, order.size(), mNumberOfCores);
 
-        if (neighborhood.size() == 0) {
-            vsize_t emptyVectorInt;
-            emptyVectorInt.push_back(1);
-            vfloat emptyVectorFloat;
-            emptyVectorFloat.push_back(1);
 #ifdef OPENMP
-#pragma omp critical
+#pragma omp parallel num_threads(mNumberOfCores)
+#endif
+    {
+#ifdef OPENMP
+        // with a copy of the index on every numa node the threads are bound to the nodes and read their local copy
+        NumaThreadBinding binding(mInverseIndexStorage->hasNumaReplicas(), omp_get_thread_num(), omp_get_num_threads());
+#endif
+        const size_t thread = getThreadNumber();
+        // scratch of the thread, reused by all of its queries
+        CollisionCounter& collisions = getThreadCollisionCounter();
+        collisions.reserve(numberOfInstances);
+        CollisionCounter& probeCollisions = getThreadProbeCounter();
+        if (mMultiProbe) {
+            probeCollisions.reserve(numberOfInstances);
+        }
+        std::vector< sort_map > neighborhoodVectorForSorting;
+        std::vector< sort_map > probeCandidates;
+        // posting lists of a compressed storage are decoded into this buffer
+        vinstanceId_t decodedInstances;
+        // the lists of a query that are visited
+        std::vector<listProbe> probes;
+        // counts of the candidate filter of this thread
+        uint64_t filterCounters[NUMBER_OF_FILTER_COUNTERS] = {0};
+#ifdef OPENMP
+#pragma omp for schedule(dynamic, chunkSize)
 #endif
-            { // write vector to every instance with identical signatures
+        for (size_t position = 0; position < order.size(); ++position) {
+            const uniqueElement& instanceId = pSignatures->getElement(order[position]);
+            if (skipRemovedInstances) {
+                bool allRemoved = true;
+                for (size_t j = 0; j < instanceId.instances.size() && allRemoved; ++j) {
+                    allRemoved = isRemoved(instanceId.instances[j]);
+                }
+                if (allRemoved) {
+                    for (size_t j = 0; j < instanceId.instances.size(); ++j) {
+                        const size_t instance = instanceId.instances[j];
+                        neighbors.setRow(thread, instance, &instance, &zeroDistance, 1);
+                    }
+                    continue;
+                }
+            }
+        
+            // a missing signature has no hash values and gets an empty neighborhood
+            const hashValue_t* signature = instanceId.signature; 
+            probes.clear();
+            for (size_t j = 0; j < getSignatureSize(signature); ++j) {
+                hashValue_t hashID = getSignatureValue(signature, j);
+                if (hashID != 0 && hashID != MAX_VALUE) {
+                    listProbe probe = {j, mInverseIndexStorage->getElement(j, hashID)};
+                    // a list with too many collisions is skipped
+                    if (probe.instances.size > 0 && probe.instances.size < mMaxBinSize) {
+                        probes.push_back(probe);
+                    }
+                }
+            }
+            // with a budget the short lists are visited first, they give the most candidates per collision
+            if (mCandidateBudget != 0) {
+                std::stable_sort(probes.begin(), probes.end(), sortProbeAscBySize);
+            }
+            instanceId_t bestCandidate = 0;
+            uint32_t bestCount = 0;
+            size_t numberOfVisitedLists = 0;
+            for (; numberOfVisitedLists < probes.size(); ++numberOfVisitedLists) {
+                if (mCandidateBudget != 0 && collisions.size() >= mCandidateBudget) break;
+                countCollisions(probes[numberOfVisitedLists].instances, collisions, decodedInstances, bestCandidate, bestCount);
+            }
+            // the collisions are divided by the number of hash functions. if a budget skipped lists they are
+            // divided by the number of visited lists: the skipped ones are not compared, and their collisions
+            // are not estimated from the visited ones, the short lists a budget visits first are no sample of all.
+            size_t numberOfComparedHashFunctions = mMaximalNumberOfHashCollisions;
+            if (numberOfVisitedLists < probes.size()) {
+                numberOfComparedHashFunctions = numberOfVisitedLists;
+            }
+            // multi-probe: the lists of the best candidate that differ from the lists of the query are near
+            // the query in hash space and give more candidates. their hits are no collisions with the query,
+            // they are counted apart and only order the instances that have no collision.
+            const size_t numberOfWantedCandidates = pNneighborhood == MAX_VALUE ? pNneighborhood : pNneighborhood * mExcessFactor;
+            if (mMultiProbe && bestCount > 0 && collisions.size() < numberOfWantedCandidates
+                    && bestCandidate < mInstanceSignatures.size()) {
+                const hashValue_t* bestSignature = mInstanceSignatures[bestCandidate];
+                for (size_t j = 0; j < getSignatureSize(bestSignature); ++j) {
+                    hashValue_t hashID = getSignatureValue(bestSignature, j);
+                    if (hashID == 0 || hashID == MAX_VALUE || hashID == getSignatureValue(signature, j)) continue;
+                    postingList instances = mInverseIndexStorage->getElement(j, hashID);
+                    if (instances.size > 0 && instances.size < mMaxBinSize) {
+                        countProbeCollisions(instances, collisions, probeCollisions, decodedInstances);
+                    }
+                }
+            }
+
+            // candidates by decreasing number of collisions, the counters are zero again afterwards
+            collisions.sortAndReset(neighborhoodVectorForSorting);
+            ++filterCounters[FILTER_QUERIES];
+            filterCounters[FILTER_CANDIDATES] += neighborhoodVectorForSorting.size();
+            for (size_t j = neighborhoodVectorForSorting.size(); j > 0 && neighborhoodVectorForSorting[j - 1].val == 1; --j) {
+                ++filterCounters[FILTER_SINGLE_COLLISION];
+            }
+            // candidate filter: the candidates are sorted, a filter keeps a prefix of them
+            size_t numberOfCandidates = 0;
+            const size_t minimalCollisions = std::max(mMinimalBlocksInCommon, static_cast<size_t>(1));
+            while (numberOfCandidates < neighborhoodVectorForSorting.size()
+                    && neighborhoodVectorForSorting[numberOfCandidates].val >= minimalCollisions) {
+                ++numberOfCandidates;
+            }
+            filterCounters[FILTER_MINIMAL_BLOCKS] += neighborhoodVectorForSorting.size() - numberOfCandidates;
+            if (mCollisionCutoff > 0 && numberOfCandidates > 0) {
+                const size_t cutoffCollisions = ceil(mCollisionCutoff * neighborhoodVectorForSorting[0].val);
+                const size_t numberOfCandidatesAboveMinimal = numberOfCandidates;
+                while (numberOfCandidates > 0 && neighborhoodVectorForSorting[numberOfCandidates - 1].val < cutoffCollisions) {
+                    --numberOfCandidates;
+                }
+                filterCounters[FILTER_COLLISION_CUTOFF] += numberOfCandidatesAboveMinimal - numberOfCandidates;
+            }
+            neighborhoodVectorForSorting.resize(numberOfCandidates);
+            if (probeCollisions.size() > 0) {
+                // the instances found only by multi-probe fill the list up to the wanted number of candidates
+                // after all others, without a collision their distance is 1
+                probeCollisions.sortAndReset(probeCandidates);
+                filterCounters[FILTER_CANDIDATES] += probeCandidates.size();
+                size_t numberOfProbeCandidates = 0;
+                if (numberOfCandidates > 0 && numberOfCandidates < numberOfWantedCandidates) {
+                    numberOfProbeCandidates = std::min(probeCandidates.size(), numberOfWantedCandidates - numberOfCandidates);
+                }
+                filterCounters[FILTER_LIMIT] += probeCandidates.size() - numberOfProbeCandidates;
+                for (size_t j = 0; j < numberOfProbeCandidates; ++j) {
+                    sort_map candidate;
+                    candidate.key = probeCandidates[j].key;
+                    candidate.val = 0;
+                    neighborhoodVectorForSorting.push_back(candidate);
+                }
+                numberOfCandidates += numberOfProbeCandidates;
+            }
+
+            if (numberOfCandidates == 0) {
+                // write the list to every instance with identical signatures
                 if (pNoneSingleInstance) {
-                    
-                    for (size_t j = 0; j < instanceId->second.instances->size(); ++j) {
-                        
-                        (*neighbors)[(*instanceId->second.instances)[j]] = emptyVectorInt;
-                        (*distances)[(*instanceId->second.instances)[j]] = emptyVectorFloat;
+                    for (size_t j = 0; j < instanceId.instances.size(); ++j) {
+                        const size_t instance = instanceId.instances[j];
+                        if (skipRemovedInstances && isRemoved(instance)) {
+                            neighbors.setRow(thread, instance, &instance, &zeroDistance, 1);
+                            continue;
+                        }
+                        neighbors.setRow(thread, instance, &noCandidate, &noCandidateDistance, 1);
                     }
                 } else {
-                    (*neighbors)[0] = emptyVectorInt;
-                    (*distances)[0] = emptyVectorFloat;
+                    neighbors.setRow(thread, 0, &noCandidate, &noCandidateDistance, 1);
                 }
-            } 
-            continue;
-        }
-        std::vector< sort_map > neighborhoodVectorForSorting;
-        for (auto it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-            sort_map mapForSorting;
-            mapForSorting.key = (*it).first;
-            mapForSorting.val = (*it).second;
-            neighborhoodVectorForSorting.push_back(mapForSorting);
-        }
-        size_t numberOfElementsToSort = pNneighborhood * mExcessFactor;
-        if (numberOfElementsToSort > neighborhoodVectorForSorting.size()) {
-            numberOfElementsToSort = neighborhoodVectorForSorting.size();
-        }
-        std::sort(neighborhoodVectorForSorting.begin(), neighborhoodVectorForSorting.end(), mapSortDescByValue);
+                continue;
+            }
         
-        size_t sizeOfNeighborhoodAdjusted;
-        if (pNneighborhood == MAX_VALUE) {
-            sizeOfNeighborhoodAdjusted = std::min(static_cast<size_t>(pNneighborhood), neighborhoodVectorForSorting.size());
-        } else {
+            size_t sizeOfNeighborhoodAdjusted;
+            if (pNneighborhood == MAX_VALUE) {
+                sizeOfNeighborhoodAdjusted = std::min(static_cast<size_t>(pNneighborhood), neighborhoodVectorForSorting.size());
+            } else {
  
-            sizeOfNeighborhoodAdjusted = std::min(static_cast<size_t>(pNneighborhood * mExcessFactor), neighborhoodVectorForSorting.size());
-            if (sizeOfNeighborhoodAdjusted == pNneighborhood * mExcessFactor 
-                    && pNneighborhood * mExcessFactor < neighborhoodVectorForSorting.size()) {
-                for (size_t j = sizeOfNeighborhoodAdjusted; j < neighborhoodVectorForSorting.size(); ++j) {
-                    if (j + 1 < neighborhoodVectorForSorting.size() 
-                            && neighborhoodVectorForSorting[j].val == neighborhoodVectorForSorting[j+1].val) {
-                                ++sizeOfNeighborhoodAdjusted;
-                    } else {
-                        break;
+                sizeOfNeighborhoodAdjusted = std::min(static_cast<size_t>(pNneighborhood * mExcessFactor), neighborhoodVectorForSorting.size());
+                if (sizeOfNeighborhoodAdjusted == pNneighborhood * mExcessFactor 
+                        && pNneighborhood * mExcessFactor < neighborhoodVectorForSorting.size()) {
+                    for (size_t j = sizeOfNeighborhoodAdjusted; j < neighborhoodVectorForSorting.size(); ++j) {
+                        if (j + 1 < neighborhoodVectorForSorting.size() 
+                                && neighborhoodVectorForSorting[j].val == neighborhoodVectorForSorting[j+1].val) {
+                                    ++sizeOfNeighborhoodAdjusted;
+                        } else {
+                            break;
+                        }
                     }
                 }
-            }
             
-        }
-        size_t count = 0;
-        vvsize_t neighborsForThisInstance(instanceId->second.instances->size());
-        vvfloat distancesForThisInstance(instanceId->second.instances->size());
-
-        for (size_t j = 0; j < neighborsForThisInstance.size(); ++j) {
+            }
+            if (mMaxCandidates != 0 && sizeOfNeighborhoodAdjusted > mMaxCandidates) {
+                sizeOfNeighborhoodAdjusted = mMaxCandidates;
+            }
+            filterCounters[FILTER_LIMIT] += neighborhoodVectorForSorting.size() - sizeOfNeighborhoodAdjusted;
+            filterCounters[FILTER_PASSED] += sizeOfNeighborhoodAdjusted;
+            // instances with identical signatures share the list
             vsize_t neighborhoodVector;
-            std::vector<float> distanceVector;
-            for (auto it = neighborhoodVectorForSorting.begin();
-                    it != neighborhoodVectorForSorting.end(); ++it) {
-                float value = 1 - (((*it).val) / (float)(mMaximalNumberOfHashCollisions));
+            vfloat distanceVector;
+            neighborhoodVector.reserve(sizeOfNeighborhoodAdjusted);
+            distanceVector.reserve(sizeOfNeighborhoodAdjusted);
+            for (size_t j = 0; j < sizeOfNeighborhoodAdjusted; ++j) {
+                float collisionProbability = neighborhoodVectorForSorting[j].val / (float)(numberOfComparedHashFunctions);
+                if (mBitsPerHashValue != 0) {
+                    // two different b-bit values collide by chance with probability 2^-b
+                    const float randomCollision = 1.0 / (float) (1ULL << mBitsPerHashValue);
+                    collisionProbability = (collisionProbability - randomCollision) / (1 - randomCollision);
+                }
+                float value = 1 - collisionProbability;
                 if (value < 0) {
                     value = 0;
+                } else if (value > 1) {
+                    value = 1;
                 }
-                if (pRadius == -1.0) {
-                    neighborhoodVector.push_back((*it).key);
-                    distanceVector.push_back(value);
-                } else {
-                    if (value <= pRadius) {
-                        neighborhoodVector.push_back((*it).key);
-                        distanceVector.push_back(value);
-                    } else {
-                        break;
-                    }
-                }    
-                
-                ++count;
-                if (count >= sizeOfNeighborhoodAdjusted) {
-                    neighborsForThisInstance[j] = neighborhoodVector;
-                    distancesForThisInstance[j] = distanceVector;
-                    break;
-                }
+                // the candidates are sorted, all further ones are outside of the radius too
+                if (pRadius != -1.0 && value > pRadius) break;
+                neighborhoodVector.push_back(neighborhoodVectorForSorting[j].key);
+                distanceVector.push_back(value);
             }
-        }
-
-#ifdef OPENMP
-#pragma omp critical
-#endif
 
-        {   // write vector to every instance with identical signatures
+            // write the list to every instance with identical signatures
             if (pNoneSingleInstance) {
-                for (size_t j = 0; j < instanceId->second.instances->size(); ++j) {
-                    
-                    (*neighbors)[(*instanceId->second.instances)[j]] = neighborsForThisInstance[j];
-                    (*distances)[(*instanceId->second.instances)[j]] = distancesForThisInstance[j];
+                for (size_t j = 0; j < instanceId.instances.size(); ++j) {
+                    const size_t instance = instanceId.instances[j];
+                    if (skipRemovedInstances && isRemoved(instance)) {
+                        neighbors.setRow(thread, instance, &instance, &zeroDistance, 1);
+                        continue;
+                    }
+                    neighbors.setRow(thread, instance, neighborhoodVector, distanceVector);
                 }
             } else {
-                (*neighbors)[0] = neighborsForThisInstance[0];
-                (*distances)[0] = distancesForThisInstance[0];
+                neighbors.setRow(thread, 0, neighborhoodVector, distanceVector);
             }
         }
+        for (size_t i = 0; i < NUMBER_OF_FILTER_COUNTERS; ++i) {
+            mCandidateFilterCounters[i].fetch_add(filterCounters[i], std::memory_order_relaxed);
+        }
     }
-    neighborhood* neighborhood_ = new neighborhood();
-    neighborhood_->neighbors = neighbors;
-    neighborhood_->distances = distances;
-
-    return neighborhood_;
+    return neighbors.build(mNumberOfCores);
     
 }
\ No newline at end of file
@@ -20,7 +20,7 @@
 #endif
 
 #include "inverseIndex.h"
-#include "kSizeSortedMap.h"
+#include "kSizeSortedArray.h"
 // #include "kernel.h"
 
 class sort_map {
@@ -10,11 +10,18 @@
  Albert-Ludwigs-University Freiburg im Breisgau
 **/
 
+#include <atomic>
 #include <functional>
+#include <thread>
 #include "hash.h"
 // #include "inverseIndexStorage.h"
-// #include "inverseIndexStorageBloomierFilter.h"
+#include "inverseIndexStorageBloomierFilter.h"
 #include "inverseIndexStorageUnorderedMap.h"
+#include "inverseIndexStorageFlatHashMap.h"
+#include "inverseIndexStorageFrozen.h"
+#include "signatureMatrix.h"
+#include "signatureBatch.h"
+#include "collisionCounter.h"
 #ifdef CUDA
 #include "inverseIndexCuda.h"
 #endif
@@ -23,6 +30,10 @@
 
 #ifndef INVERSE_INDEX_H
 #define INVERSE_INDEX_H
+
+// signature id of a query without a signature view, like a b-bit signature of an instance without features
+#define NO_SIGNATURE_ID SIZE_MAX
+
 class InverseIndex {
 
   protected: 
@@ -48,15 +59,81 @@ class InverseIndex {
     float mCpuGpuLoadBalancing;
     size_t mRangeK_Wta;
     size_t mGpuHash; 
+    // widest vector unit of the cpu: 0 sse4.1, 1 avx2, 2 avx-512
+    size_t mSimdLevel;
+    // b-bit minHash: only the lowest mBitsPerHashValue bits of every signature value are kept and
+    // the signatures are bit-packed into 32 bit words. 0 keeps the full values.
+    size_t mBitsPerHashValue;
+    // number of values of a signature and number of words of a row in the signature matrix
+    size_t mSignatureSize;
+    size_t mSignatureWidth;
+
 
+    // 1 for a removed instance that is still in the lists of the inverse index, 2 after the compaction.
+    // removed instances stay in mSignatureStorage and get no neighbors, they are never returned as neighbors.
+    std::vector<char> mRemovedInstances;
+    size_t mNumberOfUncompactedInstances = 0;
+    // a compaction starts if this fraction of the instances is removed but not compacted, -1 never compacts
+    float mCompactionThreshold;
+    // the compaction builds a new inverse index without the instances of mCompactedInstances on its own thread
+    // and publishes it in mCompactedStorage. queries use the old inverse index until it is swapped in.
+    std::thread mCompactionThread;
+    std::vector<char> mCompactedInstances;
+    std::atomic<InverseIndexStorage*> mCompactedStorage{NULL};
+    // true if update() changed the inverse index and it was not frozen since
+    bool mFreezePending = false;
+    size_t mInverseIndexStorageType;
+    size_t mNumaReplication;
+    // a query stops to visit hash functions as soon as it has this many candidates, 0 visits all of them
+    size_t mCandidateBudget;
+    // a query with too few candidates visits the lists of its best candidate too, the instances found only
+    // there are ranked after all instances that collide with the query. mInstanceSignatures holds the
+    // signature of every instance for it and is empty otherwise
+    size_t mMultiProbe;
+    std::vector<const hashValue_t*> mInstanceSignatures;
+    // candidate filter: a candidate needs mMinimalBlocksInCommon collisions and at least mCollisionCutoff times
+    // the collisions of the best candidate of the query, at most mMaxCandidates are kept, 0 keeps all of them
+    size_t mMaxCandidates;
+    float mCollisionCutoff;
+    enum { FILTER_QUERIES = 0, FILTER_CANDIDATES, FILTER_SINGLE_COLLISION, FILTER_MINIMAL_BLOCKS,
+           FILTER_COLLISION_CUTOFF, FILTER_LIMIT, FILTER_PASSED, NUMBER_OF_FILTER_COUNTERS };
+    // every query thread sums its counts and adds them once at the end of kneighbors
+    std::atomic<uint64_t> mCandidateFilterCounters[NUMBER_OF_FILTER_COUNTERS];
 
-    InverseIndexStorageUnorderedMap* mInverseIndexStorage = NULL;
-  	umap_uniqueElement* mSignatureStorage = NULL;
+    InverseIndexStorage* mInverseIndexStorage = NULL;
+  	SignatureBatch* mSignatureStorage = NULL;
+    Arena* mSignatureArena = NULL;
+    // the signature matrices of all fitted data, mSignatureStorage holds views into them
+    std::vector<SignatureMatrix*> mSignatureMatrices;
     Hash* mHash = NULL;
     #ifdef CUDA
     InverseIndexCuda* mInverseIndexCuda = NULL;
     #endif
-    vsize_t* shingle(vsize_t* pSignature);
+    void shingle(const hashValue_t* pHashValues, hashValue_t* pSignature);
+    bool useSeedWiseKernel(const size_t pSizeOfInstance, const size_t pVectorWidth) const;
+    void packSignature(const hashValue_t* pHashValues, hashValue_t* pSignature) const;
+    hashValue_t* getSignatureView(SparseMatrixFloat* pRawData, SignatureMatrix* pSignatures, const size_t pInstance) const;
+    size_t computeSignatureId(SparseMatrixFloat* pRawData, const size_t pInstance);
+    InverseIndexStorage* createInverseIndexStorage() const;
+    void compact();
+    void installCompaction();
+    void setInstanceSignature(const size_t pInstance, const hashValue_t* pSignature) {
+        if (!mMultiProbe) return;
+        if (mInstanceSignatures.size() <= pInstance) {
+            mInstanceSignatures.resize(pInstance + 1, NULL);
+        }
+        mInstanceSignatures[pInstance] = pSignature;
+    };
+    // count the collisions of a query with the instances of pInstances and keep the instance with the most
+    // collisions in pBestCandidate
+    void countCollisions(const postingList& pInstances, CollisionCounter& pCollisions, vinstanceId_t& pDecodedInstances,
+                            instanceId_t& pBestCandidate, uint32_t& pBestCount) const;
+    // count the instances of pInstances that have no collision with the query in pCollisions into pProbeCollisions
+    void countProbeCollisions(const postingList& pInstances, const CollisionCounter& pCollisions,
+                                CollisionCounter& pProbeCollisions, vinstanceId_t& pDecodedInstances) const;
+    int hashCandidatesWTA_SSE(const uint32_t pValue, const size_t pSeed, const uint32_t* pThresholds, uint32_t* pHashValues);
+    int hashCandidatesWTA_AVX2(const uint32_t pValue, const size_t pSeed, const uint32_t* pThresholds, uint32_t* pHashValues);
+    int hashCandidatesWTA_AVX512(const uint32_t pValue, const size_t pSeed, const uint32_t* pThresholds, uint32_t* pHashValues);
   public:
     InverseIndex();
 
@@ -67,23 +144,76 @@ class InverseIndex {
                     int pPruneInverseIndex, float pPruneInverseIndexAfterInstance,
                     int pRemoveHashFunctionWithLessEntriesAs, size_t pHashAlgorithm, 
                     size_t pBlockSize, size_t pShingle, size_t pRemoveValueWithLeastSigificantBit,
-                    float pCpuGpuLoadBalancing, size_t pGpuHash, size_t pRangeK_Wta);
+                    float pCpuGpuLoadBalancing, size_t pGpuHash, size_t pRangeK_Wta,
+                    size_t pBitsPerHashValue, size_t pInverseIndexStorageType,
+                    float pCompactionThreshold, size_t pNumaReplication,
+                    size_t pCandidateBudget, size_t pMultiProbe,
+                    size_t pMaxCandidates, float pCollisionCutoff);
     ~InverseIndex();
-  	vsize_t* computeSignature(SparseMatrixFloat* pRawData, const size_t pInstance);
-  	vsize_t* computeSignatureSSE(SparseMatrixFloat* pRawData, const size_t pInstance);
+  	void computeSignature(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature);
+  	void computeSignatureSSE(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature);
+  	void computeSignatureAVX2(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature);
+  	void computeSignatureAVX512(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature);
+  	void computeSignatureAVX2Seeds(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature);
+  	void computeSignatureAVX512Seeds(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature);
 
-    vsize_t* computeSignatureWTA(SparseMatrixFloat* pRawData, const size_t pInstance);
-    vvsize_t_p* computeSignatureVectors(SparseMatrixFloat* pRawData, const bool pFitting);
-  	umap_uniqueElement* computeSignatureMap(SparseMatrixFloat* pRawData);
-  	void fit(SparseMatrixFloat* pRawData, size_t pStartIndex=0);
-  	neighborhood* kneighbors(const umap_uniqueElement* pSignaturesMap, 
+    void computeSignatureWTA(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature,
+                                uint32_t* pKeys, float* pWeights);
+    void computeSignatureOPH(SparseMatrixFloat* pRawData, const size_t pInstance, hashValue_t* pSignature,
+                                uint32_t* pMinimumValues, uint32_t* pFilledBins);
+    SignatureMatrix* computeSignatureVectors(SparseMatrixFloat* pRawData, const bool pFitting);
+    // the unique signatures of a query, instances with the same features share one element
+  	SignatureBatch* computeSignatureMap(SparseMatrixFloat* pRawData, SignatureMatrix* pSignatures);
+    // the same for queries that are given without their features, by their signatures and signature ids
+    SignatureBatch* computeSignatureMap(SignatureMatrix* pSignatures, const vsize_t& pSignatureIds);
+    vsize_t computeSignatureIds(SparseMatrixFloat* pRawData);
+  	// returns false without changing the index if its storage can not be extended
+  	bool fit(SparseMatrixFloat* pRawData, size_t pStartIndex=0);
+    // tombstone the instances, the lists of the inverse index are compacted in the background
+    void remove(const vsize_t& pInstances);
+    // replace the instances pInstances by the rows of pRawData, pOriginalData holds their current features.
+    // the instances keep their ids. returns false if the storage can not be extended or an id is invalid.
+    bool update(SparseMatrixFloat* pOriginalData, const vsize_t& pInstances, SparseMatrixFloat* pRawData);
+    // block until a running compaction is done and swap its inverse index in. fit, update and save call it.
+    void waitForCompaction();
+    // swap in the inverse index of a finished compaction and freeze the updates, a running compaction is
+    // not waited for. kneighbors expects that the caller did it, it must not run concurrently with a query.
+    void applyChanges();
+    bool isRemoved(const size_t pInstance) const {
+        return isRemovedInstance(mRemovedInstances, pInstance);
+    };
+    size_t getNumberOfInstances() const {
+        return mSignatureStorage->size() + mDoubleElementsStorageCount;
+    };
+  	neighborhood kneighbors(const SignatureBatch* pSignatures, 
                                 const size_t pNneighborhood, 
                                 const bool pDoubleElementsStorageCount,
                                 const bool pNoneSingleInstance=true, float pRadius = -1.0);
-  	umap_uniqueElement* getSignatureStorage() { 
+    // number of values of a signature; a missing b-bit signature belongs to an instance without features
+    size_t getSignatureSize(const hashValue_t* pSignature) const {
+        if (pSignature == NULL) return 0;
+        return mSignatureSize;
+    };
+    // the value stored in the inverse index for hash function pIndex; a b-bit value is shifted by one
+    // to keep 0 as marker for no value
+    hashValue_t getSignatureValue(const hashValue_t* pSignature, const size_t pIndex) const {
+        if (mBitsPerHashValue == 0) return pSignature[pIndex];
+        const size_t bitPosition = pIndex * mBitsPerHashValue;
+        return ((pSignature[bitPosition / 32] >> (bitPosition % 32)) & ((1ULL << mBitsPerHashValue) - 1)) + 1;
+    };
+  	SignatureBatch* getSignatureStorage() { 
       return mSignatureStorage;
     };
+    // number of hashValue_t in one row of a SignatureMatrix of this index
+    size_t getSignatureWidth() const {
+        return mSignatureWidth;
+    };
     distributionInverseIndex* getDistribution();
+    // the counters of the candidate filter since the creation of the index or the last reset
+    candidateFilterStatistics getCandidateFilterStatistics(bool pReset);
+    // write the signature storage and the inverse index to an index file / use them from a mapped index file
+    bool save(IndexFileWriter* pWriter);
+    bool load(const MappedIndexFile* pFile);
     vvsize_t_p* computeSignaturesOnGpu(SparseMatrixFloat* pRawData, size_t pStartIndex, size_t pEndIndex, size_t pNumberOfInstances,
     size_t pNumberOfBlocks, size_t pNumberOfThreads);
                 
@@ -57,7 +57,7 @@ void InverseIndexCuda::computeSignaturesFittingOnGpu(SparseMatrixFloat* pRawData
                                                 size_t pNumberOfInstances, size_t pNumberOfBlocks, 
                                                 size_t pNumberOfThreads, size_t pShingleFactor, 
                                                 size_t pBlockSizeShingle,
-                                                vvsize_t_p* pSignatures, size_t pRangeK) {
+                                                SignatureMatrix* pSignatures, size_t pRangeK) {
     // copy data to gpu
     int* mDev_FeatureList;
     size_t* mDev_SizeOfInstanceList;
@@ -105,13 +105,12 @@ void InverseIndexCuda::computeSignaturesFittingOnGpu(SparseMatrixFloat* pRawData
                 cudaMemcpyDeviceToHost);
     cudaDeviceSynchronize();
                     
-    // copy values into one vector per instance
+    // copy values into the rows of the signature matrix
     for(size_t i = 0; i < pRawData->size(); ++i) {
-        vsize_t* instance = new vsize_t(signaturesSize);
+        hashValue_t* instance = pSignatures->getSignature(i);
         for (size_t j = 0; j < signaturesSize; ++j) {
-            (*instance)[j] = static_cast<size_t> (instancesHashValues[i*signaturesSize + j]);
+            instance[j] = static_cast<hashValue_t> (instancesHashValues[i*signaturesSize + j]);
         }
-        (*pSignatures)[i] = instance;
     }
     cudaDeviceSynchronize();
     free(instancesHashValues);
@@ -128,7 +127,7 @@ void InverseIndexCuda::computeSignaturesQueryOnGpu(SparseMatrixFloat* pRawData,
                                                 size_t pNumberOfInstances, size_t pNumberOfBlocks, 
                                                 size_t pNumberOfThreads, size_t pShingleFactor, 
                                                 size_t pBlockSizeShingle,
-                                                vvsize_t_p* pSignatures, size_t pRangeK) {
+                                                SignatureMatrix* pSignatures, size_t pRangeK) {
       // copy data to gpu
     int* featureList;
     float* valueList;
@@ -175,13 +174,12 @@ void InverseIndexCuda::computeSignaturesQueryOnGpu(SparseMatrixFloat* pRawData,
                 cudaMemcpyDeviceToHost);
     cudaDeviceSynchronize();
                     
-    // copy values into one vector per instance
+    // copy values into the rows of the signature matrix
     for(size_t i = 0; i < pRawData->size(); ++i) {
-        vsize_t* instance = new vsize_t(signaturesSize);
+        hashValue_t* instance = pSignatures->getSignature(i);
         for (size_t j = 0; j < signaturesSize; ++j) {
-            (*instance)[j] = static_cast<size_t> (instancesHashValues[i*signaturesSize + j]);
+            instance[j] = static_cast<hashValue_t> (instancesHashValues[i*signaturesSize + j]);
         }
-        (*pSignatures)[i] = instance;
     }
     cudaDeviceSynchronize();
     free(instancesHashValues);
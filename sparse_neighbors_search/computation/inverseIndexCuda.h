@@ -11,6 +11,7 @@
 **/
 
 #include "typeDefinitions.h"
+#include "signatureMatrix.h"
 // #include "kernel.h"
 #ifndef INVERSE_INDEX_CUDA_H
 #define INVERSE_INDEX_CUDA_H
@@ -41,7 +42,7 @@ class InverseIndexCuda {
                                         size_t pNumberOfInstances, size_t pNumberOfBlocks, 
                                         size_t pNumberOfThreads, size_t pShingleFactor, 
                                         size_t pBlockSizeShingle,
-                                        vvsize_t_p* pSignatures, size_t pRangeK);
+                                        SignatureMatrix* pSignatures, size_t pRangeK);
     // void copyFittingDataToGpu(SparseMatrixFloat* pRawData, size_t pStartIndex);
     
    void computeSignaturesQueryOnGpu(SparseMatrixFloat* pRawData, 
@@ -49,7 +50,7 @@ class InverseIndexCuda {
                                                 size_t pNumberOfInstances, size_t pNumberOfBlocks, 
                                                 size_t pNumberOfThreads, size_t pShingleFactor, 
                                                 size_t pBlockSizeShingle,
-                                                vvsize_t_p* pSignatures, size_t pRangeK);
+                                                SignatureMatrix* pSignatures, size_t pRangeK);
 //    int** get_mDev_FeatureList() {
 //        return &mDev_FeatureList;
 //    };
@@ -0,0 +1,208 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include "typeDefinitions.h"
+
+#ifndef INVERSE_INDEX_STATISTICS_H
+#define INVERSE_INDEX_STATISTICS_H
+
+// longest posting list the histogram counts exactly, longer lists are counted at this size
+#define INVERSE_INDEX_STATISTICS_MAX_LIST_SIZE 4096
+// number of parts of the histogram, the hash functions are spread over them
+#define INVERSE_INDEX_STATISTICS_HISTOGRAM_STRIPES 16
+
+// counters of an inverse index that every change of a posting list updates, the distribution is read from them
+// without walking the tables. for every hash function: the number of hash values, the number of stored ids and the
+// sum of the squared list sizes. the histogram of the list sizes is kept for the whole index, a hash value with too
+// many collisions has an empty list and is counted at size 0.
+// the counters of one hash function have a single writer at a time, like the inserts of fit, so they are updated
+// without atomic read-modify-write. the histogram is shared by all hash functions and updated atomically, it is
+// split into stripes by hash function so that threads inserting into different hash functions rarely write the
+// same counters. readers take no lock, a distribution read during a change can mix counts from before and after it.
+class InverseIndexStatistics {
+  private:
+    enum { NUMBER_OF_HASH_VALUES = 0, NUMBER_OF_INSTANCES, SUM_OF_SQUARED_SIZES, REMOVED, NUMBER_OF_COUNTERS = 8 };
+    size_t mNumberOfHashFunctions;
+    size_t mHistogramSize;
+    // number of counters per stripe of the histogram, a multiple of a cache line
+    size_t mHistogramStride;
+    // NUMBER_OF_COUNTERS per hash function followed by the stripes of the histogram
+    std::atomic<uint64_t>* mCounters;
+    std::atomic<uint64_t>* mHistogram;
+    size_t getNumberOfCounters() const {
+        return mNumberOfHashFunctions * NUMBER_OF_COUNTERS + INVERSE_INDEX_STATISTICS_HISTOGRAM_STRIPES * mHistogramStride;
+    };
+    std::atomic<uint64_t>* getCounters(size_t pVectorId) const {
+        return mCounters + pVectorId * NUMBER_OF_COUNTERS;
+    };
+    uint64_t get(size_t pVectorId, size_t pCounter) const {
+        return getCounters(pVectorId)[pCounter].load(std::memory_order_relaxed);
+    };
+    void add(size_t pVectorId, size_t pCounter, uint64_t pValue) {
+        std::atomic<uint64_t>& counter = getCounters(pVectorId)[pCounter];
+        counter.store(counter.load(std::memory_order_relaxed) + pValue, std::memory_order_relaxed);
+    };
+    void addToHistogram(size_t pVectorId, size_t pSize, uint64_t pValue) {
+        const size_t stripe = pVectorId % INVERSE_INDEX_STATISTICS_HISTOGRAM_STRIPES;
+        mHistogram[stripe * mHistogramStride + std::min(pSize, mHistogramSize - 1)].fetch_add(pValue, std::memory_order_relaxed);
+    };
+  public:
+    InverseIndexStatistics(size_t pNumberOfHashFunctions, size_t pMaxBinSize) {
+        mNumberOfHashFunctions = pNumberOfHashFunctions;
+        mHistogramSize = std::min(pMaxBinSize, static_cast<size_t>(INVERSE_INDEX_STATISTICS_MAX_LIST_SIZE)) + 1;
+        mHistogramStride = (mHistogramSize + 7) / 8 * 8;
+        mCounters = new std::atomic<uint64_t>[getNumberOfCounters()];
+        mHistogram = mCounters + mNumberOfHashFunctions * NUMBER_OF_COUNTERS;
+        for (size_t i = 0; i < getNumberOfCounters(); ++i) {
+            mCounters[i].store(0, std::memory_order_relaxed);
+        }
+    };
+    ~InverseIndexStatistics() {
+        delete [] mCounters;
+    };
+    void addList(size_t pVectorId, size_t pSize) {
+        add(pVectorId, NUMBER_OF_HASH_VALUES, 1);
+        add(pVectorId, NUMBER_OF_INSTANCES, pSize);
+        add(pVectorId, SUM_OF_SQUARED_SIZES, pSize * pSize);
+        addToHistogram(pVectorId, pSize, 1);
+    };
+    void removeList(size_t pVectorId, size_t pSize) {
+        add(pVectorId, NUMBER_OF_HASH_VALUES, -1);
+        add(pVectorId, NUMBER_OF_INSTANCES, -pSize);
+        add(pVectorId, SUM_OF_SQUARED_SIZES, -(pSize * pSize));
+        addToHistogram(pVectorId, pSize, -1);
+    };
+    void resizeList(size_t pVectorId, size_t pOldSize, size_t pNewSize) {
+        if (pOldSize == pNewSize) return;
+        add(pVectorId, NUMBER_OF_INSTANCES, pNewSize - pOldSize);
+        add(pVectorId, SUM_OF_SQUARED_SIZES, pNewSize * pNewSize - pOldSize * pOldSize);
+        addToHistogram(pVectorId, pOldSize, -1);
+        addToHistogram(pVectorId, pNewSize, 1);
+    };
+    // replace the lists with pOldSizes of pVectorId by lists with pSizes, for storages that rebuild a hash function at once
+    void setLists(size_t pVectorId, const vsize_t& pOldSizes, const vsize_t& pSizes) {
+        uint64_t numberOfInstances = 0;
+        uint64_t sumOfSquaredSizes = 0;
+        for (size_t i = 0; i < pOldSizes.size(); ++i) {
+            addToHistogram(pVectorId, pOldSizes[i], -1);
+        }
+        for (size_t i = 0; i < pSizes.size(); ++i) {
+            numberOfInstances += pSizes[i];
+            sumOfSquaredSizes += pSizes[i] * pSizes[i];
+            addToHistogram(pVectorId, pSizes[i], 1);
+        }
+        getCounters(pVectorId)[NUMBER_OF_HASH_VALUES].store(pSizes.size(), std::memory_order_relaxed);
+        getCounters(pVectorId)[NUMBER_OF_INSTANCES].store(numberOfInstances, std::memory_order_relaxed);
+        getCounters(pVectorId)[SUM_OF_SQUARED_SIZES].store(sumOfSquaredSizes, std::memory_order_relaxed);
+    };
+    // the histogram keeps the lists of pVectorId until they are removed by removeList or setLists
+    void removeHashFunction(size_t pVectorId) {
+        for (size_t i = 0; i < NUMBER_OF_COUNTERS; ++i) {
+            getCounters(pVectorId)[i].store(0, std::memory_order_relaxed);
+        }
+        getCounters(pVectorId)[REMOVED].store(1, std::memory_order_relaxed);
+    };
+    void assign(const InverseIndexStatistics* pStatistics) {
+        if (pStatistics->getNumberOfCounters() != getNumberOfCounters()) return;
+        for (size_t i = 0; i < getNumberOfCounters(); ++i) {
+            mCounters[i].store(pStatistics->mCounters[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    };
+    size_t getNumberOfHashValues(size_t pVectorId) const {
+        return get(pVectorId, NUMBER_OF_HASH_VALUES);
+    };
+    // mean and standard deviation of the number of hash values of the hash functions that are not removed
+    void getMomentsOfNumberOfHashValues(size_t* pMean, size_t* pStandardDeviation) const {
+        double sum = 0;
+        double sumOfSquares = 0;
+        size_t numberOfHashFunctions = 0;
+        for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+            if (get(i, REMOVED)) continue;
+            const double numberOfHashValues = get(i, NUMBER_OF_HASH_VALUES);
+            sum += numberOfHashValues;
+            sumOfSquares += numberOfHashValues * numberOfHashValues;
+            ++numberOfHashFunctions;
+        }
+        *pMean = 0;
+        *pStandardDeviation = 0;
+        if (numberOfHashFunctions == 0) return;
+        const double mean = sum / numberOfHashFunctions;
+        *pMean = mean;
+        *pStandardDeviation = sqrt(std::max(sumOfSquares / numberOfHashFunctions - mean * mean, 0.0));
+    };
+    distributionInverseIndex* getDistribution() const {
+        distributionInverseIndex* retVal = new distributionInverseIndex();
+        vsize_t histogram(mHistogramSize, 0);
+        for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+            if (get(i, REMOVED)) continue;
+            const size_t numberOfHashValues = get(i, NUMBER_OF_HASH_VALUES);
+            double mean = 0;
+            double variance = 0;
+            if (numberOfHashValues != 0) {
+                mean = static_cast<double>(get(i, NUMBER_OF_INSTANCES)) / numberOfHashValues;
+                variance = std::max(static_cast<double>(get(i, SUM_OF_SQUARED_SIZES)) / numberOfHashValues - mean * mean, 0.0);
+            }
+            retVal->numberOfCreatedHashValuesPerHashFunction.push_back(numberOfHashValues);
+            retVal->meanForNumberOfValuesPerHashValue.push_back(static_cast<size_t>(mean));
+            retVal->standardDeviationForNumberOfValuesPerHashValue.push_back(static_cast<size_t>(sqrt(variance)));
+        }
+        for (size_t stripe = 0; stripe < INVERSE_INDEX_STATISTICS_HISTOGRAM_STRIPES; ++stripe) {
+            for (size_t j = 0; j < mHistogramSize; ++j) {
+                histogram[j] += mHistogram[stripe * mHistogramStride + j].load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t j = 0; j < mHistogramSize; ++j) {
+            if (histogram[j] != 0) {
+                retVal->totalCountForOccurenceOfHashValues[j] = histogram[j];
+            }
+        }
+        getMomentsOfNumberOfHashValues(&retVal->mean, &retVal->standardDeviation);
+
+        // quantiles of the sizes of the posting lists that were not cleared
+        retVal->numberOfOverflowedHashValues = histogram[0];
+        size_t numberOfLists = 0;
+        for (size_t j = 1; j < mHistogramSize; ++j) {
+            numberOfLists += histogram[j];
+        }
+        const float quantiles[] = {0.5, 0.9, 0.99, 1.0};
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(float); ++q) {
+            const size_t rank = ceil(quantiles[q] * numberOfLists);
+            size_t count = 0;
+            size_t size = 0;
+            for (size_t j = 1; j < mHistogramSize && count < rank; ++j) {
+                count += histogram[j];
+                size = j;
+            }
+            retVal->quantiles.push_back(quantiles[q]);
+            retVal->sizeOfPostingListAtQuantile.push_back(size);
+        }
+        return retVal;
+    };
+    // the counters as one array, for the index file
+    std::vector<uint64_t> save() const {
+        std::vector<uint64_t> counters(getNumberOfCounters());
+        for (size_t i = 0; i < counters.size(); ++i) {
+            counters[i] = mCounters[i].load(std::memory_order_relaxed);
+        }
+        return counters;
+    };
+    bool load(const uint64_t* pCounters, size_t pSize) {
+        if (pSize != getNumberOfCounters()) return false;
+        for (size_t i = 0; i < pSize; ++i) {
+            mCounters[i].store(pCounters[i], std::memory_order_relaxed);
+        }
+        return true;
+    };
+};
+#endif // INVERSE_INDEX_STATISTICS_H
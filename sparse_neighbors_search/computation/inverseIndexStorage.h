@@ -1,4 +1,6 @@
 #include "typeDefinitions.h"
+#include "indexFile.h"
+#include "inverseIndexStatistics.h"
 #ifndef INVERSE_INDEX_STORAGE_H
 #define INVERSE_INDEX_STORAGE_H
 class InverseIndexStorage {
@@ -6,13 +8,31 @@ class InverseIndexStorage {
     // virtual InverseIndexStorage() = 0;
     virtual ~InverseIndexStorage() = 0;
 	virtual size_t size() const = 0;
-	virtual const vsize_t* getElement(size_t pVectorId, size_t pHashValue) = 0;
-	virtual void insert(size_t pVectorId, size_t pHashValue, size_t pInstance, size_t pRemoveValueWithLeastSigificantBit) = 0;
+	virtual postingList getElement(size_t pVectorId, hashValue_t pHashValue) = 0;
+    // fit calls insert from several threads, each with its own set of hash functions pVectorId
+	virtual void insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit) = 0;
+    // read from counters the storage keeps up to date, it does not lock and can run during queries
     virtual distributionInverseIndex* getDistribution() = 0;
     virtual void prune(size_t pValue) = 0;
     virtual void removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs) = 0;
-    virtual vector__umapVector_ptr* getIndex() = 0;
+    // make room for pNumberOfInstances more instances in the table of every hash function
     virtual void reserveSpaceForMaps(size_t pNumberOfInstances) = 0;
+    // remove pInstance from the list of pHashValue, a list with too many collisions stays empty
+    virtual void erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance) = 0;
+    // false if inserts are ignored
+    virtual bool canInsert() const { return true; };
+    // called at the end of every fit. storages that collect the inserts and build a read-only
+    // layout afterwards do it here, the others have nothing to do.
+    virtual void freeze() { };
+    // true if every numa node has a copy of the index, queries should then run on threads bound to the nodes
+    virtual bool hasNumaReplicas() const { return false; };
+    // write the index to / use the index in place from an index file. only storages with a flat
+    // layout support this, the others return false.
+    virtual bool save(IndexFileWriter* /* pWriter */) { return false; };
+    virtual bool load(const MappedIndexFile* /* pFile */) { return false; };
 };
 inline InverseIndexStorage::~InverseIndexStorage() { }
+inline bool isRemovedInstance(const std::vector<char>& pRemovedInstances, const size_t pInstance) {
+    return pInstance < pRemovedInstances.size() && pRemovedInstances[pInstance];
+}
 #endif // INVERSE_INDEX_STORAGE_H
\ No newline at end of file
@@ -0,0 +1,208 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include "inverseIndexStorageBloomierFilter.h"
+
+#define BLOOMIER_FINGERPRINT_BITS 8
+#define BLOOMIER_MAX_ATTEMPTS 64
+
+// 64 bit finalizer of splitmix64
+static uint64_t mix64(uint64_t pValue) {
+    pValue = (pValue ^ (pValue >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    pValue = (pValue ^ (pValue >> 27)) * 0x94d049bb133111ebULL;
+    return pValue ^ (pValue >> 31);
+}
+static bitVector fingerprint(uint64_t pHash) {
+    return static_cast<bitVector>(pHash ^ (pHash >> 32));
+}
+
+InverseIndexStorageBloomierFilter::InverseIndexStorageBloomierFilter(size_t pSizeOfInverseIndex, size_t pMaxBinSize, size_t pNumberOfCores) {
+    mNumberOfHashFunctions = pSizeOfInverseIndex;
+    mMaxBinSize = pMaxBinSize;
+    mNumberOfCores = pNumberOfCores;
+    mBuilder = new InverseIndexStorageFrozen(pSizeOfInverseIndex, pMaxBinSize, pNumberOfCores, false, false);
+    mSeed = 0;
+    mSegmentLength = 0;
+    mRemovedHashFunctions.resize(pSizeOfInverseIndex, 0);
+    mStatistics = new InverseIndexStatistics(pSizeOfInverseIndex, pMaxBinSize);
+}
+InverseIndexStorageBloomierFilter::~InverseIndexStorageBloomierFilter() {
+    delete mBuilder;
+    delete mStatistics;
+}
+size_t InverseIndexStorageBloomierFilter::size() const {
+    return mNumberOfHashFunctions;
+}
+void InverseIndexStorageBloomierFilter::reserveSpaceForMaps(size_t pNumberOfInstances) {
+    if (mBuilder != NULL) mBuilder->reserveSpaceForMaps(pNumberOfInstances);
+}
+void InverseIndexStorageBloomierFilter::insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit) {
+    if (mBuilder != NULL) mBuilder->insert(pVectorId, pHashValue, pInstance, pRemoveValueWithLeastSigificantBit);
+}
+void InverseIndexStorageBloomierFilter::prune(size_t pValue) {
+    if (mBuilder != NULL) mBuilder->prune(pValue);
+}
+void InverseIndexStorageBloomierFilter::removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs) {
+    if (mBuilder != NULL) mBuilder->removeHashFunctionWithLessEntriesAs(pRemoveHashFunctionWithLessEntriesAs);
+}
+void InverseIndexStorageBloomierFilter::erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance) {
+    if (mBuilder != NULL) mBuilder->erase(pVectorId, pHashValue, pInstance);
+}
+
+uint64_t InverseIndexStorageBloomierFilter::hashKey(size_t pVectorId, hashValue_t pHashValue) const {
+    return mix64(((static_cast<uint64_t>(pVectorId) << 32) | pHashValue) + mSeed);
+}
+// one slot in each of the three segments
+void InverseIndexStorageBloomierFilter::getSlots(uint64_t pHash, size_t* pSlots) const {
+    const uint64_t rotated1 = (pHash << 21) | (pHash >> 43);
+    const uint64_t rotated2 = (pHash << 42) | (pHash >> 22);
+    pSlots[0] = ((pHash & 0xFFFFFFFF) * mSegmentLength) >> 32;
+    pSlots[1] = mSegmentLength + (((rotated1 & 0xFFFFFFFF) * mSegmentLength) >> 32);
+    pSlots[2] = 2 * mSegmentLength + (((rotated2 & 0xFFFFFFFF) * mSegmentLength) >> 32);
+}
+
+// xor filter construction: peel the keys that are the only key of one of their slots, then assign the
+// slots in reverse peeling order so that the xor of the three slots of every key gives its value.
+// returns false if the keys could not be peeled with the current seed.
+bool InverseIndexStorageBloomierFilter::buildFilter(const vsize_t& pPositions, const vhashValue_t& pKeys, const vsize_t& pKeyOffsets) {
+    const size_t numberOfKeys = pKeys.size();
+    const size_t numberOfSlots = 3 * mSegmentLength;
+    std::vector<uint32_t> count(numberOfSlots, 0);
+    vsize_t xorKeyIndex(numberOfSlots, 0);
+    std::vector<uint64_t> xorHash(numberOfSlots, 0);
+    size_t slots[3];
+    for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+        for (size_t key = pKeyOffsets[i]; key < pKeyOffsets[i + 1]; ++key) {
+            const uint64_t hash = hashKey(i, pKeys[key]);
+            getSlots(hash, slots);
+            for (size_t j = 0; j < 3; ++j) {
+                ++count[slots[j]];
+                xorKeyIndex[slots[j]] ^= key;
+                xorHash[slots[j]] ^= hash;
+            }
+        }
+    }
+    vsize_t queue;
+    for (size_t i = 0; i < numberOfSlots; ++i) {
+        if (count[i] == 1) queue.push_back(i);
+    }
+    // peeled keys with the slot they are assigned to
+    vsize_t peeledKeys;
+    vsize_t peeledSlots;
+    std::vector<uint64_t> peeledHashes;
+    peeledKeys.reserve(numberOfKeys);
+    peeledSlots.reserve(numberOfKeys);
+    peeledHashes.reserve(numberOfKeys);
+    while (!queue.empty()) {
+        const size_t slot = queue.back();
+        queue.pop_back();
+        if (count[slot] != 1) continue;
+        const size_t key = xorKeyIndex[slot];
+        const uint64_t hash = xorHash[slot];
+        peeledKeys.push_back(key);
+        peeledSlots.push_back(slot);
+        peeledHashes.push_back(hash);
+        getSlots(hash, slots);
+        for (size_t j = 0; j < 3; ++j) {
+            --count[slots[j]];
+            xorKeyIndex[slots[j]] ^= key;
+            xorHash[slots[j]] ^= hash;
+            if (count[slots[j]] == 1) queue.push_back(slots[j]);
+        }
+    }
+    if (peeledKeys.size() != numberOfKeys) return false;
+
+    mFingerprints.assign(numberOfSlots, 0);
+    mValues.assign(numberOfSlots, 0);
+    for (size_t i = numberOfKeys; i-- > 0;) {
+        getSlots(peeledHashes[i], slots);
+        const size_t slot = peeledSlots[i];
+        bitVector fingerprintValue = fingerprint(peeledHashes[i]);
+        bloomierValue_t value = pPositions[peeledKeys[i]];
+        for (size_t j = 0; j < 3; ++j) {
+            if (slots[j] == slot) continue;
+            fingerprintValue ^= mFingerprints[slots[j]];
+            value ^= mValues[slots[j]];
+        }
+        mFingerprints[slot] = fingerprintValue;
+        mValues[slot] = value;
+    }
+    return true;
+}
+
+// builds the filter from the read-only index of the builder. if the posting lists do not fit into the range
+// of bloomierValue_t the builder is kept and answers the queries.
+void InverseIndexStorageBloomierFilter::freeze() {
+    if (mBuilder == NULL) return;
+    mBuilder->freeze();
+    const size_t numberOfKeys = mBuilder->mKeyOffsetsView[mNumberOfHashFunctions];
+    const size_t numberOfPostings = mBuilder->mPostingOffsetsView[numberOfKeys];
+    if (numberOfKeys + numberOfPostings > std::numeric_limits<bloomierValue_t>::max()) return;
+
+    vhashValue_t keys(mBuilder->mKeysView, mBuilder->mKeysView + numberOfKeys);
+    vsize_t keyOffsets(mBuilder->mKeyOffsetsView, mBuilder->mKeyOffsetsView + mNumberOfHashFunctions + 1);
+    vsize_t positions(numberOfKeys);
+    vinstanceId_t postings;
+    postings.reserve(numberOfKeys + numberOfPostings);
+    for (size_t key = 0; key < numberOfKeys; ++key) {
+        const size_t start = mBuilder->mPostingOffsetsView[key];
+        const size_t end = mBuilder->mPostingOffsetsView[key + 1];
+        positions[key] = postings.size();
+        postings.push_back(end - start);
+        postings.insert(postings.end(), mBuilder->mPostingsView + start, mBuilder->mPostingsView + end);
+    }
+    std::vector<char> removedHashFunctions = mBuilder->mRemovedHashFunctions;
+    // the filter needs about 1.23 slots per key, a few seeds may fail to peel
+    mSegmentLength = (numberOfKeys * 123 / 100 + 32) / 3 + 1;
+    bool built = false;
+    for (size_t attempt = 0; attempt < BLOOMIER_MAX_ATTEMPTS && !built; ++attempt) {
+        mSeed = mix64(attempt + 1);
+        built = buildFilter(positions, keys, keyOffsets);
+    }
+    if (!built) {
+        std::vector<bitVector>().swap(mFingerprints);
+        std::vector<bloomierValue_t>().swap(mValues);
+        return;
+    }
+    mPostings.swap(postings);
+    mRemovedHashFunctions.swap(removedHashFunctions);
+    mStatistics->assign(mBuilder->mStatistics);
+    delete mBuilder;
+    mBuilder = NULL;
+}
+
+postingList InverseIndexStorageBloomierFilter::getElement(size_t pVectorId, hashValue_t pHashValue) {
+    if (mBuilder != NULL) return mBuilder->getElement(pVectorId, pHashValue);
+    postingList element;
+    element.instances = NULL;
+    element.size = 0;
+    element.compressed = NULL;
+    if (pVectorId >= mNumberOfHashFunctions || mRemovedHashFunctions[pVectorId] || mFingerprints.size() == 0) return element;
+    const uint64_t hash = hashKey(pVectorId, pHashValue);
+    size_t slots[3];
+    getSlots(hash, slots);
+    if ((mFingerprints[slots[0]] ^ mFingerprints[slots[1]] ^ mFingerprints[slots[2]]) != fingerprint(hash)) return element;
+    const size_t position = mValues[slots[0]] ^ mValues[slots[1]] ^ mValues[slots[2]];
+    if (position >= mPostings.size()) return element;
+    const size_t size = mPostings[position];
+    if (position + size >= mPostings.size()) return element;
+    element.instances = mPostings.data() + position + 1;
+    element.size = size;
+    return element;
+}
+
+distributionInverseIndex* InverseIndexStorageBloomierFilter::getDistribution() {
+    if (mBuilder != NULL) return mBuilder->getDistribution();
+    distributionInverseIndex* retVal = mStatistics->getDistribution();
+    // the fingerprint test, the range checks of the position reject a few more
+    retVal->falsePositiveRate = 1.0 / (1 << BLOOMIER_FINGERPRINT_BITS);
+    return retVal;
+}
@@ -0,0 +1,66 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include "inverseIndexStorage.h"
+#include "inverseIndexStorageFrozen.h"
+
+#ifndef INVERSE_INDEX_STORAGE_BLOOMIER_FILTER_H
+#define INVERSE_INDEX_STORAGE_BLOOMIER_FILTER_H
+
+// position of a posting list in mPostings
+#ifdef LARGE_INDEX
+typedef uint64_t bloomierValue_t;
+#else
+typedef uint32_t bloomierValue_t;
+#endif
+
+// read-only inverse index without stored hash values. a bloomier filter in xor filter layout maps the
+// pair (hash function, hash value) to the position of its posting list: the key selects one slot in each
+// of three segments, the xor of the three slot values is the position and the xor of the three fingerprints
+// must match the fingerprint of the key. a key that was not inserted passes the fingerprint test with
+// probability 2^-8 and then gets the posting list of another key.
+// the posting lists are stored one after the other in mPostings, each one prefixed by its length.
+// during fitting the inserts, pruning and max bin size are handled by an InverseIndexStorageFrozen, freeze()
+// builds the filter from it and releases it. the index can not be extended afterwards, further inserts
+// are ignored. erasures and removed instances are not applied to the filter either, the inverse index
+// filters removed instances from the lists.
+class InverseIndexStorageBloomierFilter : public InverseIndexStorage {
+  private:
+    size_t mNumberOfHashFunctions;
+    size_t mMaxBinSize;
+    size_t mNumberOfCores;
+    InverseIndexStorageFrozen* mBuilder = NULL;
+    uint64_t mSeed;
+    size_t mSegmentLength;
+    std::vector<bitVector> mFingerprints;
+    std::vector<bloomierValue_t> mValues;
+    vinstanceId_t mPostings;
+    std::vector<char> mRemovedHashFunctions;
+    // taken over from the builder, the filter does not change afterwards
+    InverseIndexStatistics* mStatistics = NULL;
+    uint64_t hashKey(size_t pVectorId, hashValue_t pHashValue) const;
+    void getSlots(uint64_t pHash, size_t* pSlots) const;
+    bool buildFilter(const vsize_t& pPositions, const vhashValue_t& pKeys, const vsize_t& pKeyOffsets);
+  public:
+    InverseIndexStorageBloomierFilter(size_t pSizeOfInverseIndex, size_t pMaxBinSize, size_t pNumberOfCores);
+    ~InverseIndexStorageBloomierFilter();
+    size_t size() const;
+    postingList getElement(size_t pVectorId, hashValue_t pHashValue);
+    void insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit);
+    distributionInverseIndex* getDistribution();
+    void prune(size_t pValue);
+    void removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs);
+    void reserveSpaceForMaps(size_t pNumberOfInstances);
+    void erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance);
+    bool canInsert() const { return mBuilder != NULL; };
+    void freeze();
+};
+#endif // INVERSE_INDEX_STORAGE_BLOOMIER_FILTER_H
@@ -0,0 +1,281 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <string.h>
+#include "inverseIndexStorageFlatHashMap.h"
+
+InverseIndexStorageFlatHashMap::InverseIndexStorageFlatHashMap(size_t pSizeOfInverseIndex, size_t pMaxBinSize) {
+    mInverseIndex = new std::vector<flatTable*>(pSizeOfInverseIndex);
+    for (size_t i = 0; i < mInverseIndex->size(); ++i) {
+        (*mInverseIndex)[i] = createTable(16);
+    }
+    mMaxBinSize = pMaxBinSize;
+    mStatistics = new InverseIndexStatistics(pSizeOfInverseIndex, pMaxBinSize);
+}
+InverseIndexStorageFlatHashMap::~InverseIndexStorageFlatHashMap() {
+    for (size_t i = 0; i < mInverseIndex->size(); ++i) {
+        deleteTable((*mInverseIndex)[i]);
+    }
+    delete mInverseIndex;
+    delete mStatistics;
+}
+flatTable* InverseIndexStorageFlatHashMap::createTable(size_t pCapacity) {
+    flatTable* table = new flatTable();
+    table->capacity = pCapacity;
+    table->shift = 64 - __builtin_ctzll(pCapacity);
+    table->size = 0;
+    table->slots = new flatSlot[pCapacity];
+    memset(table->slots, 0, pCapacity * sizeof(flatSlot));
+    return table;
+}
+void InverseIndexStorageFlatHashMap::deleteTable(flatTable* pTable) {
+    if (pTable == NULL) return;
+    for (size_t i = 0; i < pTable->capacity; ++i) {
+        if (pTable->slots[i].probeLength != 0 && pTable->slots[i].size > FLAT_SLOT_INLINE_INSTANCES) {
+            delete [] pTable->slots[i].instances;
+        }
+    }
+    delete [] pTable->slots;
+    delete pTable;
+}
+// move all slots to a new array of pCapacity slots, the posting lists stay where they are
+void InverseIndexStorageFlatHashMap::rehash(flatTable* pTable, size_t pCapacity) {
+    flatSlot* oldSlots = pTable->slots;
+    size_t oldCapacity = pTable->capacity;
+    pTable->capacity = pCapacity;
+    pTable->shift = 64 - __builtin_ctzll(pCapacity);
+    pTable->size = 0;
+    pTable->slots = new flatSlot[pCapacity];
+    memset(pTable->slots, 0, pCapacity * sizeof(flatSlot));
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldSlots[i].probeLength == 0) continue;
+        insertSlot(pTable, oldSlots[i]);
+    }
+    delete [] oldSlots;
+}
+// robin hood insertion: a slot closer to its home slot than pSlot gives its place to pSlot
+// and is inserted further on. pSlot must not be in the table.
+void InverseIndexStorageFlatHashMap::insertSlot(flatTable* pTable, flatSlot pSlot) {
+    const size_t mask = pTable->capacity - 1;
+    size_t position = homeSlot(pTable, pSlot.hashValue);
+    pSlot.probeLength = 1;
+    while (pTable->slots[position].probeLength != 0) {
+        if (pTable->slots[position].probeLength < pSlot.probeLength) {
+            std::swap(pTable->slots[position], pSlot);
+        }
+        position = (position + 1) & mask;
+        ++pSlot.probeLength;
+    }
+    pTable->slots[position] = pSlot;
+    ++pTable->size;
+}
+// backward shift deletion, the following slots move one position closer to their home slots
+void InverseIndexStorageFlatHashMap::eraseSlot(flatTable* pTable, size_t pPosition) {
+    const size_t mask = pTable->capacity - 1;
+    if (pTable->slots[pPosition].size > FLAT_SLOT_INLINE_INSTANCES) {
+        delete [] pTable->slots[pPosition].instances;
+    }
+    size_t next = (pPosition + 1) & mask;
+    while (pTable->slots[next].probeLength > 1) {
+        pTable->slots[pPosition] = pTable->slots[next];
+        --pTable->slots[pPosition].probeLength;
+        pPosition = next;
+        next = (next + 1) & mask;
+    }
+    pTable->slots[pPosition].probeLength = 0;
+    --pTable->size;
+}
+flatSlot* InverseIndexStorageFlatHashMap::findSlot(const flatTable* pTable, hashValue_t pHashValue) const {
+    const size_t mask = pTable->capacity - 1;
+    size_t position = homeSlot(pTable, pHashValue);
+    // a slot closer to its home slot than the probe means the hash value is not stored, it would have taken the slot
+    for (uint32_t probeLength = 1; pTable->slots[position].probeLength >= probeLength; ++probeLength) {
+        if (pTable->slots[position].hashValue == pHashValue) {
+            return &(pTable->slots[position]);
+        }
+        position = (position + 1) & mask;
+    }
+    return NULL;
+}
+void InverseIndexStorageFlatHashMap::pushInstance(flatSlot* pSlot, instanceId_t pInstance) {
+    if (pSlot->size < FLAT_SLOT_INLINE_INSTANCES) {
+        pSlot->inlineInstances[pSlot->size] = pInstance;
+    } else if (pSlot->size == FLAT_SLOT_INLINE_INSTANCES) {
+        // move the posting list out of the slot
+        instanceId_t* instances = new instanceId_t[2 * FLAT_SLOT_INLINE_INSTANCES];
+        memcpy(instances, pSlot->inlineInstances, FLAT_SLOT_INLINE_INSTANCES * sizeof(instanceId_t));
+        instances[pSlot->size] = pInstance;
+        pSlot->instances = instances;
+        pSlot->capacity = 2 * FLAT_SLOT_INLINE_INSTANCES;
+    } else {
+        if (pSlot->size == pSlot->capacity) {
+            instanceId_t* instances = new instanceId_t[2 * pSlot->capacity];
+            memcpy(instances, pSlot->instances, pSlot->size * sizeof(instanceId_t));
+            delete [] pSlot->instances;
+            pSlot->instances = instances;
+            pSlot->capacity *= 2;
+        }
+        pSlot->instances[pSlot->size] = pInstance;
+    }
+    ++pSlot->size;
+}
+// remove pInstance from the list of pSlot, a heap list that gets short enough moves back into the slot.
+void InverseIndexStorageFlatHashMap::removeFromSlot(flatSlot* pSlot, instanceId_t pInstance) {
+    const bool onHeap = pSlot->size > FLAT_SLOT_INLINE_INSTANCES;
+    instanceId_t* instances = onHeap ? pSlot->instances : pSlot->inlineInstances;
+    size_t size = 0;
+    for (size_t i = 0; i < pSlot->size; ++i) {
+        if (instances[i] != pInstance) instances[size++] = instances[i];
+    }
+    if (onHeap && size <= FLAT_SLOT_INLINE_INSTANCES) {
+        memcpy(pSlot->inlineInstances, instances, size * sizeof(instanceId_t));
+        delete [] instances;
+    }
+    pSlot->size = size;
+}
+size_t InverseIndexStorageFlatHashMap::size() const {
+    return mInverseIndex->size();
+}
+void InverseIndexStorageFlatHashMap::reserveSpaceForMaps(size_t pNumberOfInstances) {
+    // the load factor stays below 7/8
+    for (size_t i = 0; i < mInverseIndex->size(); ++i) {
+        flatTable* table = (*mInverseIndex)[i];
+        if (table == NULL) continue;
+        const size_t numberOfValues = table->size + pNumberOfInstances;
+        size_t capacity = table->capacity;
+        while (capacity * 7 < numberOfValues * 8) {
+            capacity *= 2;
+        }
+        if (capacity != table->capacity) {
+            rehash(table, capacity);
+        }
+    }
+}
+void InverseIndexStorageFlatHashMap::insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit) {
+    if (mInverseIndex == NULL) return;
+    if (pVectorId >= mInverseIndex->size()) {
+        return;
+    }
+    if (pRemoveValueWithLeastSigificantBit) {
+        size_t leastSignificantBits = 0b11111111111111111111111111111111 << pRemoveValueWithLeastSigificantBit;
+        size_t insertValue = pHashValue | leastSignificantBits;
+        if (insertValue != leastSignificantBits) {
+            return;
+        }
+    }
+    flatTable* table = (*mInverseIndex)[pVectorId];
+    if (table == NULL) return;
+
+    flatSlot* slot = findSlot(table, pHashValue);
+    if (slot != NULL) {
+        // same rules as the unordered map: an empty posting list marks a hash value with too many collisions
+        if (slot->size && slot->size < mMaxBinSize) {
+            pushInstance(slot, pInstance);
+            mStatistics->resizeList(pVectorId, slot->size - 1, slot->size);
+        } else {
+            if (slot->size > FLAT_SLOT_INLINE_INSTANCES) {
+                delete [] slot->instances;
+            }
+            mStatistics->resizeList(pVectorId, slot->size, 0);
+            slot->size = 0;
+        }
+    } else {
+        if ((table->size + 1) * 8 > table->capacity * 7) {
+            rehash(table, table->capacity * 2);
+        }
+        flatSlot newSlot;
+        memset(&newSlot, 0, sizeof(flatSlot));
+        newSlot.hashValue = pHashValue;
+        newSlot.inlineInstances[0] = pInstance;
+        newSlot.size = 1;
+        insertSlot(table, newSlot);
+        mStatistics->addList(pVectorId, 1);
+    }
+}
+
+postingList InverseIndexStorageFlatHashMap::getElement(size_t pVectorId, hashValue_t pHashValue) {
+    postingList element;
+    element.instances = NULL;
+    element.size = 0;
+    element.compressed = NULL;
+    if (mInverseIndex == NULL) return element;
+    if (pVectorId >= mInverseIndex->size() || (*mInverseIndex)[pVectorId] == NULL) return element;
+    const flatSlot* slot = findSlot((*mInverseIndex)[pVectorId], pHashValue);
+    if (slot != NULL) {
+        element.instances = getInstances(slot);
+        element.size = slot->size;
+    }
+    return element;
+}
+
+distributionInverseIndex* InverseIndexStorageFlatHashMap::getDistribution() {
+    return mStatistics->getDistribution();
+}
+void InverseIndexStorageFlatHashMap::prune(size_t pValue) {
+    if (mInverseIndex == NULL) return;
+    for (auto it = mInverseIndex->begin(); it != mInverseIndex->end(); ++it) {
+        if ((*it) == NULL) continue;
+        size_t i = 0;
+        while (i < (*it)->capacity) {
+            // the erase shifts the next slot to position i, it is checked in the next iteration
+            if ((*it)->slots[i].probeLength != 0 && (*it)->slots[i].size <= pValue) {
+                mStatistics->removeList(it - mInverseIndex->begin(), (*it)->slots[i].size);
+                eraseSlot(*it, i);
+            } else {
+                ++i;
+            }
+        }
+    }
+}
+
+void InverseIndexStorageFlatHashMap::erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance) {
+    if (mInverseIndex == NULL || pVectorId >= mInverseIndex->size()) return;
+    flatTable* table = (*mInverseIndex)[pVectorId];
+    if (table == NULL) return;
+    flatSlot* slot = findSlot(table, pHashValue);
+    if (slot == NULL || slot->size == 0) return;
+    const size_t size = slot->size;
+    removeFromSlot(slot, pInstance);
+    if (slot->size == 0) {
+        mStatistics->removeList(pVectorId, size);
+        eraseSlot(table, slot - table->slots);
+    } else {
+        mStatistics->resizeList(pVectorId, size, slot->size);
+    }
+}
+
+// if pRemoveHashFunctionWithLessEntriesAs == 0 remove every hash function
+// which has less entries than mean+standard deviation
+// else: remove every hash function which has less entries than pRemoveHashFunctionWithLessEntriesAs
+void InverseIndexStorageFlatHashMap::removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs) {
+    if (mInverseIndex == NULL) return;
+    size_t threshold = pRemoveHashFunctionWithLessEntriesAs;
+    if (pRemoveHashFunctionWithLessEntriesAs == 0) {
+        size_t mean;
+        size_t standardDeviation;
+        mStatistics->getMomentsOfNumberOfHashValues(&mean, &standardDeviation);
+        threshold = mean + standardDeviation;
+    }
+    for (size_t i = 0; i < mInverseIndex->size(); ++i) {
+        if ((*mInverseIndex)[i] == NULL) continue;
+        if ((*mInverseIndex)[i]->size < threshold) {
+            const flatTable* table = (*mInverseIndex)[i];
+            for (size_t j = 0; j < table->capacity; ++j) {
+                if (table->slots[j].probeLength != 0) {
+                    mStatistics->removeList(i, table->slots[j].size);
+                }
+            }
+            deleteTable((*mInverseIndex)[i]);
+            (*mInverseIndex)[i] = NULL;
+            mStatistics->removeHashFunction(i);
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include "inverseIndexStorage.h"
+
+#ifndef INVERSE_INDEX_STORAGE_FLAT_HASH_MAP_H
+#define INVERSE_INDEX_STORAGE_FLAT_HASH_MAP_H
+
+// number of instance ids a slot stores without a heap allocation
+#define FLAT_SLOT_INLINE_INSTANCES (16 / sizeof(instanceId_t))
+
+// one slot of an open addressing table, two slots share a cache line.
+// short posting lists are stored in the slot itself, longer ones in a heap array.
+struct flatSlot {
+    union {
+        instanceId_t inlineInstances[FLAT_SLOT_INLINE_INSTANCES];
+        instanceId_t* instances;
+    };
+    hashValue_t hashValue;
+    uint32_t size;
+    // capacity of the heap array
+    uint32_t capacity;
+    // distance to the home slot plus one, 0 marks an empty slot
+    uint32_t probeLength;
+};
+
+struct flatTable {
+    flatSlot* slots;
+    // number of slots, always a power of two
+    size_t capacity;
+    size_t shift;
+    // number of stored hash values
+    size_t size;
+};
+
+// inverse index with one robin hood hash table per hash function. a lookup touches
+// the home slot of the hash value and the following slots, the posting list is in the slot
+// if it is short, so most lookups cost a single cache miss.
+class InverseIndexStorageFlatHashMap : public InverseIndexStorage {
+  private:
+    std::vector<flatTable*>* mInverseIndex = NULL;
+    size_t mMaxBinSize;
+    InverseIndexStatistics* mStatistics = NULL;
+    flatTable* createTable(size_t pCapacity);
+    void deleteTable(flatTable* pTable);
+    void rehash(flatTable* pTable, size_t pCapacity);
+    void insertSlot(flatTable* pTable, flatSlot pSlot);
+    void eraseSlot(flatTable* pTable, size_t pPosition);
+    flatSlot* findSlot(const flatTable* pTable, hashValue_t pHashValue) const;
+    void pushInstance(flatSlot* pSlot, instanceId_t pInstance);
+    void removeFromSlot(flatSlot* pSlot, instanceId_t pInstance);
+    size_t homeSlot(const flatTable* pTable, hashValue_t pHashValue) const {
+        return (pHashValue * 0x9E3779B97F4A7C15ULL) >> pTable->shift;
+    };
+    const instanceId_t* getInstances(const flatSlot* pSlot) const {
+        if (pSlot->size <= FLAT_SLOT_INLINE_INSTANCES) return pSlot->inlineInstances;
+        return pSlot->instances;
+    };
+  public:
+    InverseIndexStorageFlatHashMap(size_t pSizeOfInverseIndex, size_t pMaxBinSize);
+    ~InverseIndexStorageFlatHashMap();
+    size_t size() const;
+    postingList getElement(size_t pVectorId, hashValue_t pHashValue);
+    void insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit);
+    distributionInverseIndex* getDistribution();
+    void prune(size_t pValue);
+    void removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs);
+    // pre-size every table for pNumberOfInstances hash values
+    void reserveSpaceForMaps(size_t pNumberOfInstances);
+    void erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance);
+};
+#endif // INVERSE_INDEX_STORAGE_FLAT_HASH_MAP_H
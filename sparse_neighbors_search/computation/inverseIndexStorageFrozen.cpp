@@ -0,0 +1,464 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <algorithm>
+#include "inverseIndexStorageFrozen.h"
+
+// stable least significant digit radix sort of pKeys, pValues are moved with their keys.
+// passes where all keys have the same digit are skipped.
+static void radixSort(vhashValue_t& pKeys, vinstanceId_t& pValues) {
+    if (pKeys.size() < 2) return;
+    vhashValue_t keys(pKeys.size());
+    vinstanceId_t values(pValues.size());
+    for (size_t shift = 0; shift < sizeof(hashValue_t) * 8; shift += 8) {
+        size_t count[257] = {0};
+        for (size_t i = 0; i < pKeys.size(); ++i) {
+            ++count[((pKeys[i] >> shift) & 0xFF) + 1];
+        }
+        if (count[((pKeys[0] >> shift) & 0xFF) + 1] == pKeys.size()) continue;
+        for (size_t i = 1; i < 257; ++i) {
+            count[i] += count[i - 1];
+        }
+        for (size_t i = 0; i < pKeys.size(); ++i) {
+            size_t position = count[(pKeys[i] >> shift) & 0xFF]++;
+            keys[position] = pKeys[i];
+            values[position] = pValues[i];
+        }
+        pKeys.swap(keys);
+        pValues.swap(values);
+    }
+}
+
+// length of a posting list in vbyte coding: 7 bits per byte, the high bit marks a following byte
+static size_t encodeLength(size_t pLength, uint8_t* pOut) {
+    size_t i = 0;
+    while (pLength >= 0x80) {
+        pOut[i++] = (pLength & 0x7F) | 0x80;
+        pLength >>= 7;
+    }
+    pOut[i++] = pLength;
+    return i;
+}
+static size_t decodeLength(const uint8_t** pIn) {
+    size_t length = 0;
+    size_t shift = 0;
+    while (**pIn & 0x80) {
+        length |= static_cast<size_t>(**pIn & 0x7F) << shift;
+        shift += 7;
+        ++(*pIn);
+    }
+    length |= static_cast<size_t>(**pIn) << shift;
+    ++(*pIn);
+    return length;
+}
+
+InverseIndexStorageFrozen::InverseIndexStorageFrozen(size_t pSizeOfInverseIndex, size_t pMaxBinSize, size_t pNumberOfCores, bool pCompressPostingLists,
+                                                     bool pNumaReplication) {
+    mNumberOfHashFunctions = pSizeOfInverseIndex;
+    mMaxBinSize = pMaxBinSize;
+    mNumberOfCores = pNumberOfCores;
+    mNumaReplication = pNumaReplication;
+#ifdef LARGE_INDEX
+    // the codec works on 32 bit ids
+    mCompressPostingLists = false;
+#else
+    mCompressPostingLists = pCompressPostingLists;
+#endif
+    mKeyOffsets.resize(pSizeOfInverseIndex + 1, 0);
+    mPostingOffsets.resize(1, 0);
+    mRemovedHashFunctions.resize(pSizeOfInverseIndex, 0);
+    mPendingHashValues.resize(pSizeOfInverseIndex);
+    mPendingInstances.resize(pSizeOfInverseIndex);
+    mPendingErasures.resize(pSizeOfInverseIndex);
+    mStatistics = new InverseIndexStatistics(pSizeOfInverseIndex, pMaxBinSize);
+    updateViews();
+}
+InverseIndexStorageFrozen::~InverseIndexStorageFrozen() {
+    deleteReplicas();
+    delete mStatistics;
+}
+size_t InverseIndexStorageFrozen::size() const {
+    return mNumberOfHashFunctions;
+}
+void InverseIndexStorageFrozen::reserveSpaceForMaps(size_t pNumberOfInstances) {
+    for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+        mPendingHashValues[i].reserve(mPendingHashValues[i].size() + pNumberOfInstances);
+        mPendingInstances[i].reserve(mPendingInstances[i].size() + pNumberOfInstances);
+    }
+}
+void InverseIndexStorageFrozen::insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit) {
+    if (pVectorId >= mNumberOfHashFunctions) {
+        return;
+    }
+    if (pRemoveValueWithLeastSigificantBit) {
+        size_t leastSignificantBits = 0b11111111111111111111111111111111 << pRemoveValueWithLeastSigificantBit;
+        size_t insertValue = pHashValue | leastSignificantBits;
+        if (insertValue != leastSignificantBits) {
+            return;
+        }
+    }
+    if (mRemovedHashFunctions[pVectorId]) return;
+    mPendingHashValues[pVectorId].push_back(pHashValue);
+    mPendingInstances[pVectorId].push_back(pInstance);
+}
+void InverseIndexStorageFrozen::erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance) {
+    if (pVectorId >= mNumberOfHashFunctions || mRemovedHashFunctions[pVectorId]) return;
+    mPendingErasures[pVectorId].push_back(std::make_pair(pHashValue, pInstance));
+}
+bool InverseIndexStorageFrozen::hasPendingChanges() const {
+    for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+        if (mPendingHashValues[i].size() != 0 || mPendingErasures[i].size() != 0) return true;
+    }
+    return false;
+}
+// number of ids of the hash value mKeys[pKey], pData is set to the coded ids if the lists are compressed
+size_t InverseIndexStorageFrozen::getPostingListSize(const size_t pKey, const uint8_t** pData) const {
+    if (!mCompressPostingLists) {
+        return mPostingOffsetsView[pKey + 1] - mPostingOffsetsView[pKey];
+    }
+    *pData = mCompressedPostingsView + mPostingOffsetsView[pKey];
+    return decodeLength(pData);
+}
+void InverseIndexStorageFrozen::appendPostingList(const size_t pKey, vinstanceId_t& pInstances) const {
+    if (!mCompressPostingLists) {
+        pInstances.insert(pInstances.end(), mPostingsView + mPostingOffsetsView[pKey],
+                            mPostingsView + mPostingOffsetsView[pKey + 1]);
+        return;
+    }
+    const uint8_t* data = NULL;
+    const size_t size = getPostingListSize(pKey, &data);
+    const size_t start = pInstances.size();
+    pInstances.resize(start + size);
+    streamVByteDecode(data, size, reinterpret_cast<uint32_t*>(pInstances.data() + start));
+}
+// appends the coded list to pOut and returns the number of bytes
+size_t InverseIndexStorageFrozen::encodePostingList(const instanceId_t* pInstances, const size_t pSize, std::vector<uint8_t>& pOut) const {
+    const size_t start = pOut.size();
+    pOut.resize(start + 10 + streamVByteMaxSize(pSize));
+    size_t length = encodeLength(pSize, pOut.data() + start);
+    length += streamVByteEncode(reinterpret_cast<const uint32_t*>(pInstances), pSize, pOut.data() + start + length);
+    pOut.resize(start + length);
+    return length;
+}
+// merge the sorted inserts of every hash function into its part of the index. for every hash value the
+// instance ids are added in insert order like the other storages do: a hash value with more than mMaxBinSize ids
+// keeps an empty list and never gets ids again. the erasures are applied to the built lists before the inserts,
+// a list they empty is deleted. if pPrune is set, every hash value with not more than pPruneValue ids is removed.
+void InverseIndexStorageFrozen::build(const bool pPrune, const size_t pPruneValue) {
+    std::vector<vhashValue_t> keys(mNumberOfHashFunctions);
+    std::vector<vsize_t> sizes(mNumberOfHashFunctions);
+    std::vector<vinstanceId_t> postings(mNumberOfHashFunctions);
+    std::vector< std::vector<uint8_t> > compressedPostings(mNumberOfHashFunctions);
+
+#pragma omp parallel for schedule(dynamic) num_threads(mNumberOfCores)
+    for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+        vhashValue_t& pendingHashValues = mPendingHashValues[i];
+        vinstanceId_t& pendingInstances = mPendingInstances[i];
+        std::vector< std::pair<hashValue_t, instanceId_t> >& pendingErasures = mPendingErasures[i];
+        if (!mRemovedHashFunctions[i]) {
+            radixSort(pendingHashValues, pendingInstances);
+            std::sort(pendingErasures.begin(), pendingErasures.end());
+            size_t key = mKeyOffsetsView[i];
+            const size_t keyEnd = mKeyOffsetsView[i + 1];
+            size_t pending = 0;
+            size_t erasure = 0;
+            while (key < keyEnd || pending < pendingHashValues.size()) {
+                hashValue_t hashValue;
+                if (pending == pendingHashValues.size() || (key < keyEnd && mKeysView[key] <= pendingHashValues[pending])) {
+                    hashValue = mKeysView[key];
+                } else {
+                    hashValue = pendingHashValues[pending];
+                }
+                const size_t start = postings[i].size();
+                bool stored = false;
+                if (key < keyEnd && mKeysView[key] == hashValue) {
+                    appendPostingList(key, postings[i]);
+                    ++key;
+                    const size_t size = postings[i].size() - start;
+                    for (; erasure < pendingErasures.size() && pendingErasures[erasure].first <= hashValue; ++erasure) {
+                        if (pendingErasures[erasure].first != hashValue) continue;
+                        auto position = std::find(postings[i].begin() + start, postings[i].end(), pendingErasures[erasure].second);
+                        if (position != postings[i].end()) postings[i].erase(position);
+                    }
+                    // an empty list with too many collisions is kept
+                    stored = size == 0 || postings[i].size() != start;
+                }
+                for (; pending < pendingHashValues.size() && pendingHashValues[pending] == hashValue; ++pending) {
+                    const size_t size = postings[i].size() - start;
+                    if (!stored || (size && size < mMaxBinSize)) {
+                        postings[i].push_back(pendingInstances[pending]);
+                        stored = true;
+                    } else {
+                        // too many collisions
+                        postings[i].resize(start);
+                    }
+                }
+                if (!stored || (pPrune && postings[i].size() - start <= pPruneValue)) {
+                    postings[i].resize(start);
+                    continue;
+                }
+                keys[i].push_back(hashValue);
+                sizes[i].push_back(postings[i].size() - start);
+            }
+        }
+        vhashValue_t().swap(pendingHashValues);
+        vinstanceId_t().swap(pendingInstances);
+        std::vector< std::pair<hashValue_t, instanceId_t> >().swap(pendingErasures);
+        // the built lists replace the old ones, a removed hash function loses all of its lists
+        vsize_t oldSizes;
+        oldSizes.reserve(mKeyOffsetsView[i + 1] - mKeyOffsetsView[i]);
+        for (size_t key = mKeyOffsetsView[i]; key < mKeyOffsetsView[i + 1]; ++key) {
+            const uint8_t* data = NULL;
+            oldSizes.push_back(getPostingListSize(key, &data));
+        }
+        mStatistics->setLists(i, oldSizes, sizes[i]);
+        if (mCompressPostingLists) {
+            // the sizes become byte lengths of the coded lists
+            size_t offset = 0;
+            for (size_t j = 0; j < sizes[i].size(); ++j) {
+                const size_t size = sizes[i][j];
+                sizes[i][j] = encodePostingList(postings[i].data() + offset, size, compressedPostings[i]);
+                offset += size;
+            }
+            vinstanceId_t().swap(postings[i]);
+        }
+    }
+
+    // pack the parts of all hash functions into the flat arrays
+    vsize_t keyOffsets(mNumberOfHashFunctions + 1, 0);
+    vsize_t postingStart(mNumberOfHashFunctions + 1, 0);
+    for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+        keyOffsets[i + 1] = keyOffsets[i] + keys[i].size();
+        postingStart[i + 1] = postingStart[i] + postings[i].size() + compressedPostings[i].size();
+    }
+    vhashValue_t flatKeys(keyOffsets[mNumberOfHashFunctions]);
+    vsize_t postingOffsets(keyOffsets[mNumberOfHashFunctions] + 1);
+    vinstanceId_t flatPostings;
+    std::vector<uint8_t> flatCompressedPostings;
+    if (mCompressPostingLists) {
+        // the decoder reads up to 16 bytes behind a list
+        flatCompressedPostings.resize(postingStart[mNumberOfHashFunctions] + 16, 0);
+    } else {
+        flatPostings.resize(postingStart[mNumberOfHashFunctions]);
+    }
+    postingOffsets[keyOffsets[mNumberOfHashFunctions]] = postingStart[mNumberOfHashFunctions];
+
+#pragma omp parallel for schedule(dynamic) num_threads(mNumberOfCores)
+    for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+        size_t offset = postingStart[i];
+        for (size_t j = 0; j < keys[i].size(); ++j) {
+            flatKeys[keyOffsets[i] + j] = keys[i][j];
+            postingOffsets[keyOffsets[i] + j] = offset;
+            offset += sizes[i][j];
+        }
+        if (mCompressPostingLists) {
+            std::copy(compressedPostings[i].begin(), compressedPostings[i].end(), flatCompressedPostings.begin() + postingStart[i]);
+        } else {
+            std::copy(postings[i].begin(), postings[i].end(), flatPostings.begin() + postingStart[i]);
+        }
+        vhashValue_t().swap(keys[i]);
+        vsize_t().swap(sizes[i]);
+        vinstanceId_t().swap(postings[i]);
+        std::vector<uint8_t>().swap(compressedPostings[i]);
+    }
+    mKeys.swap(flatKeys);
+    mKeyOffsets.swap(keyOffsets);
+    mPostingOffsets.swap(postingOffsets);
+    mPostings.swap(flatPostings);
+    mCompressedPostings.swap(flatCompressedPostings);
+    updateViews();
+    replicate();
+}
+void InverseIndexStorageFrozen::updateViews() {
+    mKeysView = mKeys.data();
+    mKeyOffsetsView = mKeyOffsets.data();
+    mPostingOffsetsView = mPostingOffsets.data();
+    mPostingsView = mPostings.data();
+    mCompressedPostingsView = mCompressedPostings.data();
+}
+// copy the arrays the views point to into the memory of every numa node. the copy of a node is allocated
+// and first written by a thread bound to the node, so its pages are placed there. the arrays are released
+// and the views point to the copy of node 0 afterwards.
+void InverseIndexStorageFrozen::replicate() {
+    const size_t numberOfNodes = NumaTopology::get().getNumberOfNodes();
+    if (!mNumaReplication || numberOfNodes < 2) return;
+    const size_t numberOfKeys = mKeyOffsetsView[mNumberOfHashFunctions];
+    const size_t postingsEnd = mPostingOffsetsView[numberOfKeys];
+    std::vector<frozenReplica*> replicas(numberOfNodes);
+
+#pragma omp parallel for schedule(static, 1) num_threads(numberOfNodes)
+    for (size_t node = 0; node < numberOfNodes; ++node) {
+        NumaThreadBinding binding(true, node, numberOfNodes);
+        frozenReplica* replica = new frozenReplica();
+        replica->keys.assign(mKeysView, mKeysView + numberOfKeys);
+        replica->keyOffsets.assign(mKeyOffsetsView, mKeyOffsetsView + mNumberOfHashFunctions + 1);
+        replica->postingOffsets.assign(mPostingOffsetsView, mPostingOffsetsView + numberOfKeys + 1);
+        if (mCompressPostingLists) {
+            replica->compressedPostings.assign(mCompressedPostingsView, mCompressedPostingsView + postingsEnd + 16);
+        } else {
+            replica->postings.assign(mPostingsView, mPostingsView + postingsEnd);
+        }
+        replicas[node] = replica;
+    }
+    deleteReplicas();
+    mReplicas.swap(replicas);
+    vhashValue_t().swap(mKeys);
+    vsize_t().swap(mKeyOffsets);
+    vsize_t().swap(mPostingOffsets);
+    vinstanceId_t().swap(mPostings);
+    std::vector<uint8_t>().swap(mCompressedPostings);
+    mKeysView = mReplicas[0]->keys.data();
+    mKeyOffsetsView = mReplicas[0]->keyOffsets.data();
+    mPostingOffsetsView = mReplicas[0]->postingOffsets.data();
+    mPostingsView = mReplicas[0]->postings.data();
+    mCompressedPostingsView = mReplicas[0]->compressedPostings.data();
+}
+void InverseIndexStorageFrozen::deleteReplicas() {
+    for (size_t i = 0; i < mReplicas.size(); ++i) {
+        delete mReplicas[i];
+    }
+    mReplicas.clear();
+}
+void InverseIndexStorageFrozen::freeze() {
+    if (hasPendingChanges()) {
+        build(false, 0);
+    }
+}
+
+postingList InverseIndexStorageFrozen::getElement(size_t pVectorId, hashValue_t pHashValue) {
+    postingList element;
+    element.instances = NULL;
+    element.size = 0;
+    element.compressed = NULL;
+    if (pVectorId >= mNumberOfHashFunctions || mRemovedHashFunctions[pVectorId]) return element;
+    const hashValue_t* keys = mKeysView;
+    const size_t* keyOffsets = mKeyOffsetsView;
+    const size_t* postingOffsets = mPostingOffsetsView;
+    const instanceId_t* postings = mPostingsView;
+    const uint8_t* compressedPostings = mCompressedPostingsView;
+    if (mReplicas.size() != 0) {
+        // the copy in the memory of the node the thread is bound to
+        const frozenReplica* replica = mReplicas[currentNumaNode() % mReplicas.size()];
+        keys = replica->keys.data();
+        keyOffsets = replica->keyOffsets.data();
+        postingOffsets = replica->postingOffsets.data();
+        postings = replica->postings.data();
+        compressedPostings = replica->compressedPostings.data();
+    }
+    const hashValue_t* begin = keys + keyOffsets[pVectorId];
+    const hashValue_t* end = keys + keyOffsets[pVectorId + 1];
+    const hashValue_t* position = std::lower_bound(begin, end, pHashValue);
+    if (position != end && *position == pHashValue) {
+        const size_t key = position - keys;
+        if (mCompressPostingLists) {
+            element.compressed = compressedPostings + postingOffsets[key];
+            element.size = decodeLength(&element.compressed);
+        } else {
+            element.instances = postings + postingOffsets[key];
+            element.size = postingOffsets[key + 1] - postingOffsets[key];
+        }
+    }
+    return element;
+}
+
+distributionInverseIndex* InverseIndexStorageFrozen::getDistribution() {
+    return mStatistics->getDistribution();
+}
+void InverseIndexStorageFrozen::prune(size_t pValue) {
+    build(true, pValue);
+}
+
+// if pRemoveHashFunctionWithLessEntriesAs == 0 remove every hash function
+// which has less entries than mean+standard deviation
+// else: remove every hash function which has less entries than pRemoveHashFunctionWithLessEntriesAs
+void InverseIndexStorageFrozen::removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs) {
+    freeze();
+    size_t threshold = pRemoveHashFunctionWithLessEntriesAs;
+    if (pRemoveHashFunctionWithLessEntriesAs == 0) {
+        size_t mean;
+        size_t standardDeviation;
+        mStatistics->getMomentsOfNumberOfHashValues(&mean, &standardDeviation);
+        threshold = mean + standardDeviation;
+    }
+    bool removed = false;
+    for (size_t i = 0; i < mNumberOfHashFunctions; ++i) {
+        if (mRemovedHashFunctions[i]) continue;
+        if (mKeyOffsetsView[i + 1] - mKeyOffsetsView[i] < threshold) {
+            mRemovedHashFunctions[i] = 1;
+            mStatistics->removeHashFunction(i);
+            removed = true;
+        }
+    }
+    // drop the removed parts from the arrays
+    if (removed) {
+        build(false, 0);
+    }
+}
+
+bool InverseIndexStorageFrozen::save(IndexFileWriter* pWriter) {
+    freeze();
+    const size_t numberOfKeys = mKeyOffsetsView[mNumberOfHashFunctions];
+    const size_t postingsEnd = mPostingOffsetsView[numberOfKeys];
+    pWriter->writeSection(SECTION_REMOVED_HASH_FUNCTIONS, mRemovedHashFunctions.data(), mNumberOfHashFunctions);
+    pWriter->writeSection(SECTION_KEYS, mKeysView, numberOfKeys * sizeof(hashValue_t));
+    pWriter->writeSection(SECTION_KEY_OFFSETS, mKeyOffsetsView, (mNumberOfHashFunctions + 1) * sizeof(size_t));
+    pWriter->writeSection(SECTION_POSTING_OFFSETS, mPostingOffsetsView, (numberOfKeys + 1) * sizeof(size_t));
+    if (mCompressPostingLists) {
+        // with the 16 readable bytes the decoder needs behind the last list
+        pWriter->writeSection(SECTION_POSTINGS, mCompressedPostingsView, postingsEnd + 16);
+    } else {
+        pWriter->writeSection(SECTION_POSTINGS, mPostingsView, postingsEnd * sizeof(instanceId_t));
+    }
+    const std::vector<uint64_t> statistics = mStatistics->save();
+    pWriter->writeSection(SECTION_INVERSE_INDEX_STATISTICS, statistics.data(), statistics.size() * sizeof(uint64_t));
+    return true;
+}
+// the arrays are used in place from the mapping, only the removed hash functions and the statistics are copied
+bool InverseIndexStorageFrozen::load(const MappedIndexFile* pFile) {
+    if (pFile->getSectionSize(SECTION_REMOVED_HASH_FUNCTIONS) != mNumberOfHashFunctions
+            || pFile->getSectionSize(SECTION_KEY_OFFSETS) != (mNumberOfHashFunctions + 1) * sizeof(size_t)) {
+        return false;
+    }
+    const size_t* keyOffsets = static_cast<const size_t*>(pFile->getSection(SECTION_KEY_OFFSETS));
+    const size_t numberOfKeys = keyOffsets[mNumberOfHashFunctions];
+    if (pFile->getSectionSize(SECTION_KEYS) != numberOfKeys * sizeof(hashValue_t)
+            || pFile->getSectionSize(SECTION_POSTING_OFFSETS) != (numberOfKeys + 1) * sizeof(size_t)) {
+        return false;
+    }
+    const size_t* postingOffsets = static_cast<const size_t*>(pFile->getSection(SECTION_POSTING_OFFSETS));
+    const size_t postingsSize = mCompressPostingLists ? postingOffsets[numberOfKeys] + 16 
+                                                      : postingOffsets[numberOfKeys] * sizeof(instanceId_t);
+    if (pFile->getSectionSize(SECTION_POSTINGS) != postingsSize
+            || !mStatistics->load(static_cast<const uint64_t*>(pFile->getSection(SECTION_INVERSE_INDEX_STATISTICS)),
+                                  pFile->getSectionSize(SECTION_INVERSE_INDEX_STATISTICS) / sizeof(uint64_t))) {
+        return false;
+    }
+    const char* removedHashFunctions = static_cast<const char*>(pFile->getSection(SECTION_REMOVED_HASH_FUNCTIONS));
+    mRemovedHashFunctions.assign(removedHashFunctions, removedHashFunctions + mNumberOfHashFunctions);
+    vhashValue_t().swap(mKeys);
+    vsize_t().swap(mKeyOffsets);
+    vsize_t().swap(mPostingOffsets);
+    vinstanceId_t().swap(mPostings);
+    std::vector<uint8_t>().swap(mCompressedPostings);
+    mKeysView = static_cast<const hashValue_t*>(pFile->getSection(SECTION_KEYS));
+    mKeyOffsetsView = keyOffsets;
+    mPostingOffsetsView = postingOffsets;
+    if (mCompressPostingLists) {
+        mPostingsView = NULL;
+        mCompressedPostingsView = static_cast<const uint8_t*>(pFile->getSection(SECTION_POSTINGS));
+    } else {
+        mPostingsView = static_cast<const instanceId_t*>(pFile->getSection(SECTION_POSTINGS));
+        mCompressedPostingsView = NULL;
+    }
+    deleteReplicas();
+    replicate();
+    return true;
+}
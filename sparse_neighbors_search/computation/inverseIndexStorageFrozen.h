@@ -0,0 +1,95 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include "inverseIndexStorage.h"
+#include "streamVByte.h"
+#include "numaTopology.h"
+
+#ifndef INVERSE_INDEX_STORAGE_FROZEN_H
+#define INVERSE_INDEX_STORAGE_FROZEN_H
+
+// copy of the built arrays in the memory of one numa node
+struct frozenReplica {
+    vhashValue_t keys;
+    vsize_t keyOffsets;
+    vsize_t postingOffsets;
+    vinstanceId_t postings;
+    std::vector<uint8_t> compressedPostings;
+};
+
+// read-only inverse index in compressed sparse row layout: the sorted hash values of all hash functions
+// in one array, the instance ids of all hash values in one flat postings array.
+// inserts and erasures are only collected, the layout is built by a radix sort per hash function in freeze(),
+// prune() and removeHashFunctionWithLessEntriesAs(). max bin size and pruning are applied while building and
+// the result is the same as with the other storages.
+// with compressed posting lists every list is stored as its length in vbyte coding followed by the
+// stream vbyte coded ids, and the posting offsets count bytes.
+// all reads go through views on the arrays, a loaded index points them into a mapped index file and
+// leaves the vectors empty until the next build.
+// with numa replication every node of the machine gets its own copy of the arrays after each build and load,
+// a lookup reads the copy of the node its thread is bound to. the views point to the copy of node 0.
+class InverseIndexStorageFrozen : public InverseIndexStorage {
+  // builds its filter from the arrays
+  friend class InverseIndexStorageBloomierFilter;
+  private:
+    size_t mNumberOfHashFunctions;
+    size_t mMaxBinSize;
+    size_t mNumberOfCores;
+    // hash values of hash function i are mKeys[mKeyOffsets[i]] .. mKeys[mKeyOffsets[i+1] - 1]
+    vhashValue_t mKeys;
+    vsize_t mKeyOffsets;
+    // instance ids of hash value mKeys[i] are mPostings[mPostingOffsets[i]] .. mPostings[mPostingOffsets[i+1] - 1],
+    // an empty range marks a hash value with too many collisions
+    vsize_t mPostingOffsets;
+    vinstanceId_t mPostings;
+    bool mCompressPostingLists;
+    std::vector<uint8_t> mCompressedPostings;
+    std::vector<char> mRemovedHashFunctions;
+    // counters of the built lists, pending changes are counted by the next build
+    InverseIndexStatistics* mStatistics = NULL;
+    bool mNumaReplication;
+    std::vector<frozenReplica*> mReplicas;
+    const hashValue_t* mKeysView;
+    const size_t* mKeyOffsetsView;
+    const size_t* mPostingOffsetsView;
+    const instanceId_t* mPostingsView;
+    const uint8_t* mCompressedPostingsView;
+    // inserts since the last build
+    std::vector<vhashValue_t> mPendingHashValues;
+    std::vector<vinstanceId_t> mPendingInstances;
+    // erased (hash value, instance) pairs since the last build, they are removed from the built lists
+    std::vector< std::vector< std::pair<hashValue_t, instanceId_t> > > mPendingErasures;
+    void build(const bool pPrune, const size_t pPruneValue);
+    void updateViews();
+    void replicate();
+    void deleteReplicas();
+    bool hasPendingChanges() const;
+    size_t getPostingListSize(const size_t pKey, const uint8_t** pData) const;
+    void appendPostingList(const size_t pKey, vinstanceId_t& pInstances) const;
+    size_t encodePostingList(const instanceId_t* pInstances, const size_t pSize, std::vector<uint8_t>& pOut) const;
+  public:
+    InverseIndexStorageFrozen(size_t pSizeOfInverseIndex, size_t pMaxBinSize, size_t pNumberOfCores, bool pCompressPostingLists,
+                                bool pNumaReplication);
+    ~InverseIndexStorageFrozen();
+    size_t size() const;
+    postingList getElement(size_t pVectorId, hashValue_t pHashValue);
+    void insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit);
+    distributionInverseIndex* getDistribution();
+    void prune(size_t pValue);
+    void removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs);
+    void reserveSpaceForMaps(size_t pNumberOfInstances);
+    void erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance);
+    void freeze();
+    bool hasNumaReplicas() const { return mReplicas.size() != 0; };
+    bool save(IndexFileWriter* pWriter);
+    bool load(const MappedIndexFile* pFile);
+};
+#endif // INVERSE_INDEX_STORAGE_FROZEN_H
@@ -10,36 +10,38 @@
  Albert-Ludwigs-University Freiburg im Breisgau
 **/
 
+#include <algorithm>
 #include "inverseIndexStorageUnorderedMap.h"
 
 InverseIndexStorageUnorderedMap::InverseIndexStorageUnorderedMap(size_t pSizeOfInverseIndex, size_t pMaxBinSize) {
-    mInverseIndex = new vector__umapVector_ptr(pSizeOfInverseIndex);
+    mInverseIndex = new vector__umapVector_arena(pSizeOfInverseIndex);
+    mArenas.resize(pSizeOfInverseIndex);
      for (size_t i = 0; i < mInverseIndex->size(); ++i) {
-       
-        mInverseIndex->operator[](i) = new umapVector_ptr();
+        mArenas[i] = new Arena();
+        mInverseIndex->operator[](i) = new umapVector_arena(0, std::hash<hashValue_t>(), std::equal_to<hashValue_t>(),
+                                                            umapVector_arena::allocator_type(mArenas[i]));
     }
 	mMaxBinSize = pMaxBinSize;
+    mStatistics = new InverseIndexStatistics(pSizeOfInverseIndex, pMaxBinSize);
 }
 InverseIndexStorageUnorderedMap::~InverseIndexStorageUnorderedMap() {
+    // the lists and map nodes only go back to the free lists of the arena, deleting it releases them
     for (size_t i = 0; i < mInverseIndex->size(); ++i) {
-        if (mInverseIndex->operator[](i) == NULL) continue;        
-        for (auto it = mInverseIndex->operator[](i)->begin(); it != mInverseIndex->operator[](i)->end(); ++it) {
-            if (it->second == NULL) continue;
-            delete it->second;
-        }
         delete mInverseIndex->operator[](i);
+        delete mArenas[i];
     }
 	delete mInverseIndex;
+    delete mStatistics;
 }
 size_t InverseIndexStorageUnorderedMap::size() const {
 	return mInverseIndex->size();
 }
 void InverseIndexStorageUnorderedMap::reserveSpaceForMaps(size_t pNumberOfInstances) {
     for (size_t i = 0; i < mInverseIndex->size(); ++i) {
-        mInverseIndex->operator[](i)->reserve(pNumberOfInstances);
+        mInverseIndex->operator[](i)->reserve(mInverseIndex->operator[](i)->size() + pNumberOfInstances);
     } 
 }
-void InverseIndexStorageUnorderedMap::insert(size_t pVectorId, size_t pHashValue, size_t pInstance, size_t pRemoveValueWithLeastSigificantBit) {
+void InverseIndexStorageUnorderedMap::insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit) {
     if (mInverseIndex == NULL) return;
     if (pVectorId >= mInverseIndex->size()) {
         return;
@@ -64,112 +66,65 @@ void InverseIndexStorageUnorderedMap::insert(size_t pVectorId, size_t pHashValue
         // if for hash function h_i() the given hash values is already stored
         if (itHashValue_InstanceVector != (*mInverseIndex)[pVectorId]->end()) {
             // insert the instance id if not too many collisions (maxBinSize)
-            if (itHashValue_InstanceVector->second->size() && itHashValue_InstanceVector->second->size() < mMaxBinSize) {
+            if (itHashValue_InstanceVector->second.size() && itHashValue_InstanceVector->second.size() < mMaxBinSize) {
                 // insert only if there wasn't any collisions in the past
-                if (itHashValue_InstanceVector->second->size() > 0) {
+                if (itHashValue_InstanceVector->second.size() > 0) {
                 // std::cout << "Adding to vector" << std::endl;
                     
-                    itHashValue_InstanceVector->second->push_back(pInstance);
+                    itHashValue_InstanceVector->second.push_back(pInstance);
+                    mStatistics->resizeList(pVectorId, itHashValue_InstanceVector->second.size() - 1, itHashValue_InstanceVector->second.size());
                 }
             } else { 
                 // too many collisions: delete stored ids. empty vector is interpreted as an error code 
-                // for too many collisions
-                itHashValue_InstanceVector->second->clear();
+                // for too many collisions. the memory of the ids goes back to the arena.
+                mStatistics->resizeList(pVectorId, itHashValue_InstanceVector->second.size(), 0);
+                itHashValue_InstanceVector->second.clear();
+                itHashValue_InstanceVector->second.shrink_to_fit();
             }
         } else {
             // given hash value for the specific hash function was not avaible: insert new hash value
-            vsize_t* instanceIdVector = new vsize_t(1);
-            (*instanceIdVector)[0] = pInstance;
-            (*mInverseIndex)[pVectorId]->operator[](pHashValue) = instanceIdVector;
+            (*mInverseIndex)[pVectorId]->emplace(pHashValue, vinstanceIdArena_t(1, pInstance,
+                                                    vinstanceIdArena_t::allocator_type(mArenas[pVectorId])));
+            mStatistics->addList(pVectorId, 1);
         }
    }
 }
 
-vsize_t* InverseIndexStorageUnorderedMap::getElement(size_t pVectorId, size_t pHashValue) {
-
-    if (mInverseIndex == NULL) return NULL;
-    if (pVectorId > mInverseIndex->size()) return NULL;
+postingList InverseIndexStorageUnorderedMap::getElement(size_t pVectorId, hashValue_t pHashValue) {
+    postingList element;
+    element.instances = NULL;
+    element.size = 0;
+    element.compressed = NULL;
+    if (mInverseIndex == NULL) return element;
+    if (pVectorId > mInverseIndex->size()) return element;
     if (pVectorId < mInverseIndex->size() && (*mInverseIndex)[pVectorId] != NULL) {
                 (*mInverseIndex)[pVectorId];
         auto iterator = (*mInverseIndex)[pVectorId]->find(pHashValue);
-        if (iterator != (*mInverseIndex)[pVectorId]->end() && iterator->second != NULL) {
-            return iterator->second;
+        if (iterator != (*mInverseIndex)[pVectorId]->end()) {
+            element.instances = iterator->second.data();
+            element.size = iterator->second.size();
         }
     }
     
-	return NULL; 
+	return element; 
 }
 
 distributionInverseIndex* InverseIndexStorageUnorderedMap::getDistribution() {
-   
-    if (mInverseIndex == NULL) return new distributionInverseIndex();
-    distributionInverseIndex* retVal = new distributionInverseIndex();
-    #pragma omp critical
-    {   
-        std::map<size_t, size_t> distribution;
-        vsize_t numberOfCreatedHashValuesPerHashFunction;
-        vsize_t averageNumberOfValuesPerHashValue;
-        vsize_t standardDeviationPerNumberOfValuesPerHashValue;
-        size_t meanForNumberHashValues = 0;
-        
-        for (auto it = mInverseIndex->begin(); it != mInverseIndex->end(); ++it) {
-            if (*it == NULL) continue;
-            numberOfCreatedHashValuesPerHashFunction.push_back((*it)->size());
-            meanForNumberHashValues += (*it)->size();
-            size_t mean = 0;
-            
-            for (auto itMap = (*it)->begin(); itMap != (*it)->end(); ++itMap) {
-                if (itMap->second == NULL) continue;
-                distribution[itMap->second->size()] += 1;
-                mean += itMap->second->size();
-            }
-            if ((*it)->size() != 0 || mean != 0) {
-                mean = mean / (*it)->size();       
-            }
-            averageNumberOfValuesPerHashValue.push_back(mean);
-            
-            size_t variance = 0;
-            for (auto itMap = (*it)->begin(); itMap != (*it)->end(); ++itMap) {
-                if (itMap->second == NULL) continue;
-                variance += pow(static_cast<int>(itMap->second->size()) - mean, 2);
-            }
-            
-            variance = variance / mInverseIndex->size();
-            int standardDeviation = sqrt(variance);
-            standardDeviationPerNumberOfValuesPerHashValue.push_back(standardDeviation);
-        }
-        
-        size_t varianceForNumberOfHashValues = 0;
-        for (auto it = mInverseIndex->begin(); it != mInverseIndex->end(); ++it) {
-        if (*it == NULL) continue;
-        varianceForNumberOfHashValues += pow((*it)->size() - meanForNumberHashValues, 2);
-        }
-    
-        retVal->mean = meanForNumberHashValues;
-        retVal->standardDeviation = sqrt(varianceForNumberOfHashValues);
-        
-        retVal->totalCountForOccurenceOfHashValues = distribution;
-        retVal->standardDeviationForNumberOfValuesPerHashValue = standardDeviationPerNumberOfValuesPerHashValue;
-        retVal->meanForNumberOfValuesPerHashValue = averageNumberOfValuesPerHashValue;
-        
-        retVal->numberOfCreatedHashValuesPerHashFunction = numberOfCreatedHashValuesPerHashFunction;
-    }
-    return retVal;
+    return mStatistics->getDistribution();
 }
 void InverseIndexStorageUnorderedMap::prune(size_t pValue) { 
     if (mInverseIndex == NULL) return;
     for (auto it = mInverseIndex->begin(); it != mInverseIndex->end(); ++it) {
         
-        vsize_t elementsToDelete;
+        vhashValue_t elementsToDelete;
         
         if ((*it) == NULL) continue;
         
         for (auto itMap = (*it)->begin(); itMap != (*it)->end(); ++itMap) {
             
-            if (itMap->second != NULL && itMap->second->size() <= pValue) {
+            if (itMap->second.size() <= pValue) {
                 elementsToDelete.push_back(itMap->first);
-                delete itMap->second;
-                itMap->second = NULL;
+                mStatistics->removeList(it - mInverseIndex->begin(), itMap->second.size());
             }
         }
         
@@ -183,51 +138,47 @@ void InverseIndexStorageUnorderedMap::prune(size_t pValue) {
     }
 }
 
+void InverseIndexStorageUnorderedMap::erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance) {
+    if (mInverseIndex == NULL || pVectorId >= mInverseIndex->size() || (*mInverseIndex)[pVectorId] == NULL) return;
+    auto itHashValue_InstanceVector = (*mInverseIndex)[pVectorId]->find(pHashValue);
+    if (itHashValue_InstanceVector == (*mInverseIndex)[pVectorId]->end() || itHashValue_InstanceVector->second.size() == 0) {
+        return;
+    }
+    vinstanceIdArena_t& instances = itHashValue_InstanceVector->second;
+    auto position = std::find(instances.begin(), instances.end(), pInstance);
+    if (position == instances.end()) return;
+    instances.erase(position);
+    if (instances.size() == 0) {
+        mStatistics->removeList(pVectorId, 1);
+        (*mInverseIndex)[pVectorId]->erase(itHashValue_InstanceVector);
+    } else {
+        mStatistics->resizeList(pVectorId, instances.size() + 1, instances.size());
+    }
+}
+
 // if pRemoveHashFunctionWithLessEntriesAs == 0 remove every hash function 
 // which has less entries than mean+standard deviation
 // else: remove every hash function which has less entries than pRemoveHashFunctionWithLessEntriesAs
 void InverseIndexStorageUnorderedMap::removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs) {
     if (mInverseIndex == NULL) return;
+    size_t threshold = pRemoveHashFunctionWithLessEntriesAs;
     if (pRemoveHashFunctionWithLessEntriesAs == 0) {
-        size_t mean = 0;
-        size_t variance = 0;
-        for (size_t i = 0; i < mInverseIndex->size(); ++i) {
-            if ((*mInverseIndex)[i] == NULL) continue;
-            mean += (*mInverseIndex)[i]->size();
-        }
-        mean = mean / mInverseIndex->size();
-        for (size_t i = 0; i < mInverseIndex->size(); ++i) {
-            if ((*mInverseIndex)[i] == NULL) continue;            
-            variance += pow(static_cast<int>((*mInverseIndex)[i]->size()) - mean, 2);
-        }
-        variance = variance / mInverseIndex->size();
-        size_t standardDeviation = sqrt(variance);
-        for (size_t i = 0; i < mInverseIndex->size(); ++i) {
-            if ((*mInverseIndex)[i] == NULL) continue;            
-            if ((*mInverseIndex)[i]->size() < mean + standardDeviation) {
-                for (auto it = (*mInverseIndex)[i]->begin(); it != (*mInverseIndex)[i]->end(); ++it) {
-                    delete it->second;
-                    it->second = NULL;
-                }
-                delete (*mInverseIndex)[i];
-                (*mInverseIndex)[i] = NULL;
-            }
-        }
-    } else {
-        for (size_t i = 0; i < mInverseIndex->size(); ++i) {
-            if ((*mInverseIndex)[i] == NULL) continue;            
-            if ((*mInverseIndex)[i] != NULL && (*mInverseIndex)[i]->size() < pRemoveHashFunctionWithLessEntriesAs) {
-                for (auto it = (*mInverseIndex)[i]->begin(); it != (*mInverseIndex)[i]->end(); ++it) {
-                    if (it->second != NULL) {
-                        delete it->second;
-                        it->second = NULL;
-                    }
-                }
-                if ((*mInverseIndex)[i] != NULL) {
-                    delete  (*mInverseIndex)[i];
-                    (*mInverseIndex)[i] = NULL;
-                }
+        size_t mean;
+        size_t standardDeviation;
+        mStatistics->getMomentsOfNumberOfHashValues(&mean, &standardDeviation);
+        threshold = mean + standardDeviation;
+    }
+    for (size_t i = 0; i < mInverseIndex->size(); ++i) {
+        if ((*mInverseIndex)[i] == NULL) continue;            
+        if ((*mInverseIndex)[i]->size() < threshold) {
+            for (auto itMap = (*mInverseIndex)[i]->begin(); itMap != (*mInverseIndex)[i]->end(); ++itMap) {
+                mStatistics->removeList(i, itMap->second.size());
             }
+            delete (*mInverseIndex)[i];
+            (*mInverseIndex)[i] = NULL;
+            delete mArenas[i];
+            mArenas[i] = NULL;
+            mStatistics->removeHashFunction(i);
         }
     }
 }
\ No newline at end of file
@@ -2,24 +2,29 @@
 
 #ifndef INVERSE_INDEX_STORAGE_UNORDERED_MAP_H
 #define INVERSE_INDEX_STORAGE_UNORDERED_MAP_H
-class InverseIndexStorageUnorderedMap {
+// one std::unordered_map per hash function. the map nodes and the posting lists of a hash function are
+// allocated from its own arena, so fit does not call malloc per hash value and the arenas are released in one step.
+class InverseIndexStorageUnorderedMap : public InverseIndexStorage {
   private:
-	vector__umapVector_ptr* mInverseIndex = NULL;
+	vector__umapVector_arena* mInverseIndex = NULL;
+	std::vector<Arena*> mArenas;
 	size_t mMaxBinSize;
+	InverseIndexStatistics* mStatistics = NULL;
 	// vvsize_t* mKeys;
 	// vvsize_t* mValues;
   public:
     InverseIndexStorageUnorderedMap(size_t pSizeOfInverseIndex, size_t pMaxBinSize);
 	~InverseIndexStorageUnorderedMap();
   	size_t size() const;
-	vsize_t* getElement(size_t pVectorId, size_t pHashValue);
-	void insert(size_t pVectorId, size_t pHashValue, size_t pInstance, size_t pRemoveValueWithLeastSigificantBit);
+	postingList getElement(size_t pVectorId, hashValue_t pHashValue);
+	void insert(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance, size_t pRemoveValueWithLeastSigificantBit);
     // void insert(vector__umapVector_ptr::iterator start, vector__umapVector_ptr::iterator end);
     distributionInverseIndex* getDistribution();
     void prune(size_t pValue);
     void removeHashFunctionWithLessEntriesAs(size_t pRemoveHashFunctionWithLessEntriesAs);
-    vector__umapVector_ptr* getIndex() { return mInverseIndex;};
+    vector__umapVector_arena* getIndex() { return mInverseIndex;};
     void reserveSpaceForMaps(size_t pNumberOfInstances);
+    void erase(size_t pVectorId, hashValue_t pHashValue, instanceId_t pInstance);
 	// void create();
 };
 #endif // INVERSE_INDEX_STORAGE_UNORDERED_MAP_H
\ No newline at end of file
@@ -0,0 +1,79 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutor: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef K_SIZE_SORTED_ARRAY_H
+#define K_SIZE_SORTED_ARRAY_H
+
+// keeps the k smallest keys with their values in ascending key order.
+// the memory is owned by the caller, so the array can be reused for every hash function without allocations.
+class KSizeSortedArray {
+
+  private:
+    uint32_t* mKeys = NULL;
+    float* mValues = NULL;
+    size_t mK;
+    size_t mSize;
+  public:
+    KSizeSortedArray() {
+        mK = 0;
+        mSize = 0;
+    };
+    void init(uint32_t* pKeys, float* pValues, size_t pK) {
+        mKeys = pKeys;
+        mValues = pValues;
+        mK = pK;
+        mSize = 0;
+    };
+    // every key larger than the threshold can not enter the array
+    uint32_t getThreshold() const {
+        if (mSize < mK) return UINT32_MAX;
+        return mKeys[mSize - 1];
+    };
+    // an already stored key gets the new value
+    void insert(uint32_t pKey, float pValue) {
+        size_t position = mSize;
+        while (position > 0 && mKeys[position - 1] > pKey) {
+            --position;
+        }
+        if (position > 0 && mKeys[position - 1] == pKey) {
+            mValues[position - 1] = pValue;
+            return;
+        }
+        if (position == mK) return;
+        size_t last = mSize < mK ? mSize : mK - 1;
+        for (size_t i = last; i > position; --i) {
+            mKeys[i] = mKeys[i - 1];
+            mValues[i] = mValues[i - 1];
+        }
+        mKeys[position] = pKey;
+        mValues[position] = pValue;
+        if (mSize < mK) ++mSize;
+    };
+    // the key with the largest value, the smallest key wins ties; 0 if no value is positive
+    size_t getKeyOfMaxValue() const {
+        float maxValue = 0.0;
+        size_t maxValueKey = 0;
+        for (size_t i = 0; i < mSize; ++i) {
+            if (mValues[i] > maxValue) {
+                maxValue = mValues[i];
+                maxValueKey = mKeys[i];
+            }
+        }
+        return maxValueKey;
+    };
+    size_t getSize() const {
+        return mSize;
+    };
+};
+#endif // K_SIZE_SORTED_ARRAY_H
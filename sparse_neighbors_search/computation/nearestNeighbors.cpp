@@ -16,6 +16,7 @@
 
 
 #include "sparseMatrix.h"
+#include "workSchedule.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -30,7 +31,11 @@ NearestNeighbors::NearestNeighbors(size_t pNumberOfHashFunctions, size_t pShingl
                     int pFast, int pSimilarity, int pPruneInverseIndex, float pPruneInverseIndexAfterInstance, 
                     int pRemoveHashFunctionWithLessEntriesAs, size_t pHashAlgorithm,
                     size_t pBlockSize, size_t pShingle, size_t pRemoveValueWithLeastSigificantBit,
-                    float pCpuGpuLoadBalancing, size_t pGpuHash, size_t pRangeK_Wta) {
+                    float pCpuGpuLoadBalancing, size_t pGpuHash, size_t pRangeK_Wta,
+                    size_t pBitsPerHashValue, size_t pInverseIndexStorageType,
+                    float pCompactionThreshold, size_t pNumaReplication,
+                    size_t pCandidateBudget, size_t pMultiProbe,
+                    size_t pMaxCandidates, float pCollisionCutoff, size_t pQueryCacheSize) {
 
         mInverseIndex = new InverseIndex(pNumberOfHashFunctions, pShingleSize,
                                     pNumberOfCores, pChunkSize,
@@ -39,7 +44,11 @@ NearestNeighbors::NearestNeighbors(size_t pNumberOfHashFunctions, size_t pShingl
                                     pPruneInverseIndex, pPruneInverseIndexAfterInstance, 
                                     pRemoveHashFunctionWithLessEntriesAs, pHashAlgorithm, pBlockSize, pShingle,
                                     pRemoveValueWithLeastSigificantBit, 
-                                    pCpuGpuLoadBalancing, pGpuHash, pRangeK_Wta);
+                                    pCpuGpuLoadBalancing, pGpuHash, pRangeK_Wta,
+                                    pBitsPerHashValue, pInverseIndexStorageType,
+                                    pCompactionThreshold, pNumaReplication,
+                                    pCandidateBudget, pMultiProbe,
+                                    pMaxCandidates, pCollisionCutoff);
 
         mNneighbors = pSizeOfNeighborhood;
         mFast = pFast;
@@ -50,9 +59,43 @@ NearestNeighbors::NearestNeighbors(size_t pNumberOfHashFunctions, size_t pShingl
         mCpuGpuLoadBalancing = pCpuGpuLoadBalancing;
         mGpuHash = pGpuHash;
         mHash = new Hash();
+        if (pQueryCacheSize > 0) {
+            mQueryCache = new QueryCache(pQueryCacheSize);
+        }
         #ifdef CUDA
         mNearestNeighborsCuda = new NearestNeighborsCuda();
         #endif
+
+        mParameters.numberOfHashFunctions = pNumberOfHashFunctions;
+        mParameters.shingleSize = pShingleSize;
+        mParameters.numberOfCores = pNumberOfCores;
+        mParameters.chunkSize = pChunkSize;
+        mParameters.maxBinSize = pMaxBinSize;
+        mParameters.sizeOfNeighborhood = pSizeOfNeighborhood;
+        mParameters.minimalBlocksInCommon = pMinimalBlocksInCommon;
+        mParameters.excessFactor = pExcessFactor;
+        mParameters.maximalNumberOfHashCollisions = pMaximalNumberOfHashCollisions;
+        mParameters.fast = pFast;
+        mParameters.similarity = pSimilarity;
+        mParameters.pruneInverseIndex = pPruneInverseIndex;
+        mParameters.pruneInverseIndexAfterInstance = pPruneInverseIndexAfterInstance;
+        mParameters.removeHashFunctionWithLessEntriesAs = pRemoveHashFunctionWithLessEntriesAs;
+        mParameters.hashAlgorithm = pHashAlgorithm;
+        mParameters.blockSize = pBlockSize;
+        mParameters.shingle = pShingle;
+        mParameters.removeValueWithLeastSigificantBit = pRemoveValueWithLeastSigificantBit;
+        mParameters.cpuGpuLoadBalancing = pCpuGpuLoadBalancing;
+        mParameters.gpuHash = pGpuHash;
+        mParameters.rangeK_Wta = pRangeK_Wta;
+        mParameters.bitsPerHashValue = pBitsPerHashValue;
+        mParameters.inverseIndexStorageType = pInverseIndexStorageType;
+        mParameters.compactionThreshold = pCompactionThreshold;
+        mParameters.numaReplication = pNumaReplication;
+        mParameters.candidateBudget = pCandidateBudget;
+        mParameters.multiProbe = pMultiProbe;
+        mParameters.maxCandidates = pMaxCandidates;
+        mParameters.collisionCutoff = pCollisionCutoff;
+        mParameters.queryCacheSize = pQueryCacheSize;
 }
 
 NearestNeighbors::~NearestNeighbors() {
@@ -61,25 +104,119 @@ NearestNeighbors::~NearestNeighbors() {
     delete mOriginalData;
 
     delete mHash;
+    delete mQueryCache;
     #ifdef CUDA
         delete mNearestNeighborsCuda;
     #endif
-    
+    delete mIndexFile;
+}
+
+// every change of the index makes the cached query results invalid
+void NearestNeighbors::clearQueryCache() {
+    if (mQueryCache != NULL) {
+        mQueryCache->clear();
+    }
 }
 
 void NearestNeighbors::fit(SparseMatrixFloat* pRawData) {
+    clearQueryCache();
     mInverseIndex->fit(pRawData);
     pRawData->precomputeDotProduct();
     return;
 }
 
-void NearestNeighbors::partialFit(SparseMatrixFloat* pRawData, size_t pStartIndex) {
-    mInverseIndex->fit(pRawData, pStartIndex);
-    return;
+bool NearestNeighbors::partialFit(SparseMatrixFloat* pRawData, size_t pStartIndex) {
+    if (!mInverseIndex->fit(pRawData, pStartIndex)) {
+        return false;
+    }
+    clearQueryCache();
+    return true;
 }
 
-neighborhood* NearestNeighbors::kneighbors(SparseMatrixFloat* pRawData,
-                                                size_t pNneighbors, int pFast, int pSimilarity, float pRadius) {
+void NearestNeighbors::remove(const vsize_t& pInstances) {
+    clearQueryCache();
+    mInverseIndex->remove(pInstances);
+}
+
+bool NearestNeighbors::update(const vsize_t& pInstances, SparseMatrixFloat* pRawData) {
+    clearQueryCache();
+    if (mOriginalData == NULL || !mInverseIndex->update(mOriginalData, pInstances, pRawData)) {
+        return false;
+    }
+    mOriginalData->replaceInstances(pInstances, pRawData);
+    return true;
+}
+
+neighborhood NearestNeighbors::kneighbors(SparseMatrixFloat* pRawData,
+                                                size_t pNneighbors, int pFast, int pSimilarity, float pRadius,
+                                                SignatureMatrix* pSignatures) {
+    if (pFast == -1) {
+        pFast = mFast;
+    } 
+    // the neighbors of the fitted instances and queries with given signatures are not cached. in exact mode
+    // the neighbors of an instance depend on the other instances of its query, a cached one would change them
+    if (mQueryCache == NULL || pRawData == NULL || pSignatures != NULL || pFast == 0) {
+        return computeKneighbors(pRawData, pNneighbors, pFast, pSimilarity, pRadius, pSignatures);
+    }
+    if (pNneighbors == 0) {
+        pNneighbors = mNneighbors;
+    }
+    if (pSimilarity == -1) {
+        pSimilarity = mSimilarity;
+    }
+    const queryParameters parameters = {pNneighbors, pFast, pSimilarity, pRadius};
+    const size_t numberOfInstances = pRawData->size();
+    NeighborhoodBuilder neighbors(numberOfInstances, mNumberOfCores);
+    std::vector<uint64_t> fingerprints(numberOfInstances);
+    std::vector<char> cached(numberOfInstances, 0);
+    #ifdef OPENMP
+    #pragma omp parallel for schedule(static, getStaticChunkSize(mChunkSize, numberOfInstances, mNumberOfCores)) num_threads(mNumberOfCores)
+    #endif
+    for (size_t i = 0; i < numberOfInstances; ++i) {
+        fingerprints[i] = mQueryCache->getFingerprint(pRawData, i, parameters);
+        cached[i] = mQueryCache->find(fingerprints[i], pRawData, i, parameters, neighbors, getThreadNumber(), i);
+    }
+    vsize_t missingInstances;
+    for (size_t i = 0; i < numberOfInstances; ++i) {
+        if (!cached[i]) {
+            missingInstances.push_back(i);
+        }
+    }
+    if (missingInstances.size() == 0) {
+        return neighbors.build(mNumberOfCores);
+    }
+    // the rows that are not cached are queried together, as a copy if some rows are cached
+    SparseMatrixFloat* missingData = pRawData;
+    if (missingInstances.size() < numberOfInstances) {
+        missingData = new SparseMatrixFloat(missingInstances.size(), pRawData->getMaxNnz());
+        for (size_t i = 0; i < missingInstances.size(); ++i) {
+            const size_t instance = missingInstances[i];
+            for (size_t j = 0; j < pRawData->getSizeOfInstance(instance); ++j) {
+                missingData->insertElement(i, j, pRawData->getNextElement(instance, j), pRawData->getNextValue(instance, j));
+            }
+            missingData->insertToSizesOfInstances(i, pRawData->getSizeOfInstance(instance));
+        }
+    }
+    neighborhood missingNeighbors = computeKneighbors(missingData, pNneighbors, pFast, pSimilarity, pRadius, NULL);
+    if (missingData != pRawData) {
+        delete missingData;
+    }
+    #ifdef OPENMP
+    #pragma omp parallel for schedule(static, getStaticChunkSize(mChunkSize, missingInstances.size(), mNumberOfCores)) num_threads(mNumberOfCores)
+    #endif
+    for (size_t i = 0; i < missingInstances.size(); ++i) {
+        const size_t instance = missingInstances[i];
+        neighbors.setRow(getThreadNumber(), instance, missingNeighbors.getNeighbors(i), missingNeighbors.getDistances(i),
+                         missingNeighbors.getSize(i));
+        mQueryCache->insert(fingerprints[instance], pRawData, instance, parameters,
+                            missingNeighbors.getNeighbors(i), missingNeighbors.getDistances(i), missingNeighbors.getSize(i));
+    }
+    return neighbors.build(mNumberOfCores);
+}
+
+neighborhood NearestNeighbors::computeKneighbors(SparseMatrixFloat* pRawData,
+                                                size_t pNneighbors, int pFast, int pSimilarity, float pRadius,
+                                                SignatureMatrix* pSignatures) {
     if (pFast == -1) {
         pFast = mFast;
     } 
@@ -90,9 +227,10 @@ neighborhood* NearestNeighbors::kneighbors(SparseMatrixFloat* pRawData,
     if (pSimilarity == -1) {
         pSimilarity = mSimilarity;
     }
+    mInverseIndex->applyChanges();
     bool doubleElementsStorageCount = false;
-    neighborhood* neighborhood_;
-    umap_uniqueElement* x_inverseIndex;
+    neighborhood neighborhood_;
+    SignatureBatch* x_inverseIndex;
     if (pRawData == NULL) {
         
         // no query data given, use stored signatures
@@ -102,229 +240,225 @@ neighborhood* NearestNeighbors::kneighbors(SparseMatrixFloat* pRawData,
         doubleElementsStorageCount = true;
     } else {
         pRawData->precomputeDotProduct();
-        x_inverseIndex = (mInverseIndex->computeSignatureMap(pRawData));
+        SignatureMatrix* signatures = pSignatures;
+        if (signatures == NULL) {
+            signatures = mInverseIndex->computeSignatureVectors(pRawData, false);
+        }
+        x_inverseIndex = (mInverseIndex->computeSignatureMap(pRawData, signatures));
         neighborhood_ = mInverseIndex->kneighbors(x_inverseIndex, pNneighbors, 
                                                 doubleElementsStorageCount, pRadius);
-       for (auto it = x_inverseIndex->begin(); it != x_inverseIndex->end(); ++it) {
-            delete (*it).second.instances;
-            delete (*it).second.signature;
+       delete x_inverseIndex;
+       if (signatures != pSignatures) {
+           delete signatures;
        }
-       delete x_inverseIndex;                                          
     }
     
     if (pFast) {     
         return neighborhood_;
     }
-    if (mChunkSize <= 0) {
-            mChunkSize = ceil(neighborhood_->neighbors->size() / static_cast<float>(mNumberOfCores));
-        }
+    // the exact distances of a query cost about its number of candidates, the queries are processed by
+    // decreasing number of candidates in every round
+    const size_t chunkSize = getDynamicChunkSize(mChunkSize, neighborhood_.size(), mNumberOfCores);
+    vsize_t costs(neighborhood_.size());
+    for (size_t i = 0; i < costs.size(); ++i) {
+        costs[i] = neighborhood_.getSize(i);
+    }
+    vsize_t order = sortByDecreasingCost(costs);
     #ifdef OPENMP
         omp_set_dynamic(0);
     #endif
-    vvsize_t neighborsListFirstRound(neighborhood_->neighbors->size(), vsize_t(0));
-   
-    neighborhood* neighborhoodCandidates = new neighborhood();
-    neighborhoodCandidates->neighbors = new vvsize_t(mOriginalData->size());
+    // every round writes only to the rows of its own instances, the lists are merged without locks
+    vvsize_t neighborsListFirstRound(neighborhood_.size(), vsize_t(0));
     // compute the exact neighbors based on the candidates given by the inverse index
-    // store the neighborhood in neighborhoodCandidates to reuse neighbor if needed
     // and store neighbors list per requested instance in neighborsListFirstRound
-    //
-    // neighborsListFirstRound is needed to get replace the candidates in neighborhood_
-    // if it would not be used, it would be iterated over neighborhood_ and manipulated
-    // at the same time
     #ifdef CUDA
     if (mCpuGpuLoadBalancing == 0){
     #endif
         #ifdef OPENMP
-        #pragma omp parallel for schedule(static, mChunkSize) num_threads(mNumberOfCores)
+        #pragma omp parallel for schedule(dynamic, chunkSize) num_threads(mNumberOfCores)
         #endif
-        for (size_t i = 0; i < neighborhood_->neighbors->size(); ++i) {
-            
-            if (neighborhood_->neighbors->operator[](i).size() > 0) {
-                
+        for (size_t position = 0; position < order.size(); ++position) {
+            const size_t i = order[position];
+            if (neighborhood_.getSize(i) > 0 && !(pRawData == NULL && mInverseIndex->isRemoved(i))) {
+                const vsize_t candidates(neighborhood_.getNeighbors(i), neighborhood_.getNeighbors(i) + neighborhood_.getSize(i));
                 std::vector<sortMapFloat> exactNeighbors;
                 if (pSimilarity) {
                     exactNeighbors = 
-                        mOriginalData->cosineSimilarity(neighborhood_->neighbors->operator[](i), pNneighbors+mExcessFactor, i, pRawData);
+                        mOriginalData->cosineSimilarity(candidates, pNneighbors+mExcessFactor, i, pRawData);
                 } else {
                     exactNeighbors = 
-                        mOriginalData->euclidianDistance(neighborhood_->neighbors->operator[](i), pNneighbors+mExcessFactor, i, pRawData);
+                        mOriginalData->euclidianDistance(candidates, pNneighbors+mExcessFactor, i, pRawData);
                 } 
-                std::vector<size_t> neighborsVector;
                 if (pRadius == -1.0) {
                     size_t vectorSize = std::min(exactNeighbors.size(),pNneighbors+mExcessFactor);
-                    neighborsVector.resize(vectorSize);
+                    neighborsListFirstRound[i].resize(vectorSize);
                     for (size_t j = 0; j < vectorSize; ++j) {
-                        neighborsVector[j] = exactNeighbors[j].key;
-                        neighborsListFirstRound[i].push_back(exactNeighbors[j].key);
+                        neighborsListFirstRound[i][j] = exactNeighbors[j].key;
                     } 
                 } else {
                     
                     for (size_t j = 0; j < exactNeighbors.size(); ++j) {
                         if (exactNeighbors[j].val <= pRadius) {
-                            neighborsVector.push_back(exactNeighbors[j].key);
                             neighborsListFirstRound[i].push_back(exactNeighbors[j].key);
                         } else {
                             break;
                         }
                     } 
                 }
-                #ifdef OPENMP
-                #pragma omp critical
-                #endif
-                {
-                    if (neighborsVector.size() > 1) {
-                        neighborhoodCandidates->neighbors->operator[](exactNeighbors[0].key) = neighborsVector;
-                    }
-                }
             }
         }
         
     #ifdef CUDA
     } else {
        
-        neighborhood* neighbors_ = mNearestNeighborsCuda->computeNearestNeighbors(neighborhood_, pSimilarity, pRawData, mOriginalData, pNneighbors+mExcessFactor);
+        neighborhood neighbors_ = mNearestNeighborsCuda->computeNearestNeighbors(neighborhood_, pSimilarity, pRawData, mOriginalData, pNneighbors+mExcessFactor);
         
-        #pragma omp parallel for schedule(static, mChunkSize) num_threads(mNumberOfCores)
-        for (size_t i = 0; i < neighbors_->neighbors->size(); ++i) {
-            size_t vectorSize = neighbors_->neighbors->operator[](i).size();
-            if (pRadius == -1.0) {
-                std::vector<size_t> neighborsVector(vectorSize);
-                for (size_t j = 0; j < vectorSize; ++j) {
-                    neighborsVector[j] = neighbors_->neighbors->operator[](i)[j];
-                    neighborsListFirstRound[i].push_back(neighbors_->neighbors->operator[](i)[j]);
-                } 
-                if (neighbors_->neighbors->operator[](i).size() > 1) {
-                    neighborhoodCandidates->neighbors->operator[](i) = neighborsVector;
-                }
-            } else {
-                std::vector<size_t> neighborsVector;
-                for (size_t j = 0; j < vectorSize; ++j) {
-                    if (neighbors_->distances->operator[](i)[j] <= pRadius) {
-                        neighborsVector.push_back(neighbors_->neighbors->operator[](i)[j]);
-                        neighborsListFirstRound[i].push_back(neighbors_->neighbors->operator[](i)[j]);
-                    }
-                } 
-                if (neighborsVector.size() > 1) {
-                    neighborhoodCandidates->neighbors->operator[](i) = neighborsVector;
+        #pragma omp parallel for schedule(static, getStaticChunkSize(mChunkSize, neighbors_.size(), mNumberOfCores)) num_threads(mNumberOfCores)
+        for (size_t i = 0; i < neighbors_.size(); ++i) {
+            size_t vectorSize = neighbors_.getSize(i);
+            for (size_t j = 0; j < vectorSize; ++j) {
+                if (pRadius == -1.0 || neighbors_.getDistances(i)[j] <= pRadius) {
+                    neighborsListFirstRound[i].push_back(neighbors_.getNeighbors(i)[j]);
                 }
-            }
+            } 
         }
-        #pragma omp barrier
-        delete neighbors_->neighbors;
-        delete neighbors_->distances;
-        delete neighbors_;
     }
     
     #endif
+    // the neighbors of an instance are reused as its candidates: the list of query i belongs to its
+    // nearest neighbor. if several queries have the same nearest neighbor the last one is taken.
+    std::vector<size_t> candidatesOwner(mOriginalData->size(), MAX_VALUE);
+    for (size_t i = 0; i < neighborsListFirstRound.size(); ++i) {
+        if (neighborsListFirstRound[i].size() > 1) {
+            candidatesOwner[neighborsListFirstRound[i][0]] = i;
+        }
+    }
+    // the neighbors of the neighbors that are not known yet are computed once before the second round
+    vsize_t missingInstances;
+    std::vector<size_t> missingPosition(mOriginalData->size(), MAX_VALUE);
+    for (size_t i = 0; i < neighborsListFirstRound.size(); ++i) {
+        if (pRawData == NULL && mInverseIndex->isRemoved(i)) continue;
+        for (size_t j = 0; j < pNneighbors && j < neighborsListFirstRound[i].size(); ++j) {
+            const size_t instance = neighborsListFirstRound[i][j];
+            if (candidatesOwner[instance] == MAX_VALUE && missingPosition[instance] == MAX_VALUE) {
+                missingPosition[instance] = missingInstances.size();
+                missingInstances.push_back(instance);
+            }
+        }
+    }
+    vvsize_t missingCandidates(missingInstances.size());
     x_inverseIndex = mInverseIndex->getSignatureStorage();
     #ifdef OPENMP
-    #pragma omp parallel for schedule(static, mChunkSize) num_threads(mNumberOfCores)
+    #pragma omp parallel for schedule(dynamic) num_threads(mNumberOfCores)
+    #endif
+    for (size_t i = 0; i < missingInstances.size(); ++i) {
+        const size_t instance = missingInstances[i];
+        size_t signatureId = 0;
+        for (size_t k = 0; k < mOriginalData->getSizeOfInstance(instance); ++k) {
+                signatureId = mHash->hash((mOriginalData->getNextElement(instance, k) +1), (signatureId+1), MAX_VALUE);
+        }
+        // the signature storage is only read here, a signature that is not stored has no candidates
+        const uniqueElement* storedElement = x_inverseIndex->find(signatureId);
+        if (storedElement == NULL) continue;
+        SignatureBatch* instance_signature = new SignatureBatch();
+        uniqueElement element = {vinstanceIdArena_t(1, instance), storedElement->signature};
+        instance_signature->add(signatureId, std::move(element));
+        neighborhood neighborhood_instance = mInverseIndex->kneighbors(instance_signature, 
+                                                        pNneighbors, false, false);
+        delete instance_signature;
+        if (neighborhood_instance.getSize(0) == 0) continue;
+        const vsize_t candidates(neighborhood_instance.getNeighbors(0), neighborhood_instance.getNeighbors(0) + neighborhood_instance.getSize(0));
+        std::vector<sortMapFloat> exactNeighbors;
+        if (pSimilarity) {
+            exactNeighbors = 
+                mOriginalData->cosineSimilarity(candidates, pNneighbors+mExcessFactor, instance, pRawData);
+        } else {
+            exactNeighbors = 
+                mOriginalData->euclidianDistance(candidates, pNneighbors+mExcessFactor, instance, pRawData);
+        }
+        if (exactNeighbors.size() > 1) {
+            size_t vectorSize = std::min(exactNeighbors.size(), pNneighbors+mExcessFactor);
+            missingCandidates[i].resize(vectorSize);
+            for (size_t j = 0; j < vectorSize; ++j) {
+                missingCandidates[i][j] = exactNeighbors[j].key;
+            }
+        }
+    }
+
+    vvsize_t neighborsListSecondRound(neighborhood_.size());
+    for (size_t i = 0; i < costs.size(); ++i) {
+        costs[i] = neighborsListFirstRound[i].size();
+    }
+    order = sortByDecreasingCost(costs);
+    #ifdef OPENMP
+    #pragma omp parallel for schedule(dynamic, chunkSize) num_threads(mNumberOfCores)
     #endif   
     // for all requested instances get the neighbors+mExcessFactor of the neighbors
-    for (size_t i = 0; i < neighborsListFirstRound.size(); ++i) {
+    for (size_t position = 0; position < order.size(); ++position) {
+        const size_t i = order[position];
+        vsize_t& candidates = neighborsListSecondRound[i];
+        if (neighborhood_.getSize(i) == 0) continue;
+        candidates.push_back(neighborhood_.getNeighbors(i)[0]);
+        // a removed instance keeps itself as only neighbor
+        if (pRawData == NULL && mInverseIndex->isRemoved(i)) continue;
         size_t sizeOfExtended = neighborsListFirstRound[i].size();
         vsize_t dublicateElements((mOriginalData->size()/sizeof(size_t))+1,0);
         size_t bucketIndex;
         size_t element;
         size_t valueSeen;
         size_t instance;
-        size_t queryInstance;
-        if (neighborhood_->neighbors->operator[](i).size() > 0) {
-            queryInstance = neighborhood_->neighbors->operator[](i)[0];
-        }
-        neighborhood_->neighbors->operator[](i).clear();
-        neighborhood_->neighbors->operator[](i).push_back(queryInstance); 
+        size_t queryInstance = candidates[0];
         bucketIndex = queryInstance / sizeof(size_t);
         element = 1 << queryInstance % sizeof(size_t); 
         dublicateElements[bucketIndex] = dublicateElements[bucketIndex] | element;
         
         for (size_t j = 0; j < pNneighbors && j < sizeOfExtended; ++j) { 
             instance = neighborsListFirstRound[i][j];
-            // neighborhood for instance was already computed?
-            if (neighborhoodCandidates->neighbors->operator[](instance).size() == 0) {
-                umap_uniqueElement* instance_signature = new umap_uniqueElement();
-                size_t signatureId = 0;
-                for (size_t k = 0; k < mOriginalData->getSizeOfInstance(instance); ++k) {
-                        signatureId = mHash->hash((mOriginalData->getNextElement(instance, k) +1), (signatureId+1), MAX_VALUE);
-                }
-                (*instance_signature)[signatureId] = (*x_inverseIndex)[signatureId];
-                 neighborhood* neighborhood_instance = mInverseIndex->kneighbors(instance_signature, 
-                                                                pNneighbors, false, false);
-                if (neighborhood_instance->neighbors->operator[](0).size() != 0) { 
-                    std::vector<sortMapFloat> exactNeighbors;
-                    if (pSimilarity) {
-                        exactNeighbors = 
-                            mOriginalData->cosineSimilarity(neighborhood_instance->neighbors->operator[](0), pNneighbors+mExcessFactor, instance, pRawData);
-                    } else {
-                        exactNeighbors = 
-                            mOriginalData->euclidianDistance(neighborhood_instance->neighbors->operator[](0), pNneighbors+mExcessFactor, instance, pRawData);
-                    }
-                    size_t vectorSize = std::min(exactNeighbors.size(), pNneighbors+mExcessFactor);
-                    std::vector<size_t> neighborsVector(vectorSize);
-                    for (size_t j = 0; j < vectorSize; ++j) {
-                        neighborsVector[j] = exactNeighbors[j].key;
-                    }
-                    #ifdef OPENMP
-                    #pragma omp critical
-                    #endif
-                    {
-                        if (exactNeighbors.size() > 1) {
-                            neighborhoodCandidates->neighbors->operator[](instance) = neighborsVector;
-                        }
-                    } 
-                    
-                }
-                delete instance_signature;
-                delete neighborhood_instance->neighbors;
-                delete neighborhood_instance->distances;
-                delete neighborhood_instance;
-            }
+            const vsize_t& instanceCandidates = candidatesOwner[instance] != MAX_VALUE ?
+                            neighborsListFirstRound[candidatesOwner[instance]] : missingCandidates[missingPosition[instance]];
             // add the neighbors + mExcessFactor to the candidate list 
-            for (size_t k = 0; k < neighborhoodCandidates->neighbors->operator[](instance).size() && k < pNneighbors+mExcessFactor; ++k) {
-                bucketIndex = neighborhoodCandidates->neighbors->operator[](instance)[k] / sizeof(size_t);
-                element = 1 << neighborhoodCandidates->neighbors->operator[](instance)[k] % sizeof(size_t);
-
-                #ifdef OPENMP
-                #pragma omp critical
-                #endif
-                {
-                    valueSeen = dublicateElements[bucketIndex] & element;
-                    // if candidate was already inserted, do not inserte it a second time
-                    if (valueSeen != element) {
-                        neighborhood_->neighbors->operator[](i).push_back(neighborhoodCandidates->neighbors->operator[](instance)[k]);
-                        dublicateElements[bucketIndex] = dublicateElements[bucketIndex] | element;
-                    }
+            for (size_t k = 0; k < instanceCandidates.size() && k < pNneighbors+mExcessFactor; ++k) {
+                bucketIndex = instanceCandidates[k] / sizeof(size_t);
+                element = 1 << instanceCandidates[k] % sizeof(size_t);
+                valueSeen = dublicateElements[bucketIndex] & element;
+                // if candidate was already inserted, do not inserte it a second time
+                if (valueSeen != element) {
+                    candidates.push_back(instanceCandidates[k]);
+                    dublicateElements[bucketIndex] = dublicateElements[bucketIndex] | element;
                 }
             }
         }
     }
-
-    delete neighborhoodCandidates->neighbors;
-    delete neighborhoodCandidates->distances;
-    delete neighborhoodCandidates;
     
     // compute the exact neighbors based on the candidate selection before.
     #ifdef CUDA
     if (mCpuGpuLoadBalancing == 0){
     #endif
     
-    neighborhood* neighborhoodExact = new neighborhood();
-    neighborhoodExact->neighbors = new vvsize_t(neighborhood_->neighbors->size());
-    neighborhoodExact->distances = new vvfloat(neighborhood_->neighbors->size());
+    for (size_t i = 0; i < costs.size(); ++i) {
+        costs[i] = neighborsListSecondRound[i].size();
+    }
+    order = sortByDecreasingCost(costs);
+    NeighborhoodBuilder neighborhoodExact(neighborsListSecondRound.size(), mNumberOfCores);
+    #ifdef OPENMP
+    #pragma omp parallel num_threads(mNumberOfCores)
+    #endif
+    {
+        const size_t thread = getThreadNumber();
     #ifdef OPENMP
-    #pragma omp parallel for schedule(static, mChunkSize) num_threads(mNumberOfCores)
+    #pragma omp for schedule(dynamic, chunkSize)
     #endif   
-        for (size_t i = 0; i < neighborhood_->neighbors->size(); ++i) {
-        if (neighborhood_->neighbors->operator[](i).size() != 1) {
+        for (size_t position = 0; position < order.size(); ++position) {
+        const size_t i = order[position];
+        if (neighborsListSecondRound[i].size() != 1) {
                     std::vector<sortMapFloat> exactNeighbors;
-                    if (0 < neighborhood_->neighbors->operator[](i).size()) {
+                    if (0 < neighborsListSecondRound[i].size()) {
                         if (pSimilarity) {
                             exactNeighbors = 
-                                mOriginalData->cosineSimilarity(neighborhood_->neighbors->operator[](i), pNneighbors, i, pRawData);
+                                mOriginalData->cosineSimilarity(neighborsListSecondRound[i], pNneighbors, i, pRawData);
                         } else {
                             exactNeighbors = 
-                                mOriginalData->euclidianDistance(neighborhood_->neighbors->operator[](i), pNneighbors, i, pRawData);
+                                mOriginalData->euclidianDistance(neighborsListSecondRound[i], pNneighbors, i, pRawData);
                         }
                     }
                 size_t vectorSize = exactNeighbors.size();
@@ -343,42 +477,115 @@ neighborhood* NearestNeighbors::kneighbors(SparseMatrixFloat* pRawData,
                             distancesVector[j] = sqrt(exactNeighbors[j].val);
                         }
                 }
-    #ifdef OPENMP
-    #pragma omp critical
-    #endif
-                {
-                    neighborhoodExact->neighbors->operator[](i) = neighborsVector;
-                    neighborhoodExact->distances->operator[](i) = distancesVector;
-                }
+                neighborhoodExact.setRow(thread, i, neighborsVector, distancesVector);
             } else {
-    #ifdef OPENMP
-    #pragma omp critical
-    #endif
-                {
-                    std::vector<size_t> neighborsVector(1, i);
-                    std::vector<float> distancesVector(1, 0);
-                    neighborhoodExact->neighbors->operator[](i) = neighborsVector;
-                    neighborhoodExact->distances->operator[](i) = distancesVector;
-                }
+                const float distance = 0;
+                neighborhoodExact.setRow(thread, i, &i, &distance, 1);
             }
         }
-        delete neighborhood_->neighbors;
-        delete neighborhood_->distances;
-        delete neighborhood_;
-        return neighborhoodExact;
+    }
+        return neighborhoodExact.build(mNumberOfCores);
     #ifdef CUDA
     } else {
-        
-        neighborhood* neighbors_part2 = mNearestNeighborsCuda->computeNearestNeighbors(neighborhood_, pSimilarity, pRawData, mOriginalData, pNneighbors+mExcessFactor);
-        delete neighborhood_->neighbors;
-        delete neighborhood_->distances;
-        delete neighborhood_;
-        return neighbors_part2;
+        NeighborhoodBuilder candidatesSecondRound(neighborsListSecondRound.size(), 1);
+        for (size_t i = 0; i < neighborsListSecondRound.size(); ++i) {
+            vfloat distances(neighborsListSecondRound[i].size(), 0);
+            candidatesSecondRound.setRow(0, i, neighborsListSecondRound[i], distances);
+        }
+        return mNearestNeighborsCuda->computeNearestNeighbors(candidatesSecondRound.build(1), pSimilarity, pRawData, mOriginalData, pNneighbors+mExcessFactor);
     } 
     #endif
     
 }
 
+neighborhood NearestNeighbors::kneighbors(SignatureMatrix* pSignatures, const vsize_t& pSignatureIds, size_t pNneighbors) {
+    if (pNneighbors == 0) {
+        pNneighbors = mNneighbors;
+    }
+    mInverseIndex->applyChanges();
+    SignatureBatch* x_inverseIndex = mInverseIndex->computeSignatureMap(pSignatures, pSignatureIds);
+    neighborhood neighborhood_ = mInverseIndex->kneighbors(x_inverseIndex, pNneighbors, false, -1.0);
+    delete x_inverseIndex;
+    return neighborhood_;
+}
+
+SignatureMatrix* NearestNeighbors::computeSignatures(SparseMatrixFloat* pRawData) {
+    return mInverseIndex->computeSignatureVectors(pRawData, false);
+}
+
 distributionInverseIndex* NearestNeighbors::getDistributionOfInverseIndex() {
     return mInverseIndex->getDistribution();
 }
+
+candidateFilterStatistics NearestNeighbors::getCandidateFilterStatistics(bool pReset) {
+    return mInverseIndex->getCandidateFilterStatistics(pReset);
+}
+
+queryCacheStatistics NearestNeighbors::getQueryCacheStatistics(bool pReset) {
+    if (mQueryCache == NULL) return queryCacheStatistics();
+    return mQueryCache->getStatistics(pReset);
+}
+
+bool NearestNeighbors::save(const char* pPath) {
+    if (mOriginalData == NULL) return false;
+    if (mOriginalData->getNumberOfDotProducts() != mOriginalData->size()) {
+        mOriginalData->precomputeDotProduct();
+    }
+    IndexFileWriter writer;
+    if (!writer.open(pPath)) return false;
+    indexFileHeader* header = writer.getHeader();
+    header->numberOfInstances = mOriginalData->size();
+    header->maxNnz = mOriginalData->getMaxNnz();
+    header->parameters = mParameters;
+
+    const size_t numberOfValues = mOriginalData->size() * mOriginalData->getMaxNnz();
+    writer.writeSection(SECTION_FEATURE_IDS, mOriginalData->getSparseMatrixIndex(), numberOfValues * sizeof(uint32_t));
+    writer.writeSection(SECTION_FEATURE_VALUES, mOriginalData->getSparseMatrixValues(), numberOfValues * sizeof(float));
+    writer.writeSection(SECTION_INSTANCE_SIZES, mOriginalData->getSparseMatrixSizeOfInstances(), mOriginalData->size() * sizeof(size_t));
+    writer.writeSection(SECTION_NORMS, mOriginalData->getDotProducts(), mOriginalData->size() * sizeof(float));
+    if (!mInverseIndex->save(&writer)) return false;
+    return writer.close();
+}
+
+NearestNeighbors* NearestNeighbors::load(const char* pPath, bool pPopulate) {
+    MappedIndexFile* indexFile = new MappedIndexFile();
+    if (!indexFile->open(pPath, pPopulate)) {
+        delete indexFile;
+        return NULL;
+    }
+    const indexFileHeader* header = indexFile->getHeader();
+    const indexFileParameters& parameters = header->parameters;
+    NearestNeighbors* nearestNeighbors = new NearestNeighbors(parameters.numberOfHashFunctions, parameters.shingleSize,
+                    parameters.numberOfCores, parameters.chunkSize, parameters.maxBinSize,
+                    parameters.sizeOfNeighborhood, parameters.minimalBlocksInCommon,
+                    parameters.excessFactor, parameters.maximalNumberOfHashCollisions,
+                    parameters.fast, parameters.similarity,
+                    parameters.pruneInverseIndex, parameters.pruneInverseIndexAfterInstance,
+                    parameters.removeHashFunctionWithLessEntriesAs,
+                    parameters.hashAlgorithm, parameters.blockSize,
+                    parameters.shingle, parameters.removeValueWithLeastSigificantBit,
+                    parameters.cpuGpuLoadBalancing, parameters.gpuHash, parameters.rangeK_Wta,
+                    parameters.bitsPerHashValue, parameters.inverseIndexStorageType,
+                    parameters.compactionThreshold, parameters.numaReplication,
+                    parameters.candidateBudget, parameters.multiProbe,
+                    parameters.maxCandidates, parameters.collisionCutoff, parameters.queryCacheSize);
+    nearestNeighbors->mIndexFile = indexFile;
+
+    const size_t numberOfInstances = header->numberOfInstances;
+    const size_t numberOfValues = numberOfInstances * header->maxNnz;
+    if (indexFile->getSectionSize(SECTION_FEATURE_IDS) != numberOfValues * sizeof(uint32_t)
+            || indexFile->getSectionSize(SECTION_FEATURE_VALUES) != numberOfValues * sizeof(float)
+            || indexFile->getSectionSize(SECTION_INSTANCE_SIZES) != numberOfInstances * sizeof(size_t)
+            || indexFile->getSectionSize(SECTION_NORMS) != numberOfInstances * sizeof(float)
+            || !nearestNeighbors->mInverseIndex->load(indexFile)) {
+        delete nearestNeighbors;
+        return NULL;
+    }
+    nearestNeighbors->mOriginalData = new SparseMatrixFloat(
+                            static_cast<const uint32_t*>(indexFile->getSection(SECTION_FEATURE_IDS)),
+                            static_cast<const float*>(indexFile->getSection(SECTION_FEATURE_VALUES)),
+                            static_cast<const size_t*>(indexFile->getSection(SECTION_INSTANCE_SIZES)),
+                            static_cast<const float*>(indexFile->getSection(SECTION_NORMS)),
+                            numberOfInstances, header->maxNnz);
+    return nearestNeighbors;
+}
@@ -13,6 +13,7 @@
 
 #include "inverseIndex.h"
 #include "hash.h"
+#include "queryCache.h"
 
 #ifdef CUDA
 #include "nearestNeighborsCuda.h"
@@ -25,6 +26,9 @@ class NearestNeighbors {
   protected:
     InverseIndex* mInverseIndex = NULL;
     SparseMatrixFloat* mOriginalData = NULL;
+    // mapping of the index file a loaded object uses, it must outlive the index and the original data
+    MappedIndexFile* mIndexFile = NULL;
+    indexFileParameters mParameters;
 
 	neighborhood computeNeighborhood();
     neighborhood computeExactNeighborhood();
@@ -39,6 +43,11 @@ class NearestNeighbors {
     float mCpuGpuLoadBalancing;
     size_t mGpuHash;
     Hash* mHash = NULL;
+    // results of recent queries, NULL if the cache is switched off
+    QueryCache* mQueryCache = NULL;
+    void clearQueryCache();
+    neighborhood computeKneighbors(SparseMatrixFloat* pRawData, size_t pNneighbors, int pFast, int pSimilarity, float pRadius,
+                                    SignatureMatrix* pSignatures);
     #ifdef CUDA
     NearestNeighborsCuda* mNearestNeighborsCuda = NULL;
     #endif
@@ -55,15 +64,36 @@ class NearestNeighbors {
                     int pRemoveHashFunctionWithLessEntriesAs, 
                     size_t pHashAlgorithm, size_t pBlockSize,
                     size_t pShingle, size_t pRemoveValueWithLeastSigificantBit,
-                    float pCpuGpuLoadBalancing, size_t pGpuHash, size_t pRangeK_Wta);
+                    float pCpuGpuLoadBalancing, size_t pGpuHash, size_t pRangeK_Wta,
+                    size_t pBitsPerHashValue, size_t pInverseIndexStorageType,
+                    float pCompactionThreshold, size_t pNumaReplication,
+                    size_t pCandidateBudget, size_t pMultiProbe,
+                    size_t pMaxCandidates, float pCollisionCutoff, size_t pQueryCacheSize);
 
   	~NearestNeighbors(); 
     // Calculate the inverse index for the given instances.
     void fit(SparseMatrixFloat* pRawData); 
-    // Extend the inverse index with the given instances.
-    void partialFit(SparseMatrixFloat* pRawData, size_t pStartIndex); 
-    // Calculate k-nearest neighbors.
-    neighborhood* kneighbors(SparseMatrixFloat* pRawData, size_t pNneighbors, int pFast, int pSimilarity = -1, float pRadius = -1.0); 
+    // Extend the inverse index with the given instances. Returns false if the index can not be extended.
+    bool partialFit(SparseMatrixFloat* pRawData, size_t pStartIndex);
+    // Remove the given instances from the index, their ids are not reused.
+    void remove(const vsize_t& pInstances);
+    // Replace the given instances by the rows of pRawData. Returns false if the index can not be extended
+    // or an id is invalid or given twice.
+    bool update(const vsize_t& pInstances, SparseMatrixFloat* pRawData);
+    // Calculate k-nearest neighbors. pSignatures are the signatures of pRawData if they are already known,
+    // e.g. computed once by the coordinator of a sharded index and sent to every shard.
+    // With a query cache the rows of a fast query that were queried before with the same parameters are answered from it.
+    neighborhood kneighbors(SparseMatrixFloat* pRawData, size_t pNneighbors, int pFast, int pSimilarity = -1, float pRadius = -1.0,
+                                SignatureMatrix* pSignatures = NULL); 
+    // Calculate the fast k-nearest neighbors of queries that are given only by their signatures and signature ids,
+    // e.g. sent by the coordinator of a sharded index without the features.
+    neighborhood kneighbors(SignatureMatrix* pSignatures, const vsize_t& pSignatureIds, size_t pNneighbors);
+    // Calculate the signatures of pRawData. The object does not need to be fitted, objects with the same
+    // parameters compute the same signatures.
+    SignatureMatrix* computeSignatures(SparseMatrixFloat* pRawData);
+    // The signature ids of the rows of pRawData, see kneighbors.
+    vsize_t computeSignatureIds(SparseMatrixFloat* pRawData) { return mInverseIndex->computeSignatureIds(pRawData); };
+    size_t getSignatureWidth() { return mInverseIndex->getSignatureWidth(); };
 
     void set_mOriginalData(SparseMatrixFloat* pOriginalData) {
       mOriginalData = pOriginalData;
@@ -75,6 +105,15 @@ class NearestNeighbors {
     size_t getNneighbors() { return mNneighbors; };
     
     distributionInverseIndex* getDistributionOfInverseIndex();
+    // counters of the candidate filter of the inverse index, pReset sets them to zero
+    candidateFilterStatistics getCandidateFilterStatistics(bool pReset);
+    // counters of the query cache, pReset sets the hits and misses to zero
+    queryCacheStatistics getQueryCacheStatistics(bool pReset);
+    // Write the fitted object to an index file. Needs the read-only csr inverse index (storage 2 or 3).
+    bool save(const char* pPath);
+    // Create an object from an index file. The arrays are used in place from a shared read-only mapping,
+    // with pPopulate the file is read completely while loading. Returns NULL if the file is not a valid index file.
+    static NearestNeighbors* load(const char* pPath, bool pPopulate);
     
 };
 #endif // NEAREST_NEIGHBORS_H
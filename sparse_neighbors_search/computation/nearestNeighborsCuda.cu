@@ -23,7 +23,7 @@ NearestNeighborsCuda::~NearestNeighborsCuda() {
     
 }
 
-neighborhood* NearestNeighborsCuda::computeNearestNeighbors(neighborhood* neighbors, size_t pSimilarity, SparseMatrixFloat* pRawData,
+neighborhood NearestNeighborsCuda::computeNearestNeighbors(const neighborhood& neighbors, size_t pSimilarity, SparseMatrixFloat* pRawData,
                                                             SparseMatrixFloat* pOriginalRawData, size_t pMaxNeighbors) {
     float* precomputedDotProductNeighbor;
     int* featureIdsNeighbor;
@@ -95,36 +95,36 @@ neighborhood* NearestNeighborsCuda::computeNearestNeighbors(neighborhood* neighb
     // compute jump lenghts for list of neighbor candidates.
     // transfer data to gpu and create space for the euclidean distance/cosine similarity computation
     // --> float3* dotProducts
-    size_t* jumpLengthList = (size_t*) malloc(neighbors->neighbors->size() * sizeof(size_t));
+    size_t* jumpLengthList = (size_t*) malloc(neighbors.size() * sizeof(size_t));
     size_t count = 0;
-    size_t* candidatesSize = (size_t*) malloc(neighbors->neighbors->size() * sizeof(size_t));
-    for (size_t i = 0; i < neighbors->neighbors->size(); ++i) {
+    size_t* candidatesSize = (size_t*) malloc(neighbors.size() * sizeof(size_t));
+    for (size_t i = 0; i < neighbors.size(); ++i) {
         jumpLengthList[i] = count;
-        count += neighbors->neighbors->operator[](i).size();
-        candidatesSize[i] = neighbors->neighbors->operator[](i).size();
+        count += neighbors.getSize(i);
+        candidatesSize[i] = neighbors.getSize(i);
     }
     float3* dotProducts;
     cudaMalloc((void **) &dotProducts, sizeof(float3) * count);
     int* candidates = (int*) malloc(count * sizeof(int));
     
-    for (size_t i = 0; i < neighbors->neighbors->size(); ++i) {
-        for (size_t j = 0; j < neighbors->neighbors->operator[](i).size(); ++j) {
-            candidates[jumpLengthList[i]+j] = neighbors->neighbors->operator[](i)[j];
+    for (size_t i = 0; i < neighbors.size(); ++i) {
+        for (size_t j = 0; j < neighbors.getSize(i); ++j) {
+            candidates[jumpLengthList[i]+j] = neighbors.getNeighbors(i)[j];
         }
     } 
     int* candidatesCuda;
     cudaMalloc((void **) &candidatesCuda, count * sizeof(int));
     cudaMemcpy(candidatesCuda, candidates, count * sizeof(int), cudaMemcpyHostToDevice);
     size_t* jumpLengthListCuda;
-    cudaMalloc((void **) &jumpLengthListCuda, neighbors->neighbors->size() * sizeof(size_t));
-    cudaMemcpy(jumpLengthListCuda, jumpLengthList, neighbors->neighbors->size() * sizeof(size_t), cudaMemcpyHostToDevice);
+    cudaMalloc((void **) &jumpLengthListCuda, neighbors.size() * sizeof(size_t));
+    cudaMemcpy(jumpLengthListCuda, jumpLengthList, neighbors.size() * sizeof(size_t), cudaMemcpyHostToDevice);
     size_t* candidatesSizeCuda;
-    cudaMalloc((void **) &candidatesSizeCuda, neighbors->neighbors->size() * sizeof(size_t));
-    cudaMemcpy(candidatesSizeCuda, candidatesSize, neighbors->neighbors->size() * sizeof(size_t), cudaMemcpyHostToDevice);
+    cudaMalloc((void **) &candidatesSizeCuda, neighbors.size() * sizeof(size_t));
+    cudaMemcpy(candidatesSizeCuda, candidatesSize, neighbors.size() * sizeof(size_t), cudaMemcpyHostToDevice);
     // compute all dot products for all candidates with their specific query instance.
     // The base dataset is called 'neighbors' the query instances are 'instance'
     computeDotProducts<<<1024, 32>>>(dotProducts, count, candidatesCuda, jumpLengthListCuda,
-                                      candidatesSizeCuda, neighbors->neighbors->size(), featureIdsNeighbor, valuesNeighbor,
+                                      candidatesSizeCuda, neighbors.size(), featureIdsNeighbor, valuesNeighbor,
                                       maxNnzNeighbor, sizeNeighbor,
                                       featureIdsInstance, valuesInstance, maxNnzInstance,
                                       sizeInstance, precomputedDotProductNeighbor, precomputedDotProductInstance);
@@ -143,14 +143,12 @@ neighborhood* NearestNeighborsCuda::computeNearestNeighbors(neighborhood* neighb
     cudaMemcpy(results, resultsCuda, sizeof(float) * count, cudaMemcpyDeviceToHost);
     
     // return results
-    neighborhood* neighbors_ = new neighborhood();;
-    neighbors_->neighbors = new vvsize_t(neighbors->neighbors->size());
-    neighbors_->distances = new vvfloat(neighbors->neighbors->size());
-    for (size_t i = 0; i < neighbors->neighbors->size(); ++i) {
-        std::vector<sortMapFloat> returnValue(neighbors->neighbors->operator[](i).size());
-        for (size_t j = 0; j < neighbors->neighbors->operator[](i).size(); ++j) {
+    NeighborhoodBuilder neighbors_(neighbors.size(), 1);
+    for (size_t i = 0; i < neighbors.size(); ++i) {
+        std::vector<sortMapFloat> returnValue(neighbors.getSize(i));
+        for (size_t j = 0; j < neighbors.getSize(i); ++j) {
             sortMapFloat element; 
-            element.key = neighbors->neighbors->operator[](i)[j];
+            element.key = neighbors.getNeighbors(i)[j];
             element.val = results[jumpLengthList[i]+j];
             returnValue[j] = element;
         }
@@ -170,8 +168,7 @@ neighborhood* NearestNeighborsCuda::computeNearestNeighbors(neighborhood* neighb
                 neighborsVector[j] = returnValue[j].key;
                 distancesVector[j] = returnValue[j].val;
         }
-        neighbors_->neighbors->operator[](i) = neighborsVector;
-        neighbors_->distances->operator[](i) = distancesVector;
+        neighbors_.setRow(0, i, neighborsVector, distancesVector);
     } 
     
     cudaFree(dotProducts);
@@ -194,5 +191,5 @@ neighborhood* NearestNeighborsCuda::computeNearestNeighbors(neighborhood* neighb
     free(results);
     cudaDeviceSynchronize();
     
-    return neighbors_;
+    return neighbors_.build(1);
 }
\ No newline at end of file
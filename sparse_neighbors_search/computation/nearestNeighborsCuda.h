@@ -22,7 +22,7 @@ class NearestNeighborsCuda {
   public:
     NearestNeighborsCuda();
     ~NearestNeighborsCuda();
-    neighborhood* computeNearestNeighbors(neighborhood* neighbors, 
+    neighborhood computeNearestNeighbors(const neighborhood& neighbors, 
                 size_t pSimilarity, SparseMatrixFloat* pRawData, 
                 SparseMatrixFloat* pOriginalRawData, size_t pMaxNeighbors);
 };
@@ -0,0 +1,116 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <algorithm>
+#ifdef OPENMP
+#include <omp.h>
+#endif
+#include "typeDefinitionsBasic.h"
+
+#ifndef NEIGHBORHOOD_H
+#define NEIGHBORHOOD_H
+
+// the neighbors and distances of all query instances in one flat csr layout. the neighbors of
+// instance i are at getNeighbors(i)[0] .. getNeighbors(i)[getSize(i) - 1], an instance without
+// neighbors has an empty row. a neighborhood is moved, never copied.
+class neighborhood {
+  private:
+    vsize_t mOffsets;
+    vsize_t mNeighbors;
+    vfloat mDistances;
+  public:
+    neighborhood() : mOffsets(1, 0) { };
+    neighborhood(vsize_t&& pOffsets, vsize_t&& pNeighbors, vfloat&& pDistances) :
+        mOffsets(std::move(pOffsets)), mNeighbors(std::move(pNeighbors)), mDistances(std::move(pDistances)) { };
+    neighborhood(const neighborhood&) = delete;
+    neighborhood& operator=(const neighborhood&) = delete;
+    neighborhood(neighborhood&&) = default;
+    neighborhood& operator=(neighborhood&&) = default;
+    // number of query instances
+    size_t size() const {
+        return mOffsets.size() - 1;
+    };
+    size_t getSize(size_t pInstance) const {
+        return mOffsets[pInstance + 1] - mOffsets[pInstance];
+    };
+    const size_t* getNeighbors(size_t pInstance) const {
+        return mNeighbors.data() + mOffsets[pInstance];
+    };
+    const float* getDistances(size_t pInstance) const {
+        return mDistances.data() + mOffsets[pInstance];
+    };
+};
+
+// number of the calling thread in its openmp team
+inline size_t getThreadNumber() {
+#ifdef OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+// assembles a neighborhood from rows that several threads compute at the same time, without locks.
+// a thread appends its rows to its own buffer and only notes their position in the slot of the row,
+// every row is set by a single thread. build() copies the rows to their place in the csr layout.
+class NeighborhoodBuilder {
+  private:
+    struct rowPosition {
+        size_t thread;
+        size_t begin;
+        size_t size;
+    };
+    std::vector<rowPosition> mRows;
+    std::vector<vsize_t> mThreadNeighbors;
+    std::vector<vfloat> mThreadDistances;
+  public:
+    NeighborhoodBuilder(size_t pNumberOfRows, size_t pNumberOfThreads) {
+        rowPosition emptyRow = {0, 0, 0};
+        mRows.resize(pNumberOfRows, emptyRow);
+        mThreadNeighbors.resize(std::max(pNumberOfThreads, static_cast<size_t>(1)));
+        mThreadDistances.resize(mThreadNeighbors.size());
+    };
+    // pThread is the number of the calling thread, see getThreadNumber. setting a row again replaces it.
+    void setRow(size_t pThread, size_t pRow, const size_t* pNeighbors, const float* pDistances, size_t pSize) {
+        vsize_t& neighbors = mThreadNeighbors[pThread];
+        vfloat& distances = mThreadDistances[pThread];
+        rowPosition& row = mRows[pRow];
+        row.thread = pThread;
+        row.begin = neighbors.size();
+        row.size = pSize;
+        neighbors.insert(neighbors.end(), pNeighbors, pNeighbors + pSize);
+        distances.insert(distances.end(), pDistances, pDistances + pSize);
+    };
+    void setRow(size_t pThread, size_t pRow, const vsize_t& pNeighbors, const vfloat& pDistances) {
+        setRow(pThread, pRow, pNeighbors.data(), pDistances.data(), pNeighbors.size());
+    };
+    neighborhood build(size_t pNumberOfThreads) {
+        vsize_t offsets(mRows.size() + 1, 0);
+        for (size_t i = 0; i < mRows.size(); ++i) {
+            offsets[i + 1] = offsets[i] + mRows[i].size;
+        }
+        vsize_t neighbors(offsets.back());
+        vfloat distances(offsets.back());
+#ifdef OPENMP
+#pragma omp parallel for schedule(static) num_threads(std::max(pNumberOfThreads, static_cast<size_t>(1)))
+#endif
+        for (size_t i = 0; i < mRows.size(); ++i) {
+            const rowPosition& row = mRows[i];
+            if (row.size == 0) continue;
+            std::copy(mThreadNeighbors[row.thread].begin() + row.begin, mThreadNeighbors[row.thread].begin() + row.begin + row.size,
+                      neighbors.begin() + offsets[i]);
+            std::copy(mThreadDistances[row.thread].begin() + row.begin, mThreadDistances[row.thread].begin() + row.begin + row.size,
+                      distances.begin() + offsets[i]);
+        }
+        return neighborhood(std::move(offsets), std::move(neighbors), std::move(distances));
+    };
+};
+#endif // NEIGHBORHOOD_H
@@ -0,0 +1,121 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <stdio.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "typeDefinitionsBasic.h"
+
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+// numa nodes and their cpus as listed in /sys/devices/system/node. on other systems, or if the
+// list can not be read, the machine has one node and threads are never bound.
+class NumaTopology {
+  private:
+    std::vector<vsize_t> mCpusOfNodes;
+    NumaTopology() {
+#ifdef __linux__
+        for (size_t node = 0; ; ++node) {
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%zu/cpulist", node);
+            FILE* file = fopen(path, "r");
+            if (file == NULL) break;
+            // a list of cpus and ranges of cpus, e.g. 0-15,32-47
+            vsize_t cpus;
+            size_t first;
+            size_t last;
+            char separator;
+            while (fscanf(file, "%zu", &first) == 1) {
+                last = first;
+                separator = fgetc(file);
+                if (separator == '-') {
+                    if (fscanf(file, "%zu", &last) != 1) break;
+                    separator = fgetc(file);
+                }
+                for (size_t cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+                if (separator != ',') break;
+            }
+            fclose(file);
+            // nodes without cpus only have memory, no thread can run there
+            if (cpus.size() != 0) {
+                mCpusOfNodes.push_back(cpus);
+            }
+        }
+#endif
+    };
+  public:
+    static const NumaTopology& get() {
+        static NumaTopology topology;
+        return topology;
+    };
+    size_t getNumberOfNodes() const {
+        return mCpusOfNodes.size() > 1 ? mCpusOfNodes.size() : 1;
+    };
+    // node of thread pThread of pNumberOfThreads, the threads are split into one consecutive block per node
+    size_t getNodeOfThread(size_t pThread, size_t pNumberOfThreads) const {
+        if (pThread >= pNumberOfThreads) return 0;
+        return pThread * getNumberOfNodes() / pNumberOfThreads;
+    };
+    // restrict the calling thread to the cpus of pNode
+    bool bindThread(size_t pNode) const {
+#ifdef __linux__
+        if (pNode >= mCpusOfNodes.size()) return false;
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (size_t i = 0; i < mCpusOfNodes[pNode].size(); ++i) {
+            CPU_SET(mCpusOfNodes[pNode][i], &cpus);
+        }
+        return sched_setaffinity(0, sizeof(cpu_set_t), &cpus) == 0;
+#else
+        return false;
+#endif
+    };
+};
+
+// node whose copy of a replicated index the calling thread reads, 0 for threads that are not bound
+inline size_t& currentNumaNode() {
+    static thread_local size_t node = 0;
+    return node;
+}
+
+// binds the calling thread to a node for the lifetime of the object and restores its cpus afterwards.
+// the node is chosen from the position of the thread in its team, see NumaTopology::getNodeOfThread.
+class NumaThreadBinding {
+  private:
+    bool mBound = false;
+#ifdef __linux__
+    cpu_set_t mPreviousCpus;
+#endif
+  public:
+    NumaThreadBinding(bool pBind, size_t pThread, size_t pNumberOfThreads) {
+#ifdef __linux__
+        const NumaTopology& topology = NumaTopology::get();
+        if (!pBind || topology.getNumberOfNodes() < 2) return;
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &mPreviousCpus) != 0) return;
+        const size_t node = topology.getNodeOfThread(pThread, pNumberOfThreads);
+        if (!topology.bindThread(node)) return;
+        currentNumaNode() = node;
+        mBound = true;
+#endif
+    };
+    ~NumaThreadBinding() {
+#ifdef __linux__
+        if (!mBound) return;
+        sched_setaffinity(0, sizeof(cpu_set_t), &mPreviousCpus);
+        currentNumaNode() = 0;
+#endif
+    };
+};
+#endif // NUMA_TOPOLOGY_H
@@ -61,24 +61,32 @@ SparseMatrixFloat* parseRawData(PyObject * pInstancesListObj, PyObject * pFeatur
     return originalData;
 }
 
-static PyObject* radiusNeighborhood(const neighborhood* pNeighborhood, const float pRadius, const size_t pCutFirstValue, const size_t pReturnDistance) {
-    size_t sizeOfNeighborList = pNeighborhood->neighbors->size();
+vsize_t parseInstanceIds(PyObject* pInstanceIdsListObj) {
+    vsize_t instanceIds(PyList_Size(pInstanceIdsListObj));
+    for (size_t i = 0; i < instanceIds.size(); ++i) {
+        PyArg_Parse(PyList_GetItem(pInstanceIdsListObj, i), "k", &instanceIds[i]);
+    }
+    return instanceIds;
+}
+
+static PyObject* radiusNeighborhood(const neighborhood& pNeighborhood, const float pRadius, const size_t pCutFirstValue, const size_t pReturnDistance) {
+    size_t sizeOfNeighborList = pNeighborhood.size();
     PyObject * outerListNeighbors = PyList_New(sizeOfNeighborList);
     PyObject * outerListDistances = PyList_New(sizeOfNeighborList);
 
     for (size_t i = 0; i < sizeOfNeighborList; ++i) {
-        size_t sizeOfInnerNeighborList = pNeighborhood->neighbors->operator[](i).size();
+        size_t sizeOfInnerNeighborList = pNeighborhood.getSize(i);
         // std::cout << "Size: " << sizeOfInnerNeighborList << std::endl;
         PyObject* innerListNeighbors = PyList_New(0);
         PyObject* innerListDistances = PyList_New(0);
 
         for (size_t j = 0 + pCutFirstValue; j < sizeOfInnerNeighborList; ++j) {
-            // std::cout << "neighbor: " << pNeighborhood->neighbors->operator[](i)[j] << " distance: " << pNeighborhood->distances->operator[](i)[j] << " pRadius: " << pRadius << std::endl;
-            if (pNeighborhood->distances->operator[](i)[j] <= pRadius) {
-                PyObject* valueNeighbor = Py_BuildValue("i", static_cast<int>(pNeighborhood->neighbors->operator[](i)[j]));
+            // std::cout << "neighbor: " << pNeighborhood.getNeighbors(i)[j] << " distance: " << pNeighborhood.getDistances(i)[j] << " pRadius: " << pRadius << std::endl;
+            if (pNeighborhood.getDistances(i)[j] <= pRadius) {
+                PyObject* valueNeighbor = Py_BuildValue("i", static_cast<int>(pNeighborhood.getNeighbors(i)[j]));
                 PyList_Append(innerListNeighbors, valueNeighbor);
                 
-                PyObject* valueDistance = Py_BuildValue("f", pNeighborhood->distances->operator[](i)[j]);
+                PyObject* valueDistance = Py_BuildValue("f", pNeighborhood.getDistances(i)[j]);
                 PyList_Append(innerListDistances,  valueDistance);
             } else {
                 break;
@@ -88,9 +96,6 @@ static PyObject* radiusNeighborhood(const neighborhood* pNeighborhood, const flo
         PyList_SetItem(outerListDistances, i, innerListDistances);
      
     }
-    delete pNeighborhood->neighbors;
-    delete pNeighborhood->distances;
-    delete pNeighborhood;
     PyObject * returnList;
     if (pReturnDistance) {
         returnList = PyList_New(2);
@@ -103,38 +108,38 @@ static PyObject* radiusNeighborhood(const neighborhood* pNeighborhood, const flo
     return returnList;
 }
 
-static PyObject* bringNeighborhoodInShape(const neighborhood* pNeighborhood, const size_t pNneighbors, const size_t pCutFirstValue, const size_t pReturnDistance) {
-    size_t sizeOfNeighborList = pNeighborhood->neighbors->size();
+static PyObject* bringNeighborhoodInShape(const neighborhood& pNeighborhood, const size_t pNneighbors, const size_t pCutFirstValue, const size_t pReturnDistance) {
+    size_t sizeOfNeighborList = pNeighborhood.size();
     PyObject * outerListNeighbors = PyList_New(sizeOfNeighborList);
     PyObject * outerListDistances = PyList_New(sizeOfNeighborList);
 
     for (size_t i = 0; i < sizeOfNeighborList; ++i) {
-        size_t sizeOfInnerNeighborList = pNeighborhood->neighbors->operator[](i).size();
+        size_t sizeOfInnerNeighborList = pNeighborhood.getSize(i);
         PyObject* innerListNeighbors = PyList_New(pNneighbors);
         PyObject* innerListDistances = PyList_New(pNneighbors);
         if (sizeOfInnerNeighborList > pNneighbors) {
             for (size_t j = 0 + pCutFirstValue; j < pNneighbors + pCutFirstValue; ++j) {
-                PyObject* valueNeighbor = Py_BuildValue("i", static_cast<int>(pNeighborhood->neighbors->operator[](i)[j]));
+                PyObject* valueNeighbor = Py_BuildValue("i", static_cast<int>(pNeighborhood.getNeighbors(i)[j]));
                 if (PyList_SetItem(innerListNeighbors, j - pCutFirstValue, valueNeighbor) == -1) {
-                    std::cout << "error: " << __LINE__ << pNeighborhood->neighbors->operator[](i)[j] << std::endl;
+                    std::cout << "error: " << __LINE__ << pNeighborhood.getNeighbors(i)[j] << std::endl;
                 }
                 
-                PyObject* valueDistance = Py_BuildValue("f", pNeighborhood->distances->operator[](i)[j]);
+                PyObject* valueDistance = Py_BuildValue("f", pNeighborhood.getDistances(i)[j]);
                 if (PyList_SetItem(innerListDistances, j - pCutFirstValue, valueDistance) == -1) {
-                    std::cout << "error: " << __LINE__ << pNeighborhood->distances->operator[](i)[j] << std::endl;
+                    std::cout << "error: " << __LINE__ << pNeighborhood.getDistances(i)[j] << std::endl;
                 }
                 
             }
         } else {
             for (size_t j = 0 + pCutFirstValue; j < sizeOfInnerNeighborList; ++j) {
-                PyObject* valueNeighbor = Py_BuildValue("i", static_cast<int>(pNeighborhood->neighbors->operator[](i)[j]));
+                PyObject* valueNeighbor = Py_BuildValue("i", static_cast<int>(pNeighborhood.getNeighbors(i)[j]));
                 if (PyList_SetItem(innerListNeighbors, j - pCutFirstValue, valueNeighbor) == -1) {
-                    std::cout << "error: " << __LINE__ << pNeighborhood->neighbors->operator[](i)[j] << std::endl;
+                    std::cout << "error: " << __LINE__ << pNeighborhood.getNeighbors(i)[j] << std::endl;
 
                 }
-                PyObject* valueDistance = Py_BuildValue("f", pNeighborhood->distances->operator[](i)[j]);
+                PyObject* valueDistance = Py_BuildValue("f", pNeighborhood.getDistances(i)[j]);
                 if (PyList_SetItem(innerListDistances, j -pCutFirstValue, valueDistance) == -1) {
-                    std::cout << "error: " << __LINE__ << pNeighborhood->distances->operator[](i)[j] << std::endl;
+                    std::cout << "error: " << __LINE__ << pNeighborhood.getDistances(i)[j] << std::endl;
 
                 }
             }
@@ -159,9 +164,6 @@ static PyObject* bringNeighborhoodInShape(const neighborhood* pNeighborhood, con
             std::cout << "error setting distnace list: " << i << std::endl;
         }
     }
-    delete pNeighborhood->neighbors;
-    delete pNeighborhood->distances;
-    delete pNeighborhood;
 
     PyObject * returnList;
     if (pReturnDistance) {
@@ -175,22 +177,22 @@ static PyObject* bringNeighborhoodInShape(const neighborhood* pNeighborhood, con
     return returnList;
 }
 
-static PyObject* buildGraph(const neighborhood* pNeighborhood, const size_t pNneighbors, const size_t pReturnDistance, const size_t symmetric) {
-    size_t sizeOfNeighborList = pNeighborhood->neighbors->size();
+static PyObject* buildGraph(const neighborhood& pNeighborhood, const size_t pNneighbors, const size_t pReturnDistance, const size_t symmetric) {
+    size_t sizeOfNeighborList = pNeighborhood.size();
     PyObject * rowList = PyList_New(0);
     PyObject * columnList = PyList_New(0);
     PyObject * dataList = PyList_New(0);
     std::map<std::pair<size_t, size_t>, float> symmetricMatrix;
     if (symmetric) {
         for (size_t i = 0; i < sizeOfNeighborList; ++i) {
-            size_t root = pNeighborhood->neighbors->operator[](i)[0];
-            size_t sizeOfInnerNeighborList = pNeighborhood->neighbors->operator[](i).size();
+            size_t root = pNeighborhood.getNeighbors(i)[0];
+            size_t sizeOfInnerNeighborList = pNeighborhood.getSize(i);
 
             for (size_t j = 0; j < sizeOfInnerNeighborList && j < pNneighbors; ++j) {
-                size_t node = pNeighborhood->neighbors->operator[](i)[j];
+                size_t node = pNeighborhood.getNeighbors(i)[j];
                 float distance;
                 if (pReturnDistance) {
-                    distance = pNeighborhood->distances->operator[](i)[j];
+                    distance = pNeighborhood.getDistances(i)[j];
                 } else {
                     distance = 1.0;
                 }
@@ -223,13 +225,13 @@ static PyObject* buildGraph(const neighborhood* pNeighborhood, const size_t pNne
 
         for (size_t i = 0; i < sizeOfNeighborList; ++i) {
 
-            PyObject* root = Py_BuildValue("i", static_cast<int>(pNeighborhood->neighbors->operator[](i)[0]));
-            size_t sizeOfInnerNeighborList = pNeighborhood->neighbors->operator[](i).size();
+            PyObject* root = Py_BuildValue("i", static_cast<int>(pNeighborhood.getNeighbors(i)[0]));
+            size_t sizeOfInnerNeighborList = pNeighborhood.getSize(i);
             for (size_t j = 1; j < sizeOfInnerNeighborList && j < pNneighbors; ++j) {
-                PyObject* node = Py_BuildValue("i", static_cast<int>(pNeighborhood->neighbors->operator[](i)[j]));
+                PyObject* node = Py_BuildValue("i", static_cast<int>(pNeighborhood.getNeighbors(i)[j]));
                 PyObject* distance;
                 if (pReturnDistance) {
-                    distance = Py_BuildValue("f", pNeighborhood->distances->operator[](i)[j]);
+                    distance = Py_BuildValue("f", pNeighborhood.getDistances(i)[j]);
                 } else {
                     distance = Py_BuildValue("f", 1.0);
                 }
@@ -239,9 +241,6 @@ static PyObject* buildGraph(const neighborhood* pNeighborhood, const size_t pNne
             }
         }
     }
-    delete pNeighborhood->neighbors;
-    delete pNeighborhood->distances;
-    delete pNeighborhood;
 
     PyObject* graph = PyList_New(3);
     PyList_SetItem(graph, 0, rowList);
@@ -251,9 +250,9 @@ static PyObject* buildGraph(const neighborhood* pNeighborhood, const size_t pNne
     return graph;
 }
 
-static PyObject* radiusNeighborhoodGraph(const neighborhood* pNeighborhood, const float pRadius, const size_t pReturnDistance, 
+static PyObject* radiusNeighborhoodGraph(const neighborhood& pNeighborhood, const float pRadius, const size_t pReturnDistance, 
                                             const size_t symmetric) {
-    size_t sizeOfNeighborList = pNeighborhood->neighbors->size();
+    size_t sizeOfNeighborList = pNeighborhood.size();
 
     PyObject * rowList = PyList_New(0);
     PyObject * columnList = PyList_New(0);
@@ -262,15 +261,15 @@ static PyObject* radiusNeighborhoodGraph(const neighborhood* pNeighborhood, cons
     std::map<std::pair<size_t, size_t>, float> symmetricMatrix;
     if (symmetric) {
         for (size_t i = 0; i < sizeOfNeighborList; ++i) {
-            size_t root = pNeighborhood->neighbors->operator[](i)[0];
-            size_t sizeOfInnerNeighborList = pNeighborhood->neighbors->operator[](i).size();
+            size_t root = pNeighborhood.getNeighbors(i)[0];
+            size_t sizeOfInnerNeighborList = pNeighborhood.getSize(i);
 
             for (size_t j = 0; j < sizeOfInnerNeighborList; ++j) {
-                if (pNeighborhood->distances->operator[](i)[j] <= pRadius) {
-                    size_t node = pNeighborhood->neighbors->operator[](i)[j];
+                if (pNeighborhood.getDistances(i)[j] <= pRadius) {
+                    size_t node = pNeighborhood.getNeighbors(i)[j];
                     float distance;
                     if (pReturnDistance) {
-                        distance = pNeighborhood->distances->operator[](i)[j];
+                        distance = pNeighborhood.getDistances(i)[j];
                     } else {
                         distance = 1.0;
                     }
@@ -305,14 +304,14 @@ static PyObject* radiusNeighborhoodGraph(const neighborhood* pNeighborhood, cons
     } else {
         for (size_t i = 0; i < sizeOfNeighborList; ++i) {
 
-            PyObject* root = Py_BuildValue("i", static_cast<int>(pNeighborhood->neighbors->operator[](i)[0]));
-            size_t sizeOfInnerNeighborList = pNeighborhood->neighbors->operator[](i).size();
+            PyObject* root = Py_BuildValue("i", static_cast<int>(pNeighborhood.getNeighbors(i)[0]));
+            size_t sizeOfInnerNeighborList = pNeighborhood.getSize(i);
             for (size_t j = 1; j < sizeOfInnerNeighborList; ++j) {
-                if (pNeighborhood->distances->operator[](i)[j] <= pRadius) {
-                    PyObject* node = Py_BuildValue("i", static_cast<int>(pNeighborhood->neighbors->operator[](i)[j]));
+                if (pNeighborhood.getDistances(i)[j] <= pRadius) {
+                    PyObject* node = Py_BuildValue("i", static_cast<int>(pNeighborhood.getNeighbors(i)[j]));
                     PyObject* distance;
                     if (pReturnDistance) {
-                        distance = Py_BuildValue("f", pNeighborhood->distances->operator[](i)[j]);
+                        distance = Py_BuildValue("f", pNeighborhood.getDistances(i)[j]);
                     } else {
                         distance = Py_BuildValue("f", 1.0);
                     }
@@ -325,9 +324,6 @@ static PyObject* radiusNeighborhoodGraph(const neighborhood* pNeighborhood, cons
             }
         }
     }
-    delete pNeighborhood->neighbors;
-    delete pNeighborhood->distances;
-    delete pNeighborhood;
     
     PyObject* graph = PyList_New(3);
     PyList_SetItem(graph, 0, rowList);
@@ -358,6 +354,16 @@ static PyObject* parseDistributionOfInverseIndex(distributionInverseIndex* distr
     }
     PyObject* mean = Py_BuildValue("i", distribution->mean);
     PyObject* standardDeviation = Py_BuildValue("i", distribution->standardDeviation);
+    PyObject* falsePositiveRate = Py_BuildValue("f", distribution->falsePositiveRate);
+    PyObject* numberOfOverflowedHashValues = Py_BuildValue("k", distribution->numberOfOverflowedHashValues);
+    PyObject* quantiles = PyDict_New();
+    for (size_t i = 0; i < distribution->quantiles.size(); ++i) {
+        PyObject* quantile = Py_BuildValue("f", distribution->quantiles[i]);
+        PyObject* size = Py_BuildValue("k", distribution->sizeOfPostingListAtQuantile[i]);
+        PyDict_SetItem(quantiles, quantile, size);
+        Py_DECREF(quantile);
+        Py_DECREF(size);
+    }
     
     PyObject* result = PyList_New(0);
     PyList_Append(result, distributionVector);
@@ -366,7 +372,28 @@ static PyObject* parseDistributionOfInverseIndex(distributionInverseIndex* distr
     PyList_Append(result, standardDeviationForNumberOfValuesPerHashValueList);
     PyList_Append(result, mean);
     PyList_Append(result, standardDeviation);
+    PyList_Append(result, falsePositiveRate);
+    PyList_Append(result, numberOfOverflowedHashValues);
+    PyList_Append(result, quantiles);
     
     return result;    
 }
+
+static PyObject* parseCandidateFilterStatistics(const candidateFilterStatistics& pStatistics) {
+    return Py_BuildValue("{s:k,s:k,s:k,s:k,s:k,s:k,s:k}",
+                         "queries", pStatistics.numberOfQueries,
+                         "candidates", pStatistics.numberOfCandidates,
+                         "single_collision_candidates", pStatistics.numberOfSingleCollisionCandidates,
+                         "removed_by_minimal_blocks_in_common", pStatistics.numberOfRemovedByMinimalBlocksInCommon,
+                         "removed_by_collision_cutoff", pStatistics.numberOfRemovedByCollisionCutoff,
+                         "removed_by_limit", pStatistics.numberOfRemovedByLimit,
+                         "passed_candidates", pStatistics.numberOfPassedCandidates);
+}
+
+static PyObject* parseQueryCacheStatistics(const queryCacheStatistics& pStatistics) {
+    return Py_BuildValue("{s:k,s:k,s:k}",
+                         "hits", pStatistics.numberOfHits,
+                         "misses", pStatistics.numberOfMisses,
+                         "entries", pStatistics.numberOfEntries);
+}
 #endif // PARSE_H
\ No newline at end of file
@@ -0,0 +1,183 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <unordered_map>
+#include "typeDefinitionsBasic.h"
+#include "sparseMatrix.h"
+#include "neighborhood.h"
+
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+// the cache is split into this many parts with their own lock, queries of different parts do not wait for each other
+#define QUERY_CACHE_NUMBER_OF_SHARDS 16
+
+// parameters of a query that change its result
+struct queryParameters {
+    size_t nNeighbors;
+    int fast;
+    int similarity;
+    float radius;
+};
+
+// the neighbors of recently queried instances, found by the features and values of the instance and the
+// parameters of the query. the fingerprint of a query selects the entry, a hit compares the features too, so
+// two queries with the same fingerprint never share a result. every part of the cache replaces its entries
+// with the clock algorithm: an entry that was used since the hand passed it last gets a second chance.
+class QueryCache {
+  private:
+    struct entry {
+        uint64_t fingerprint;
+        queryParameters parameters;
+        std::vector<uint32_t> features;
+        vfloat values;
+        vsize_t neighbors;
+        vfloat distances;
+        bool referenced;
+    };
+    struct shard {
+        std::mutex lock;
+        std::unordered_map<uint64_t, size_t> positions;
+        std::vector<entry> entries;
+        size_t hand = 0;
+    };
+    shard mShards[QUERY_CACHE_NUMBER_OF_SHARDS];
+    size_t mEntriesPerShard;
+    std::atomic<uint64_t> mHits;
+    std::atomic<uint64_t> mMisses;
+
+    static uint64_t mix(uint64_t pHash, uint64_t pValue) {
+        pHash ^= pValue + 0x9e3779b97f4a7c15ULL + (pHash << 6) + (pHash >> 2);
+        pHash ^= pHash >> 33;
+        pHash *= 0xff51afd7ed558ccdULL;
+        pHash ^= pHash >> 33;
+        return pHash;
+    };
+    shard& getShard(uint64_t pFingerprint) {
+        return mShards[pFingerprint % QUERY_CACHE_NUMBER_OF_SHARDS];
+    };
+    static bool isSameQuery(const entry& pEntry, SparseMatrixFloat* pRawData, size_t pInstance,
+                            const queryParameters& pParameters) {
+        if (pEntry.parameters.nNeighbors != pParameters.nNeighbors || pEntry.parameters.fast != pParameters.fast
+                || pEntry.parameters.similarity != pParameters.similarity || pEntry.parameters.radius != pParameters.radius
+                || pEntry.features.size() != pRawData->getSizeOfInstance(pInstance)) {
+            return false;
+        }
+        for (size_t i = 0; i < pEntry.features.size(); ++i) {
+            if (pEntry.features[i] != pRawData->getNextElement(pInstance, i)
+                    || pEntry.values[i] != pRawData->getNextValue(pInstance, i)) {
+                return false;
+            }
+        }
+        return true;
+    };
+  public:
+    // pNumberOfEntries is the number of query results the cache holds at most
+    QueryCache(size_t pNumberOfEntries) {
+        mEntriesPerShard = std::max((pNumberOfEntries + QUERY_CACHE_NUMBER_OF_SHARDS - 1) / QUERY_CACHE_NUMBER_OF_SHARDS,
+                                    static_cast<size_t>(1));
+        mHits.store(0, std::memory_order_relaxed);
+        mMisses.store(0, std::memory_order_relaxed);
+    };
+    uint64_t getFingerprint(SparseMatrixFloat* pRawData, size_t pInstance, const queryParameters& pParameters) const {
+        uint32_t radiusBits;
+        memcpy(&radiusBits, &pParameters.radius, sizeof(radiusBits));
+        uint64_t fingerprint = mix(mix(mix(mix(0, pParameters.nNeighbors), pParameters.fast), pParameters.similarity), radiusBits);
+        for (size_t i = 0; i < pRawData->getSizeOfInstance(pInstance); ++i) {
+            const float value = pRawData->getNextValue(pInstance, i);
+            uint32_t valueBits;
+            memcpy(&valueBits, &value, sizeof(valueBits));
+            fingerprint = mix(fingerprint, (static_cast<uint64_t>(pRawData->getNextElement(pInstance, i)) << 32) | valueBits);
+        }
+        return fingerprint;
+    };
+    // writes the cached result of instance pInstance of pRawData to row pRow of pNeighbors and returns
+    // true, returns false if the result is not cached
+    bool find(uint64_t pFingerprint, SparseMatrixFloat* pRawData, size_t pInstance, const queryParameters& pParameters,
+              NeighborhoodBuilder& pNeighbors, size_t pThread, size_t pRow) {
+        shard& part = getShard(pFingerprint);
+        std::lock_guard<std::mutex> guard(part.lock);
+        std::unordered_map<uint64_t, size_t>::const_iterator position = part.positions.find(pFingerprint);
+        if (position == part.positions.end() || !isSameQuery(part.entries[position->second], pRawData, pInstance, pParameters)) {
+            mMisses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        entry& cached = part.entries[position->second];
+        cached.referenced = true;
+        pNeighbors.setRow(pThread, pRow, cached.neighbors, cached.distances);
+        mHits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    };
+    void insert(uint64_t pFingerprint, SparseMatrixFloat* pRawData, size_t pInstance, const queryParameters& pParameters,
+                const size_t* pNeighbors, const float* pDistances, size_t pSize) {
+        shard& part = getShard(pFingerprint);
+        std::lock_guard<std::mutex> guard(part.lock);
+        size_t slot;
+        std::unordered_map<uint64_t, size_t>::const_iterator position = part.positions.find(pFingerprint);
+        if (position != part.positions.end()) {
+            // the same query again or another one with the same fingerprint, the newer result is kept
+            slot = position->second;
+        } else if (part.entries.size() < mEntriesPerShard) {
+            slot = part.entries.size();
+            part.entries.push_back(entry());
+        } else {
+            while (part.entries[part.hand].referenced) {
+                part.entries[part.hand].referenced = false;
+                part.hand = (part.hand + 1) % part.entries.size();
+            }
+            slot = part.hand;
+            part.hand = (part.hand + 1) % part.entries.size();
+            part.positions.erase(part.entries[slot].fingerprint);
+        }
+        part.positions[pFingerprint] = slot;
+        entry& cached = part.entries[slot];
+        cached.fingerprint = pFingerprint;
+        cached.parameters = pParameters;
+        const size_t sizeOfInstance = pRawData->getSizeOfInstance(pInstance);
+        cached.features.resize(sizeOfInstance);
+        cached.values.resize(sizeOfInstance);
+        for (size_t i = 0; i < sizeOfInstance; ++i) {
+            cached.features[i] = pRawData->getNextElement(pInstance, i);
+            cached.values[i] = pRawData->getNextValue(pInstance, i);
+        }
+        cached.neighbors.assign(pNeighbors, pNeighbors + pSize);
+        cached.distances.assign(pDistances, pDistances + pSize);
+        cached.referenced = false;
+    };
+    // removes all results, every change of the index makes them invalid
+    void clear() {
+        for (size_t i = 0; i < QUERY_CACHE_NUMBER_OF_SHARDS; ++i) {
+            std::lock_guard<std::mutex> guard(mShards[i].lock);
+            mShards[i].positions.clear();
+            mShards[i].entries.clear();
+            mShards[i].hand = 0;
+        }
+    };
+    queryCacheStatistics getStatistics(bool pReset) {
+        queryCacheStatistics statistics;
+        if (pReset) {
+            statistics.numberOfHits = mHits.exchange(0, std::memory_order_relaxed);
+            statistics.numberOfMisses = mMisses.exchange(0, std::memory_order_relaxed);
+        } else {
+            statistics.numberOfHits = mHits.load(std::memory_order_relaxed);
+            statistics.numberOfMisses = mMisses.load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < QUERY_CACHE_NUMBER_OF_SHARDS; ++i) {
+            std::lock_guard<std::mutex> guard(mShards[i].lock);
+            statistics.numberOfEntries += mShards[i].entries.size();
+        }
+        return statistics;
+    };
+};
+#endif // QUERY_CACHE_H
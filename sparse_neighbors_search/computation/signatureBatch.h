@@ -0,0 +1,76 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutor: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include "typeDefinitionsBasic.h"
+
+#ifndef SIGNATURE_BATCH_H
+#define SIGNATURE_BATCH_H
+
+// the unique signatures of a query or of the fitted data in one contiguous array, the parallel
+// workers of a query take element i directly. the id of a signature, computed from the features
+// of its instances, gives the position of its element.
+class SignatureBatch {
+  private:
+    std::vector<uniqueElement> mElements;
+    vsize_t mSignatureIds;
+    umap_signaturePosition mPositions;
+  public:
+    SignatureBatch() { };
+    // the nodes of the id map are taken from pArena
+    explicit SignatureBatch(Arena* pArena) : mPositions(0, std::hash<size_t>(), std::equal_to<size_t>(),
+                                                        umap_signaturePosition::allocator_type(pArena)) { };
+    size_t size() const {
+        return mElements.size();
+    };
+    const uniqueElement& getElement(size_t pPosition) const {
+        return mElements[pPosition];
+    };
+    size_t getSignatureId(size_t pPosition) const {
+        return mSignatureIds[pPosition];
+    };
+    // NULL if no element has the signature id
+    uniqueElement* find(size_t pSignatureId) {
+        auto it = mPositions.find(pSignatureId);
+        if (it == mPositions.end()) return NULL;
+        return &mElements[it->second];
+    };
+    const uniqueElement* find(size_t pSignatureId) const {
+        auto it = mPositions.find(pSignatureId);
+        if (it == mPositions.end()) return NULL;
+        return &mElements[it->second];
+    };
+    // the signature id must not be in the batch yet
+    void add(size_t pSignatureId, uniqueElement&& pElement) {
+        mPositions.emplace(pSignatureId, mElements.size());
+        mSignatureIds.push_back(pSignatureId);
+        mElements.push_back(std::move(pElement));
+    };
+    // the last element takes the place of the erased one
+    void erase(size_t pSignatureId) {
+        auto it = mPositions.find(pSignatureId);
+        if (it == mPositions.end()) return;
+        const size_t position = it->second;
+        mPositions.erase(it);
+        if (position + 1 != mElements.size()) {
+            mElements[position] = std::move(mElements.back());
+            mSignatureIds[position] = mSignatureIds.back();
+            mPositions[mSignatureIds[position]] = position;
+        }
+        mElements.pop_back();
+        mSignatureIds.pop_back();
+    };
+    void reserve(size_t pNumberOfSignatures) {
+        mElements.reserve(pNumberOfSignatures);
+        mSignatureIds.reserve(pNumberOfSignatures);
+        mPositions.reserve(pNumberOfSignatures);
+    };
+};
+#endif // SIGNATURE_BATCH_H
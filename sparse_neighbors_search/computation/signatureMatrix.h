@@ -0,0 +1,53 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutor: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include "typeDefinitionsBasic.h"
+
+#ifndef SIGNATURE_MATRIX_H
+#define SIGNATURE_MATRIX_H
+
+// the signatures of all instances of one data set in one row-major block of memory.
+// every row has the same width; the hashing kernels write into the rows and
+// uniqueElement::signature points into them, so the matrix must outlive these views.
+class SignatureMatrix {
+
+  private:
+    hashValue_t* mSignatures = NULL;
+    size_t mNumberOfInstances;
+    size_t mWidth;
+    // false if the rows are a view into a mapped index file
+    bool mOwnsMemory = true;
+  public:
+    SignatureMatrix(size_t pNumberOfInstances, size_t pWidth) {
+        mSignatures = new hashValue_t [pNumberOfInstances * pWidth];
+        mNumberOfInstances = pNumberOfInstances;
+        mWidth = pWidth;
+    };
+    SignatureMatrix(const hashValue_t* pSignatures, size_t pNumberOfInstances, size_t pWidth) {
+        mSignatures = const_cast<hashValue_t*>(pSignatures);
+        mNumberOfInstances = pNumberOfInstances;
+        mWidth = pWidth;
+        mOwnsMemory = false;
+    };
+    ~SignatureMatrix() {
+        if (mOwnsMemory) delete [] mSignatures;
+    };
+    hashValue_t* getSignature(size_t pInstance) {
+        return &(mSignatures[pInstance * mWidth]);
+    };
+    size_t getWidth() const {
+        return mWidth;
+    };
+    size_t size() const {
+        return mNumberOfInstances;
+    };
+};
+#endif // SIGNATURE_MATRIX_H
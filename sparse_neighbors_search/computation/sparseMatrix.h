@@ -34,8 +34,13 @@ class SparseMatrixFloat {
     
     size_t mMaxNnz;
     size_t mNumberOfInstances;
+    // false if the arrays are views into a mapped index file
+    bool mOwnsMemory = true;
    
-    std::unordered_map<size_t, float> mDotProductPrecomputed;
+    // squared norms of the first mNumberOfDotProducts instances, in mDotProductPrecomputed or a mapped index file
+    vfloat mDotProductPrecomputed;
+    const float* mDotProducts = NULL;
+    size_t mNumberOfDotProducts = 0;
   public:
     SparseMatrixFloat(size_t pNumberOfInstances, size_t pMaxNnz) {
         
@@ -47,14 +52,27 @@ class SparseMatrixFloat {
         mMaxNnz = pMaxNnz;
         mNumberOfInstances = pNumberOfInstances;
     };
+    // view on the arrays of a mapped index file, the mapping must outlive the matrix
+    SparseMatrixFloat(const uint32_t* pSparseMatrix, const float* pSparseMatrixValues, const size_t* pSizesOfInstances,
+                        const float* pDotProducts, size_t pNumberOfInstances, size_t pMaxNnz) {
+        mSparseMatrix = const_cast<uint32_t*>(pSparseMatrix);
+        mSparseMatrixValues = const_cast<float*>(pSparseMatrixValues);
+        mSizesOfInstances = const_cast<size_t*>(pSizesOfInstances);
+        mDotProducts = pDotProducts;
+        mNumberOfDotProducts = pNumberOfInstances;
+        mMaxNnz = pMaxNnz;
+        mNumberOfInstances = pNumberOfInstances;
+        mOwnsMemory = false;
+    };
     ~SparseMatrixFloat() {
+        if (!mOwnsMemory) return;
         delete [] mSparseMatrix;
         delete [] mSparseMatrixValues;
         delete [] mSizesOfInstances;
     };
     
     void precomputeDotProduct() {
-        
+        mDotProductPrecomputed.resize(size());
         double value = 0.0;
         double value1 = 0.0;
         double value2 = 0.0;
@@ -79,6 +97,14 @@ class SparseMatrixFloat {
             value2 = 0.0;
             value3 = 0.0;
         }
+        mDotProducts = mDotProductPrecomputed.data();
+        mNumberOfDotProducts = size();
+    };
+    const float* getDotProducts() const {
+        return mDotProducts;
+    };
+    size_t getNumberOfDotProducts() const {
+        return mNumberOfDotProducts;
     };
     float dotProduct(const size_t pIndex, const size_t pIndexNeighbor, SparseMatrixFloat* pQueryData=NULL)  {
         SparseMatrixFloat* queryData = this;
@@ -107,15 +133,10 @@ class SparseMatrixFloat {
     };
     float getDotProductPrecomputed(size_t pIndex, SparseMatrixFloat* pQueryData=NULL) {
         // return 1;
-        auto it = mDotProductPrecomputed.find(pIndex);
-        if (it != mDotProductPrecomputed.end()) {
-            return it->second;
-        } else {
-            float value = dotProduct(pIndex, pIndex, pQueryData);
-            #pragma omp critical 
-            mDotProductPrecomputed[pIndex] = value;
+        if (pIndex < mNumberOfDotProducts) {
+            return mDotProducts[pIndex];
         }
-        return mDotProductPrecomputed[pIndex];
+        return dotProduct(pIndex, pIndex, pQueryData);
     }
     uint32_t* getSparseMatrixIndex() const{
         return mSparseMatrix;
@@ -179,7 +200,8 @@ class SparseMatrixFloat {
         size_t maxNnz = std::max(mMaxNnz, pMatrix->getMaxNnz());
         
         uint32_t* tmp_mSparseMatrix = new uint32_t [numberOfInstances * maxNnz];
-        float* tmp_mSparseMatrixValues = new float [numberOfInstances * maxNnz];
+        std::fill_n(tmp_mSparseMatrix, numberOfInstances * maxNnz, MAX_VALUE);
+        float* tmp_mSparseMatrixValues = new float [numberOfInstances * maxNnz]();
         size_t* tmp_mSizesOfInstances = new size_t [numberOfInstances];
         
         for (size_t i = 0; i < this->getNumberOfInstances(); ++i) {
@@ -198,13 +220,63 @@ class SparseMatrixFloat {
         }
         mMaxNnz = maxNnz;
         mNumberOfInstances = numberOfInstances;
-        delete [] mSparseMatrix;
-        delete [] mSparseMatrixValues;
-        delete [] mSizesOfInstances;
+        if (mOwnsMemory) {
+            delete [] mSparseMatrix;
+            delete [] mSparseMatrixValues;
+            delete [] mSizesOfInstances;
+        }
         delete pMatrix;
         mSparseMatrix = tmp_mSparseMatrix;
         mSparseMatrixValues = tmp_mSparseMatrixValues;
         mSizesOfInstances = tmp_mSizesOfInstances;        
+        mOwnsMemory = true;
+        if (mNumberOfDotProducts != 0) {
+            precomputeDotProduct();
+        }
+    };
+    // overwrite the rows pInstances with the rows of pMatrix. the arrays are copied first if they are a view
+    // into a mapped index file or if the rows of pMatrix are longer.
+    void replaceInstances(const vsize_t& pInstances, const SparseMatrixFloat* pMatrix) {
+        if (!mOwnsMemory || pMatrix->getMaxNnz() > mMaxNnz) {
+            size_t maxNnz = std::max(mMaxNnz, pMatrix->getMaxNnz());
+            uint32_t* tmp_mSparseMatrix = new uint32_t [mNumberOfInstances * maxNnz];
+            std::fill_n(tmp_mSparseMatrix, mNumberOfInstances * maxNnz, MAX_VALUE);
+            float* tmp_mSparseMatrixValues = new float [mNumberOfInstances * maxNnz]();
+            size_t* tmp_mSizesOfInstances = new size_t [mNumberOfInstances];
+            for (size_t i = 0; i < mNumberOfInstances; ++i) {
+                std::copy(mSparseMatrix + i * mMaxNnz, mSparseMatrix + i * mMaxNnz + getSizeOfInstance(i), tmp_mSparseMatrix + i * maxNnz);
+                std::copy(mSparseMatrixValues + i * mMaxNnz, mSparseMatrixValues + i * mMaxNnz + getSizeOfInstance(i), tmp_mSparseMatrixValues + i * maxNnz);
+                tmp_mSizesOfInstances[i] = getSizeOfInstance(i);
+            }
+            if (mOwnsMemory) {
+                delete [] mSparseMatrix;
+                delete [] mSparseMatrixValues;
+                delete [] mSizesOfInstances;
+            }
+            mSparseMatrix = tmp_mSparseMatrix;
+            mSparseMatrixValues = tmp_mSparseMatrixValues;
+            mSizesOfInstances = tmp_mSizesOfInstances;
+            mMaxNnz = maxNnz;
+            mOwnsMemory = true;
+        }
+        if (mNumberOfDotProducts != 0 && mDotProducts != mDotProductPrecomputed.data()) {
+            mDotProductPrecomputed.assign(mDotProducts, mDotProducts + mNumberOfDotProducts);
+            mDotProducts = mDotProductPrecomputed.data();
+        }
+        for (size_t i = 0; i < pInstances.size(); ++i) {
+            const size_t instance = pInstances[i];
+            if (instance >= mNumberOfInstances) continue;
+            std::fill_n(mSparseMatrix + instance * mMaxNnz, mMaxNnz, MAX_VALUE);
+            std::fill_n(mSparseMatrixValues + instance * mMaxNnz, mMaxNnz, 0);
+            for (size_t j = 0; j < pMatrix->getSizeOfInstance(i); ++j) {
+                mSparseMatrix[instance * mMaxNnz + j] = pMatrix->getNextElement(i, j);
+                mSparseMatrixValues[instance * mMaxNnz + j] = pMatrix->getNextValue(i, j);
+            }
+            mSizesOfInstances[instance] = pMatrix->getSizeOfInstance(i);
+            if (instance < mNumberOfDotProducts) {
+                mDotProductPrecomputed[instance] = dotProduct(instance, instance);
+            }
+        }
     };
     std::vector<sortMapFloat> euclidianDistance(const std::vector<size_t> pRowIdVector, const size_t pNneighbors, 
                                                 const size_t pQueryId, SparseMatrixFloat* pQueryData=NULL) {
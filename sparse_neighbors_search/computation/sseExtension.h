@@ -21,22 +21,30 @@ static inline __m128i _mm_argmin_change_epi32 (const __m128i &pArgmin, const __m
     return _mm_or_si128(_mm_and_si128(compareResult, pArgminValue), _mm_andnot_si128(compareResult, pArgmin));
 }
 
+// same as _mm_argmin_change_epi32 but only lanes set in pMask can change; used for the tail of an instance
+static inline __m128i _mm_argmin_change_masked_epi32 (const __m128i &pArgmin, const __m128i &pMinimumVector, const __m128i &pHashValue,
+                                                        const __m128i &pArgminValue, const __m128i &pMask) {
+    __m128i compareResult = _mm_and_si128(_mm_cmpeq_epi32(pMinimumVector, pHashValue), pMask);
+    return _mm_or_si128(_mm_and_si128(compareResult, pArgminValue), _mm_andnot_si128(compareResult, pArgmin));
+}
+
 
 // inspired by https://stackoverflow.com/questions/9877700/getting-max-value-in-a-m128i-vector-with-sse/9878321#9878321
+// hash values are compared unsigned; if several lanes hold the minimum the largest argmin wins
 static inline uint32_t _mm_get_argmin(const __m128i &pArgmin, const __m128i &pMinHashValues) {
 
     __m128i max1 = _mm_shuffle_epi32(pMinHashValues, _MM_SHUFFLE(0,0,3,2));
-    __m128i max2 = _mm_min_epi32(pMinHashValues,max1);
+    __m128i max2 = _mm_min_epu32(pMinHashValues,max1);
     __m128i max3 = _mm_shuffle_epi32(max2, _MM_SHUFFLE(0,0,0,1));
-    __m128i max4 = _mm_min_epi32(max2,max3);
+    __m128i max4 = _mm_min_epu32(max2,max3);
     int minValue = _mm_cvtsi128_si32(max4);
     // std::cout << minValue << std::endl;
      __m128i compare = _mm_setr_epi32(minValue, minValue, minValue, minValue);
      __m128i argmin = _mm_and_si128(pArgmin, _mm_cmpeq_epi32(pMinHashValues, compare));
     max1 = _mm_shuffle_epi32(argmin, _MM_SHUFFLE(0,0,3,2));
-    max2 = _mm_max_epi32(argmin,max1);
+    max2 = _mm_max_epu32(argmin,max1);
     max3 = _mm_shuffle_epi32(max2, _MM_SHUFFLE(0,0,0,1));
-    max4 = _mm_max_epi32(max2,max3); 
+    max4 = _mm_max_epu32(max2,max3); 
     return (uint32_t) _mm_cvtsi128_si32(max4);
 }
 #endif // SSE_EXTENSION 
\ No newline at end of file
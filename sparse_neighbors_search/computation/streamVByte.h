@@ -0,0 +1,98 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <smmintrin.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef STREAM_V_BYTE_H
+#define STREAM_V_BYTE_H
+// delta coded stream vbyte (Lemire, Kurz, Rupp 2017) for lists of instance ids.
+// a list of n values is stored as ceil(n/4) control bytes followed by the data bytes, every control byte
+// holds the byte lengths - 1 of four consecutive deltas. deltas are computed modulo 2^32, so lists need not
+// be sorted but sorted lists need the fewest bytes.
+// the decoder loads 16 bytes for every four values, the memory after a list must be readable for 16 bytes.
+
+// shuffle masks and data lengths for all 256 control bytes
+struct streamVByteTables {
+    __m128i shuffle[256];
+    uint8_t length[256];
+    streamVByteTables() {
+        for (size_t control = 0; control < 256; ++control) {
+            int8_t mask[16];
+            size_t offset = 0;
+            for (size_t i = 0; i < 4; ++i) {
+                const size_t size = ((control >> (2 * i)) & 3) + 1;
+                for (size_t j = 0; j < 4; ++j) {
+                    mask[4 * i + j] = j < size ? offset + j : -1;
+                }
+                offset += size;
+            }
+            shuffle[control] = _mm_loadu_si128((const __m128i*) mask);
+            length[control] = offset;
+        }
+    };
+};
+static inline const streamVByteTables& getStreamVByteTables() {
+    static const streamVByteTables tables;
+    return tables;
+}
+
+// the largest number of bytes streamVByteEncode writes for pSize values
+static inline size_t streamVByteMaxSize(const size_t pSize) {
+    return (pSize + 3) / 4 + 4 * pSize;
+}
+
+// returns the number of written bytes
+static inline size_t streamVByteEncode(const uint32_t* pValues, const size_t pSize, uint8_t* pOut) {
+    uint8_t* control = pOut;
+    uint8_t* data = pOut + (pSize + 3) / 4;
+    memset(control, 0, (pSize + 3) / 4);
+    uint32_t previous = 0;
+    for (size_t i = 0; i < pSize; ++i) {
+        const uint32_t delta = pValues[i] - previous;
+        previous = pValues[i];
+        const size_t code = delta < (1U << 8) ? 0 : delta < (1U << 16) ? 1 : delta < (1U << 24) ? 2 : 3;
+        control[i / 4] |= code << (2 * (i % 4));
+        memcpy(data, &delta, code + 1);
+        data += code + 1;
+    }
+    return data - pOut;
+}
+
+static inline void streamVByteDecode(const uint8_t* pIn, const size_t pSize, uint32_t* pValues) {
+    const streamVByteTables& tables = getStreamVByteTables();
+    const uint8_t* control = pIn;
+    const uint8_t* data = pIn + (pSize + 3) / 4;
+    __m128i previous = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= pSize; i += 4) {
+        const uint8_t code = control[i / 4];
+        __m128i deltas = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) data), tables.shuffle[code]);
+        data += tables.length[code];
+        // prefix sum of the four deltas plus the last value of the previous group
+        deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+        deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+        previous = _mm_add_epi32(deltas, _mm_shuffle_epi32(previous, _MM_SHUFFLE(3, 3, 3, 3)));
+        _mm_storeu_si128((__m128i*) (pValues + i), previous);
+    }
+    uint32_t value = i ? pValues[i - 1] : 0;
+    for (; i < pSize; ++i) {
+        const size_t size = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        uint32_t delta = 0;
+        memcpy(&delta, data, size);
+        data += size;
+        value += delta;
+        pValues[i] = value;
+    }
+}
+#endif // STREAM_V_BYTE_H
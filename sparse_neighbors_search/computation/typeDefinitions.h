@@ -15,6 +15,7 @@
 
 #include "typeDefinitionsBasic.h"
 #include "sparseMatrix.h"
+#include "neighborhood.h"
 
 struct rawData {
   SparseMatrixFloat* matrixData;
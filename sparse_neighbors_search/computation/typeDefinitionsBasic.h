@@ -12,15 +12,29 @@
 #ifndef TYPE_DEFINTIONS_BASIC_H
 #define TYPE_DEFINTIONS_BASIC_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <vector>
 #include <map> 
 #include <unordered_map>
 #include <utility>
 #include <limits>
+#include "arena.h"
 // #include <google/dense_hash_map>
 #define MAX_VALUE 2147483647 //std::numeric_limits<int>::max()
 
+// all hash functions produce 32 bit values. instance ids are 32 bit as well,
+// compile with LARGE_INDEX for indexes with more than 2^32 instances.
+typedef uint32_t hashValue_t;
+#ifdef LARGE_INDEX
+typedef uint64_t instanceId_t;
+#else
+typedef uint32_t instanceId_t;
+#endif
+
 typedef std::vector< size_t > vsize_t;
+typedef std::vector< hashValue_t > vhashValue_t;
+typedef std::vector< instanceId_t > vinstanceId_t;
 typedef std::vector< int > vint;
 typedef std::vector< float > vfloat;
 
@@ -31,24 +45,33 @@ typedef std::vector< vint > vvint;
 typedef std::vector< vfloat > vvfloat;
 
 typedef std::unordered_map< size_t, vsize_t > umapVector;
-typedef std::unordered_map< size_t, vsize_t* > umapVector_ptr;
+// instance ids in the memory of an arena, or of the heap if the allocator has none
+typedef std::vector< instanceId_t, ArenaAllocator<instanceId_t> > vinstanceIdArena_t;
+typedef std::unordered_map< hashValue_t, vinstanceIdArena_t, std::hash<hashValue_t>, std::equal_to<hashValue_t>,
+                            ArenaAllocator< std::pair<const hashValue_t, vinstanceIdArena_t> > > umapVector_arena;
 
 typedef std::vector< std::map< size_t, size_t > > vmSize_tSize_t;
 typedef std::vector< umapVector > vector__umapVector;
-typedef std::vector< umapVector_ptr* > vector__umapVector_ptr;
+typedef std::vector< umapVector_arena* > vector__umapVector_arena;
 
 
 struct uniqueElement {
-  vsize_t* instances;
-  vsize_t* signature;
+  vinstanceIdArena_t instances;
+  // view into a row of a SignatureMatrix, the matrix owns the memory
+  hashValue_t* signature;
 };
 
-struct neighborhood {
-  vvsize_t* neighbors;
-  vvfloat* distances;
+// the instance ids an inverse index stores for one hash value. a size of 0 marks
+// a hash value that had too many collisions or was not found.
+struct postingList {
+  const instanceId_t* instances;
+  size_t size;
+  // stream vbyte coded ids, set instead of instances if the storage compresses its lists
+  const uint8_t* compressed;
 };
 
-typedef std::unordered_map< size_t, uniqueElement > umap_uniqueElement;
+typedef std::unordered_map< size_t, size_t, std::hash<size_t>, std::equal_to<size_t>,
+                            ArenaAllocator< std::pair<const size_t, size_t> > > umap_signaturePosition;
 
 
 struct sortMapFloat {
@@ -69,6 +92,35 @@ struct distributionInverseIndex {
     
     size_t mean;
     size_t standardDeviation;
+    // probability that a lookup of a hash value that is not stored returns a posting list, 0 for exact storages
+    float falsePositiveRate = 0;
+    // hash values with too many collisions, their posting lists are empty
+    size_t numberOfOverflowedHashValues = 0;
+    // sizeOfPostingListAtQuantile[i] is the size of the non-empty posting lists at quantiles[i]
+    vfloat quantiles;
+    vsize_t sizeOfPostingListAtQuantile;
+};
+// counters of the candidate filter between the collision counting and the ranking of the candidates,
+// summed over all queries. a query is a unique signature, instances with equal features are one query.
+struct candidateFilterStatistics {
+    size_t numberOfQueries = 0;
+    // instances with at least one collision, of them the ones with exactly one
+    size_t numberOfCandidates = 0;
+    size_t numberOfSingleCollisionCandidates = 0;
+    // candidates removed by minimal_blocks_in_common, by collision_cutoff and by the limit of
+    // n_neighbors * excess_factor or max_candidates
+    size_t numberOfRemovedByMinimalBlocksInCommon = 0;
+    size_t numberOfRemovedByCollisionCutoff = 0;
+    size_t numberOfRemovedByLimit = 0;
+    // candidates that are returned or ranked by their exact distance
+    size_t numberOfPassedCandidates = 0;
+};
+// counters of the query result cache
+struct queryCacheStatistics {
+    size_t numberOfHits = 0;
+    size_t numberOfMisses = 0;
+    // number of cached query results
+    size_t numberOfEntries = 0;
 };
 // struct sparseData {
 //     uint32_t instance;
@@ -0,0 +1,57 @@
+/**
+ Copyright 2016 Joachim Wolff
+ Master Thesis
+ Tutors: Fabrizio Costa, Milad Miladi
+ Winter semester 2015/2016
+
+ Chair of Bioinformatics
+ Department of Computer Science
+ Faculty of Engineering
+ Albert-Ludwigs-University Freiburg im Breisgau
+**/
+#include <algorithm>
+#include <math.h>
+#include "typeDefinitionsBasic.h"
+
+#ifndef WORK_SCHEDULE_H
+#define WORK_SCHEDULE_H
+
+// the items of a parallel loop whose costs differ a lot are processed by decreasing estimated cost with
+// dynamic scheduling: the expensive items start first and the threads that are done early take the
+// cheap ones at the end, no thread is left with a long item while the others idle.
+
+class sortByCostDesc {
+  private:
+    const vsize_t& mCosts;
+  public:
+    sortByCostDesc(const vsize_t& pCosts) : mCosts(pCosts) { };
+    bool operator()(size_t pFirst, size_t pSecond) const {
+        return mCosts[pFirst] > mCosts[pSecond];
+    };
+};
+
+// the items 0 .. pCosts.size() - 1 by decreasing cost, equal costs in item order
+inline vsize_t sortByDecreasingCost(const vsize_t& pCosts) {
+    vsize_t order(pCosts.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), sortByCostDesc(pCosts));
+    return order;
+}
+
+// number of items a thread takes at once from a dynamically scheduled loop. the chunk_size parameter
+// if it is set, otherwise small enough that every thread takes several chunks.
+inline size_t getDynamicChunkSize(size_t pChunkSize, size_t pNumberOfItems, size_t pNumberOfThreads) {
+    if (pChunkSize > 0) return pChunkSize;
+    return std::max(pNumberOfItems / (std::max(pNumberOfThreads, static_cast<size_t>(1)) * 16), static_cast<size_t>(1));
+}
+
+// number of items of every thread in a statically scheduled loop. the chunk_size parameter if it is set,
+// otherwise the items are split evenly.
+inline size_t getStaticChunkSize(size_t pChunkSize, size_t pNumberOfItems, size_t pNumberOfThreads) {
+    if (pChunkSize > 0) return pChunkSize;
+    return std::max(static_cast<size_t>(ceil(pNumberOfItems / static_cast<float>(std::max(pNumberOfThreads, static_cast<size_t>(1))))),
+                    static_cast<size_t>(1));
+}
+#endif // WORK_SCHEDULE_H
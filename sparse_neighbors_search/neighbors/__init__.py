@@ -13,4 +13,5 @@ __author__ = 'joachimwolff'
 from minHash import MinHash
 from minHashClassifier import MinHashClassifier
 from wtaHash import WtaHash
-from wtaHashClassifier import WtaHashClassifier
\ No newline at end of file
+from wtaHashClassifier import WtaHashClassifier
+from shardedNearestNeighbors import ShardedNearestNeighbors
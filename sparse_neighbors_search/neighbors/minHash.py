@@ -70,6 +70,55 @@ class MinHash():
         gpu_hashing : int, optional (default = 1)
             If the hashing of MinHash should be computed on the GPU (1) but the prediction is computed on the CPU.
             If 0 it is deactivated.
+        one_permutation_hashing : {True, False}, optional (default = False)
+            If true, every feature is hashed only once into number_of_hash_functions * block_size bins and empty
+            bins are densified afterwards. The signature is computed in O(nnz + number_of_hash_functions * block_size)
+            instead of O(nnz * number_of_hash_functions * block_size). GPU hashing is not supported in this mode.
+        bits_per_hash_value : int, optional (default = 0)
+            b-bit MinHash: keep only the lowest 1, 2, 4, 8 or 16 bits of every (shingled) hash value and store the
+            signatures bit-packed. The similarity is corrected for the random collisions of b-bit values.
+            Small values need a larger max_bin_size. If 0 the full hash values are used.
+        inverse_index_storage : int, optional (default = 0)
+            Data structure of the inverse index. 0 uses one std::unordered_map per hash function,
+            1 uses open addressing hash tables that store short lists of instance ids inline. 1 answers
+            queries faster and needs less memory. 2 collects the hash values during fitting and builds a
+            compact read-only index with sorted hash values at the end of every fit; fitting is faster and
+            the index is the smallest. 3 is 2 with delta coded and compressed lists of instance ids, the lists
+            need less memory and are decoded while querying. 3 is the same as 2
+            if the module is built with --largeindex. 4 builds a bloomier filter at the end of the first fit
+            that finds the lists without storing the hash values and needs the least memory per hash value. A hash
+            value that was not inserted gets a wrong list with probability 1/256. The index can not be extended
+            by partial_fit.
+        compaction_threshold : float, optional (default = 0.1)
+            Removed instances are skipped by the queries until they are compacted out of the inverse index.
+            The compaction builds a new inverse index in the background as soon as this fraction of the fitted
+            instances is removed but not compacted, the queries use the old one until it is done. It needs
+            memory for both. If -1 the inverse index is never compacted.
+        numa_replication : {True, False}, optional (default = False)
+            Only for inverse_index_storage 2 and 3 on machines with more than one NUMA node. Every node gets its
+            own copy of the inverse index after each fit and load, the query threads are bound to the nodes and
+            read the copy in local memory. The inverse index needs one copy per node.
+        candidate_budget : int, optional (default = 0)
+            Maximal number of candidates a query collects from the inverse index. The hash functions are visited
+            by increasing size of the query's lists and the rest is skipped as soon as the budget is reached. The
+            fast distance of a query that skipped lists is based on the visited lists only: the share of them
+            without a collision. 0 visits every hash function.
+        multi_probe : {True, False}, optional (default = False)
+            A query with less than n_neighbors * excess_factor candidates probes the lists of its best candidate
+            in addition. The instances found only there have no collision with the query, they are ranked after
+            all other candidates by their number of hits and get the distance 1 in the fast version.
+            The index keeps a pointer to the signature of every instance for it.
+        max_candidates : int, optional (default = 0)
+            Maximal number of candidates of a query that are returned by the fast version or ranked by the exact
+            one, in addition to the limit of n_neighbors * excess_factor. 0 sets no further limit.
+        collision_cutoff : float, optional (default = 0.0)
+            A candidate with less than collision_cutoff times the hash collisions of the best candidate of the query
+            is dropped before the ranking. 0 keeps all candidates with minimal_blocks_in_common collisions.
+        query_cache_size : int, optional (default = 0)
+            Number of query results that are kept. A query with the same features, values and parameters as a
+            cached one gets the cached neighbors without hashing and ranking. The cache is emptied by every
+            change of the index. Only fast queries are cached, the neighbors of an exact query depend on
+            the other instances of the query. 0 switches the cache off.
         speed_optimized : {True, False}, optional (default = None)
             A parameter setting that is optimized for the best speed. Can not be used together with the parameter 'accuracy_optimized'.
             If bad results are computed, try 'accuracy_optimized' or optimize the parameters with a hyperparameter optimization.
@@ -103,7 +152,7 @@ class MinHash():
                  similarity=False, number_of_cores=None, chunk_size=None, prune_inverse_index=-1,
                  prune_inverse_index_after_instance=-1.0, remove_hash_function_with_less_entries_as=-1, 
                  block_size = 5, shingle=0, store_value_with_least_sigificant_bit=0, 
-                 gpu_hashing=0, speed_optimized=None, accuracy_optimized=None): #cpu_gpu_load_balancing=0,
+                 gpu_hashing=0, one_permutation_hashing=False, bits_per_hash_value=0, inverse_index_storage=0, compaction_threshold=0.1, numa_replication=False, candidate_budget=0, multi_probe=False, max_candidates=0, collision_cutoff=0.0, query_cache_size=0, speed_optimized=None, accuracy_optimized=None): #cpu_gpu_load_balancing=0,
         if speed_optimized is not None and accuracy_optimized is not None:
             print("Speed optimization and accuracy optimization at the same time is not possible.")
             return
@@ -139,9 +188,13 @@ class MinHash():
                 similarity=similarity, number_of_cores=number_of_cores, chunk_size=chunk_size, prune_inverse_index=prune_inverse_index,
                 prune_inverse_index_after_instance=prune_inverse_index_after_instance,
                 remove_hash_function_with_less_entries_as=remove_hash_function_with_less_entries_as, 
-                hash_algorithm=0, block_size=block_size, shingle=shingle,
+                hash_algorithm=2 if one_permutation_hashing else 0, block_size=block_size, shingle=shingle,
                 store_value_with_least_sigificant_bit=store_value_with_least_sigificant_bit, 
-                cpu_gpu_load_balancing=0, gpu_hashing=gpu_hashing)
+                cpu_gpu_load_balancing=0, gpu_hashing=gpu_hashing, bits_per_hash_value=bits_per_hash_value,
+                inverse_index_storage=inverse_index_storage, compaction_threshold=compaction_threshold,
+                numa_replication=numa_replication, candidate_budget=candidate_budget, multi_probe=multi_probe,
+                max_candidates=max_candidates, collision_cutoff=collision_cutoff,
+                query_cache_size=query_cache_size)
 
     def __del__(self):
        del self._nearestNeighborsCppInterface
@@ -174,6 +227,29 @@ class MinHash():
         self._nearestNeighborsCppInterface.partial_fit(X=X, y=y)
        
         
+    def remove(self, instance_ids):
+        """Removes instances from the index. The removed instances are never returned as neighbors
+            and get no neighbors if kneighbors is called without X. The ids of the other instances do not change.
+
+            Parameters
+            ----------
+            instance_ids : list of int
+                Ids of the instances, in the order they were fitted."""
+        self._nearestNeighborsCppInterface.remove(instance_ids)
+
+    def update(self, instance_ids, X):
+        """Replaces instances of the index by new data, the instances keep their ids. A removed instance is added again.
+
+            Parameters
+            ----------
+            instance_ids : int or list of int
+                Ids of the instances, every id only once.
+            X : {array-like, sparse matrix}
+                The new data of the instances. Shape = [len(instance_ids), n_features]"""
+        if isinstance(instance_ids, (int, long)):
+            instance_ids = [instance_ids]
+        self._nearestNeighborsCppInterface.update(instance_ids, X)
+
     def kneighbors(self,X=None, n_neighbors=None, return_distance=True, fast=None, similarity=None):
         """Finds the n_neighbors of a point X or of all points of X.
 
@@ -496,8 +572,46 @@ class MinHash():
     def get_distribution_of_inverse_index(self):
         """Returns the number of created hash values per hash function, 
             the average size of elements per hash value per hash function,
-            the mean and the standard deviation."""
+            the mean, the standard deviation and the false positive rate of the lookups,
+            the number of hash values with too many collisions and a dict with the size of the
+            posting lists at the quantiles 0.5, 0.9, 0.99 and 1.
+            The values are read from counters the index keeps up to date and do not block queries."""
         return self._nearestNeighborsCppInterface.get_distribution_of_inverse_index()
+
+    def get_candidate_filter_statistics(self, reset=False):
+        """Returns the counters of the candidate filter as a dict: the number of queries, of their candidates
+            and of the candidates with a single collision, the number of candidates removed by
+            minimal_blocks_in_common, by collision_cutoff and by the limit of n_neighbors * excess_factor or
+            max_candidates and the number of candidates that passed the filter. A query is a unique signature.
+            The counters sum up all queries since the object was created or the last call with reset=True."""
+        return self._nearestNeighborsCppInterface.get_candidate_filter_statistics(reset)
+
+    def get_query_cache_statistics(self, reset=False):
+        """Returns the number of hits and misses of the query cache and the number of cached results as a dict.
+            A query of n instances counts n hits or misses. With reset=True the hits and misses are set to zero."""
+        return self._nearestNeighborsCppInterface.get_query_cache_statistics(reset)
+
+    def save(self, path):
+        """Writes the fitted index, the original data and the parameters to the file path.
+            Saving needs inverse_index_storage 2 or 3.
+
+            Parameters
+            ----------
+            path : string
+                Path of the index file."""
+        self._nearestNeighborsCppInterface.save(path)
+
+    def load(self, path, populate=False):
+        """Replaces the index and all parameters by the ones stored in the file path. The file is memory mapped
+            and used in place without a copy, processes loading the same file share its memory.
+
+            Parameters
+            ----------
+            path : string
+                Path of the index file written by save.
+            populate : {True, False}, optional (default = False)
+                If True the whole file is read into memory while loading, otherwise every page is read on its first access."""
+        self._nearestNeighborsCppInterface.load(path, populate)
     
     def _getY(self):
         return self._nearestNeighborsCppInterface._getY()
@@ -67,7 +67,8 @@ class _NearestNeighborsCppInterface():
         prune_inverse_index_after_instance: float, optional (default = -1.0)
             Start all the pruning routines after x% of the data during the fitting process.
         hash_algorithm: int, optional (default = 0)
-            Which hash function should be used. 0 for MinHash and 1 for WTA-Hash.
+            Which hash function should be used. 0 for MinHash, 1 for WTA-Hash and 2 for one permutation hashing
+            with densification.
         remove_hash_function_with_less_entries_as: int, optional (default =-1)
             Remove every hash function with less hash values as n.
         block_size : int, optional (default = 5)
@@ -79,6 +80,51 @@ class _NearestNeighborsCppInterface():
         gpu_hashing : int, optional (default = 1)
             If the hashing of MinHash should be computed on the GPU (1) but the prediction is computed on the CPU.
             If 0 it is deactivated.
+        bits_per_hash_value : int, optional (default = 0)
+            b-bit MinHash: keep only the lowest 1, 2, 4, 8 or 16 bits of every (shingled) hash value and store the
+            signatures bit-packed. The similarity is corrected for the random collisions of b-bit values.
+            Small values need a larger max_bin_size. If 0 the full hash values are used.
+        inverse_index_storage : int, optional (default = 0)
+            Data structure of the inverse index. 0 uses one std::unordered_map per hash function,
+            1 uses open addressing hash tables that store short lists of instance ids inline. 1 answers
+            queries faster and needs less memory. 2 collects the hash values during fitting and builds a
+            compact read-only index with sorted hash values at the end of every fit; fitting is faster and
+            the index is the smallest. 3 is 2 with delta coded and compressed lists of instance ids, the lists
+            need less memory and are decoded while querying. 3 is the same as 2
+            if the module is built with --largeindex. 4 builds a bloomier filter at the end of the first fit
+            that finds the lists without storing the hash values and needs the least memory per hash value. A hash
+            value that was not inserted gets a wrong list with probability 1/256. The index can not be extended
+            by partial_fit.
+        compaction_threshold : float, optional (default = 0.1)
+            Removed instances are skipped by the queries until they are compacted out of the inverse index.
+            The compaction builds a new inverse index in the background as soon as this fraction of the fitted
+            instances is removed but not compacted, the queries use the old one until it is done. It needs
+            memory for both. If -1 the inverse index is never compacted.
+        numa_replication : {True, False}, optional (default = False)
+            Only for inverse_index_storage 2 and 3 on machines with more than one NUMA node. Every node gets its
+            own copy of the inverse index after each fit and load, the query threads are bound to the nodes and
+            read the copy in local memory. The inverse index needs one copy per node.
+        candidate_budget : int, optional (default = 0)
+            Maximal number of candidates a query collects from the inverse index. The hash functions are visited
+            by increasing size of the query's lists and the rest is skipped as soon as the budget is reached. The
+            fast distance of a query that skipped lists is based on the visited lists only: the share of them
+            without a collision. 0 visits every hash function.
+        multi_probe : {True, False}, optional (default = False)
+            A query with less than n_neighbors * excess_factor candidates probes the lists of its best candidate
+            in addition. The instances found only there have no collision with the query, they are ranked after
+            all other candidates by their number of hits and get the distance 1 in the fast version.
+            The index keeps a pointer to the signature of every instance for it.
+        max_candidates : int, optional (default = 0)
+            Maximal number of candidates of a query that are returned by the fast version or ranked by the exact
+            one, in addition to the limit of n_neighbors * excess_factor. 0 sets no further limit.
+        collision_cutoff : float, optional (default = 0.0)
+            A candidate with less than collision_cutoff times the hash collisions of the best candidate of the query
+            is dropped before the ranking. 0 keeps all candidates with minimal_blocks_in_common collisions.
+        query_cache_size : int, optional (default = 0)
+            Number of query results that are kept. A query with the same features, values and parameters as a
+            cached one gets the cached neighbors without hashing and ranking. The cache is emptied by every
+            change of the index. Only fast queries are cached, the neighbors of an exact query depend on
+            the other instances of the query. 0 switches the cache off.
         speed_optimized : {True, False}, optional (default = None)
             A parameter setting that is optimized for the best speed. Can not be used together with the parameter 'accuracy_optimized'.
             If bad results are computed, try 'accuracy_optimized' or optimize the parameters with a hyperparameter optimization.
@@ -97,7 +143,7 @@ class _NearestNeighborsCppInterface():
                  similarity=False, number_of_cores=None, chunk_size=None, prune_inverse_index=-1,
                   prune_inverse_index_after_instance=-1.0, remove_hash_function_with_less_entries_as=-1, 
                   hash_algorithm = 0, block_size = 5, shingle=0, store_value_with_least_sigificant_bit=0, 
-                  cpu_gpu_load_balancing=0, gpu_hashing=0, rangeK_wta=10):
+                  cpu_gpu_load_balancing=0, gpu_hashing=0, rangeK_wta=10, bits_per_hash_value=0, inverse_index_storage=0, compaction_threshold=0.1, numa_replication=False, candidate_budget=0, multi_probe=False, max_candidates=0, collision_cutoff=0.0, query_cache_size=0):
         # self._X
         # self._y = None
         if number_of_cores is None:
@@ -115,7 +161,11 @@ class _NearestNeighborsCppInterface():
                                                     prune_inverse_index_after_instance, remove_hash_function_with_less_entries_as,
                                                     hash_algorithm,
                                                      block_size, 
-                                                     shingle, store_value_with_least_sigificant_bit, cpu_gpu_load_balancing, gpu_hashing, rangeK_wta)
+                                                     shingle, store_value_with_least_sigificant_bit, cpu_gpu_load_balancing, gpu_hashing, rangeK_wta,
+                                                     bits_per_hash_value, inverse_index_storage, compaction_threshold,
+                                                     1 if numa_replication else 0, candidate_budget,
+                                                     1 if multi_probe else 0, max_candidates, collision_cutoff,
+                                                     query_cache_size)
 
     def __del__(self):
         _nearestNeighbors.delete_object(self._pointer_address_of_nearestNeighbors_object)
@@ -164,24 +214,41 @@ class _NearestNeighborsCppInterface():
                 Training data. Shape = [n_samples, n_features]
             y : list, optional (default = None)
                 List of classes for the given input of X. Size have to be n_samples."""
+        X_csr = csr_matrix(X)
+
+        instances, features = X_csr.nonzero()
+        maxFeatures = int(max(X_csr.getnnz(1)))
+        data = X_csr.data
+
+        # the ids of the new instances start at the current number of instances, raises ValueError if
+        # the index can not be extended
+        self._pointer_address_of_nearestNeighbors_object = _nearestNeighbors.partial_fit(instances.tolist(), features.tolist(), data.tolist(),
+                                                                    X_csr.shape[0], maxFeatures,
+                                                                    self._pointer_address_of_nearestNeighbors_object)
+        self._index_elements_count += X_csr.shape[0]
         if y is not None:
             if self._y_is_csr:
                 self._y = vstack([self._y, y])
             else:
                 self._y = np.concatenate((self._y, y), axis=0)
+       
         
-        X_csr = csr_matrix(X)
+    def remove(self, instance_ids):
+        """Removes the instances with the given ids from the index. The ids of the other instances do not change."""
+        _nearestNeighbors.remove([int(instance_id) for instance_id in instance_ids],
+                                    self._pointer_address_of_nearestNeighbors_object)
 
+    def update(self, instance_ids, X):
+        """Replaces the instances with the given ids by the rows of X, the instances keep their ids."""
+        X_csr = csr_matrix(X)
         instances, features = X_csr.nonzero()
+        maxFeatures = int(max(X_csr.getnnz(1)))
         data = X_csr.data
-        for i in xrange(len(instances)):
-            instances[i] += self._index_elements_count 
-        self._index_elements_count += X.shape[0]
-        
-        self._pointer_address_of_nearestNeighbors_object = _nearestNeighbors.fit(instances.tolist(), features.tolist(), data.tolist(),
-                                                                    self._pointer_address_of_nearestNeighbors_object)
-       
-        
+        _nearestNeighbors.update([int(instance_id) for instance_id in instance_ids],
+                                    instances.tolist(), features.tolist(), data.tolist(),
+                                    X_csr.shape[0], maxFeatures,
+                                    self._pointer_address_of_nearestNeighbors_object)
+
     def kneighbors(self,X=None, n_neighbors=None, return_distance=True, fast=None, similarity=None):
         """Finds the n_neighbors of a point X or of all points of X.
 
@@ -795,9 +862,87 @@ class _NearestNeighborsCppInterface():
     def get_distribution_of_inverse_index(self):
         """Returns the number of created hash values per hash function, 
             the average size of elements per hash value per hash function,
-            the mean and the standard deviation."""
+            the mean, the standard deviation and the false positive rate of the lookups,
+            the number of hash values with too many collisions and a dict with the size of the
+            posting lists at the quantiles 0.5, 0.9, 0.99 and 1.
+            The values are read from counters the index keeps up to date and do not block queries."""
         return _nearestNeighbors.get_distribution_of_inverse_index(self._pointer_address_of_nearestNeighbors_object)
+
+    def get_candidate_filter_statistics(self, reset=False):
+        """Returns the counters of the candidate filter as a dict: the number of queries, of their candidates
+            and of the candidates with a single collision, the number of candidates removed by
+            minimal_blocks_in_common, by collision_cutoff and by the limit of n_neighbors * excess_factor or
+            max_candidates and the number of candidates that passed the filter. A query is a unique signature.
+            The counters sum up all queries since the object was created or the last call with reset=True."""
+        return _nearestNeighbors.get_candidate_filter_statistics(self._pointer_address_of_nearestNeighbors_object,
+                                                                 1 if reset else 0)
+
+    def get_query_cache_statistics(self, reset=False):
+        """Returns the number of hits and misses of the query cache and the number of cached results as a dict.
+            A query of n instances counts n hits or misses. With reset=True the hits and misses are set to zero."""
+        return _nearestNeighbors.get_query_cache_statistics(self._pointer_address_of_nearestNeighbors_object,
+                                                            1 if reset else 0)
+
+    def save(self, path):
+        """Writes the fitted index, the original data and the parameters to the file path.
+            Saving needs inverse_index_storage 2 or 3."""
+        _nearestNeighbors.save(path, self._pointer_address_of_nearestNeighbors_object)
+
+    def load(self, path, populate=False):
+        """Replaces the index by the one stored in the file path. The file is memory mapped and used
+            in place, processes loading the same file share its memory.
+            If populate is True the whole file is read while loading, otherwise on first access."""
+        pointer_address, index_elements_count = _nearestNeighbors.load(path, 1 if populate else 0)
+        _nearestNeighbors.delete_object(self._pointer_address_of_nearestNeighbors_object)
+        self._pointer_address_of_nearestNeighbors_object = pointer_address
+        self._index_elements_count = index_elements_count
         
+    def _compute_signatures(self, X):
+        """Returns the signatures and the signature ids of the rows of X as two strings. The object does not need
+            to be fitted, objects with the same parameters compute the same signatures."""
+        X_csr = csr_matrix(X)
+        instances, features = X_csr.nonzero()
+        maxFeatures = int(max(X_csr.getnnz(1)))
+        data = X_csr.data
+        return _nearestNeighbors.compute_signatures(instances.tolist(), features.tolist(), data.tolist(),
+                                    X_csr.shape[0], maxFeatures,
+                                    self._pointer_address_of_nearestNeighbors_object)
+
+    def _kneighbors_signatures(self, signatures, X, n_neighbors=None, fast=None, similarity=None):
+        """Like kneighbors with return_distance=True, but the signatures of X are given by _compute_signatures
+            and not computed again."""
+        if fast is None: 
+            fast = -1
+        elif fast:
+            fast = 1
+        else:
+            fast = 0
+
+        if similarity is None:
+            similarity = -1
+        elif similarity:
+            similarity = 1
+        else:
+            similarity = 0
+        X_csr = csr_matrix(X)
+        instances, features = X_csr.nonzero()
+        maxFeatures = int(max(X_csr.getnnz(1)))
+        data = X_csr.data
+        result = _nearestNeighbors.kneighbors_signatures(signatures, instances.tolist(), features.tolist(), data.tolist(), 
+                                    X_csr.shape[0], maxFeatures,
+                                    n_neighbors if n_neighbors else 0, 1,
+                                    fast, similarity, 
+                                    self._pointer_address_of_nearestNeighbors_object)
+        return asarray(result[0]), asarray(result[1])
+
+    def _kneighbors_fast_signatures(self, signatures, signature_ids, n_neighbors=None):
+        """Like kneighbors with fast=True and return_distance=True for queries given only by the signatures and
+            signature ids of _compute_signatures."""
+        result = _nearestNeighbors.kneighbors_fast_signatures(signatures, signature_ids,
+                                    n_neighbors if n_neighbors else 0,
+                                    self._pointer_address_of_nearestNeighbors_object)
+        return asarray(result[0]), asarray(result[1])
+
     def _getY(self):
         return self._y
     def _getY_is_csr(self):
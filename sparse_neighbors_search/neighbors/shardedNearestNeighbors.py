@@ -0,0 +1,209 @@
+# Copyright 2016 Joachim Wolff
+# Master Thesis
+# Tutor: Fabrizio Costa, Milad Miladi
+# Winter semester 2015/2016
+#
+# Chair of Bioinformatics
+# Department of Computer Science
+# Faculty of Engineering
+# Albert-Ludwigs-University Freiburg im Breisgau
+
+__author__ = 'joachimwolff'
+import multiprocessing as mp
+from scipy.sparse import csr_matrix
+import numpy as np
+
+from minHash import MinHash
+
+def _shard(connection, hash_class, parameters):
+    """Main loop of a shard process. Receives (command, arguments) from the coordinator and sends back
+        (True, result) or (False, error message)."""
+    estimator = hash_class(**parameters)
+    cpp_interface = estimator._nearestNeighborsCppInterface
+    while True:
+        command, arguments = connection.recv()
+        if command == 'close':
+            connection.close()
+            return
+        try:
+            if command == 'fit':
+                estimator.fit(arguments)
+                result = cpp_interface._index_elements_count
+            elif command == 'load':
+                estimator.load(*arguments)
+                result = cpp_interface._index_elements_count
+            elif command == 'save':
+                result = estimator.save(arguments)
+            elif command == 'kneighbors':
+                result = cpp_interface._kneighbors_signatures(*arguments)
+            elif command == 'kneighbors_fast':
+                result = cpp_interface._kneighbors_fast_signatures(*arguments)
+            else:
+                raise ValueError("Unknown command " + str(command))
+            connection.send((True, result))
+        except Exception as error:
+            connection.send((False, repr(error)))
+
+class ShardedNearestNeighbors():
+    """Approximate nearest neighbor search on a data set that is split by instance range over several
+        processes, e.g. if the index does not fit into the memory of one process or one numa node.
+        Every shard is a MinHash or WtaHash object in its own process with an index of a consecutive range
+        of the instances. A query computes the signatures once, sends them to all shards over local sockets
+        and merges the k nearest neighbors of the shards. The query instances are only sent for the exact
+        distances. The ids of the result are the positions of the instances in the whole data set.
+
+        Parameters
+        ----------
+        number_of_shards : int, optional (default = 2)
+            Number of processes the index is split into.
+        hash_class : {MinHash, WtaHash}, optional (default = MinHash)
+            Class of the index of every shard.
+        **parameters :
+            Parameters of the constructor of hash_class, every shard and the coordinator use the same ones.
+            number_of_cores is the number of cores of every shard.
+
+        Notes
+        -----
+        In fast mode the distances are derived from the number of hash collisions and comparable between shards,
+        the merged neighbors are the ones of a single index over the whole data set up to the order of equal
+        distances. With a candidate_budget this does not hold, every shard visits its own lists of a query.
+        Only max_bin_size is applied per shard, a hash value with too many collisions in the whole data set
+        can be kept by the shards. In exact mode every shard computes the exact distances of its own
+        candidates. Queries need X, the neighbors of the fitted instances are not supported.
+        """
+    def __init__(self, number_of_shards=2, hash_class=MinHash, **parameters):
+        self._parameters = parameters
+        self._hash_class = hash_class
+        # computes the signatures of the queries, it is never fitted
+        self._signatures = hash_class(**parameters)
+        self._connections = []
+        self._processes = []
+        for i in xrange(number_of_shards):
+            connection, shard_connection = mp.Pipe()
+            process = mp.Process(target=_shard, args=(shard_connection, hash_class, parameters))
+            process.daemon = True
+            process.start()
+            shard_connection.close()
+            self._connections.append(connection)
+            self._processes.append(process)
+        # id of the first instance of every shard
+        self._offsets = [0] * number_of_shards
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        """Stops the shard processes."""
+        for connection in self._connections:
+            try:
+                connection.send(('close', None))
+                connection.close()
+            except (IOError, EOFError):
+                pass
+        for process in self._processes:
+            process.join()
+        self._connections = []
+        self._processes = []
+
+    def _scatter(self, command, arguments):
+        """Sends command with arguments[i] to shard i and returns the results in the order of the shards."""
+        for connection, argument in zip(self._connections, arguments):
+            connection.send((command, argument))
+        return self._gather()
+
+    def _broadcast(self, command, argument):
+        for connection in self._connections:
+            connection.send((command, argument))
+        return self._gather()
+
+    def _gather(self):
+        results = []
+        errors = []
+        # every shard sends an answer, read all of them before reporting an error
+        for i, connection in enumerate(self._connections):
+            success, result = connection.recv()
+            if success:
+                results.append(result)
+            else:
+                errors.append("shard " + str(i) + ": " + result)
+        if len(errors) > 0:
+            raise RuntimeError("; ".join(errors))
+        return results
+
+    def _set_offsets(self, sizes):
+        self._offsets = [0] * len(sizes)
+        for i in xrange(1, len(sizes)):
+            self._offsets[i] = self._offsets[i - 1] + sizes[i - 1]
+
+    def fit(self, X):
+        """Splits X into number_of_shards consecutive ranges of instances and fits one shard with each.
+
+            Parameters
+            ----------
+            X : {array-like, sparse matrix}
+                Training data. Shape = [n_samples, n_features], n_samples must be at least number_of_shards."""
+        X_csr = csr_matrix(X)
+        number_of_shards = len(self._connections)
+        if X_csr.shape[0] < number_of_shards:
+            raise ValueError("X has less instances than there are shards.")
+        bounds = [X_csr.shape[0] * i // number_of_shards for i in xrange(number_of_shards + 1)]
+        sizes = self._scatter('fit', [X_csr[bounds[i]:bounds[i + 1]] for i in xrange(number_of_shards)])
+        self._set_offsets(sizes)
+
+    def save(self, paths):
+        """Writes the index of shard i to paths[i], see MinHash.save."""
+        self._scatter('save', paths)
+
+    def load(self, paths, populate=False):
+        """Loads the index of shard i from paths[i]. The files are written by save, of a sharded
+            index or of single objects with the same parameters, the instances of paths[i + 1] follow
+            the ones of paths[i]."""
+        if len(paths) != len(self._connections):
+            raise ValueError("One path per shard is needed.")
+        sizes = self._scatter('load', [(path, populate) for path in paths])
+        # the coordinator takes the parameters from the first file
+        self._signatures.load(paths[0])
+        self._set_offsets(sizes)
+
+    def kneighbors(self, X, n_neighbors=None, return_distance=True, fast=None, similarity=None):
+        """Finds the n_neighbors of all points of X in the whole data set.
+
+            Parameters
+            ----------
+            X : {array-like, sparse matrix}
+                Data point(s) to be searched for n_neighbors. Shape = [n_samples, n_features]
+            n_neighbors, return_distance, fast, similarity :
+                See MinHash.kneighbors.
+
+            Returns
+            -------
+            dist : array, shape = [n_samples, n_neighbors]
+                Distances to the neighbors, only present if return_distance=True.
+            ind : array, shape = [n_samples, n_neighbors]
+                Ids of the neighbors, -1 if less than n_neighbors were found."""
+        X_csr = csr_matrix(X)
+        if fast is None:
+            fast = self._parameters.get('fast', False)
+        if similarity is None:
+            similarity = self._parameters.get('similarity', False)
+        signatures, signature_ids = self._signatures._nearestNeighborsCppInterface._compute_signatures(X_csr)
+        if fast:
+            # the fast distances need only the signatures, the features of the queries are not sent
+            results = self._broadcast('kneighbors_fast', (signatures, signature_ids, n_neighbors))
+        else:
+            results = self._broadcast('kneighbors', (signatures, X_csr, n_neighbors, fast, similarity))
+        # the exact cosine similarity is the only value where larger is better
+        descending = not fast and similarity
+
+        # every shard returns n_neighbors per query, missing ones are -1
+        n_neighbors = results[0][1].shape[1]
+        distances = np.hstack([result[0] for result in results])
+        neighbors = np.hstack([np.where(result[1] == -1, -1, result[1] + offset)
+                                for result, offset in zip(results, self._offsets)])
+        # missing neighbors are sorted to the end
+        keys = np.where(neighbors == -1, np.inf, -distances if descending else distances)
+        order = np.argsort(keys, axis=1, kind='mergesort')[:, :n_neighbors]
+        rows = np.arange(X_csr.shape[0])[:, np.newaxis]
+        if return_distance:
+            return distances[rows, order], neighbors[rows, order]
+        return neighbors[rows, order]